@@ -31,6 +31,13 @@ public:
 	virtual void blend(int count, PixelIterator<Pixel> dst, const Pixel &src, PixelIterator<const Pixel> masks) = 0;
 	virtual void blend(int count, PixelIterator<Pixel> dst, const Pixel &src, PixelIterator<const float> opacities) = 0;
 	
+	/**
+	 * Blends with 8bit coverages (eg a soft selection) multiplied into the source.
+	 * @param coverages 0 - 255 per pixel
+	 */
+	virtual void blend(int count, PixelIterator<Pixel> dst, PixelIterator<const Pixel> src, const uint8_t *coverages, float opacity) = 0;
+	virtual void blend(int count, PixelIterator<Pixel> dst, const Pixel &src, const uint8_t *coverages, float opacity) = 0;
+	
 	virtual void blendReversed(int count, PixelIterator<Pixel> dst, PixelIterator<const Pixel> src) = 0;
 	virtual void blendReversed(int count, PixelIterator<Pixel> dst, PixelIterator<const Pixel> src, PixelIterator<const Pixel> masks) = 0;
 	virtual void blendReversed(int count, PixelIterator<Pixel> dst, PixelIterator<const Pixel> src, PixelIterator<const float> opacities) = 0;
@@ -130,6 +137,34 @@ public:
 	}
 	
 	
+	void blend(int count, PixelIterator<Pixel> dst, PixelIterator<const Pixel> src, const uint8_t *coverages, float opacity)
+	{
+		float factor = opacity * (1.f / 255.f);
+		
+		while (count--)
+		{
+			// fully uncovered pixels are left untouched
+			if (*coverages)
+				*dst = TBlendTraits::blend(*dst, src->v() * PixelVec(*coverages * factor));
+			++dst;
+			++src;
+			++coverages;
+		}
+	}
+	
+	void blend(int count, PixelIterator<Pixel> dst, const Pixel &src, const uint8_t *coverages, float opacity)
+	{
+		float factor = opacity * (1.f / 255.f);
+		
+		while (count--)
+		{
+			if (*coverages)
+				*dst = TBlendTraits::blend(*dst, src.v() * PixelVec(*coverages * factor));
+			++dst;
+			++coverages;
+		}
+	}
+	
 	void blendReversed(int count, PixelIterator<Pixel> dst, PixelIterator<const Pixel> src)
 	{
 		src += count - 1;
@@ -3,7 +3,7 @@
 namespace Malachite
 {
 
-ColorGradientCache::ColorGradientCache(ColorGradient *gradient, int sampleCount) :
+ColorGradientCache::ColorGradientCache(const ColorGradient *gradient, int sampleCount) :
 	ColorGradient(),
 	_sampleCount(sampleCount),
 	_cache(sampleCount + 1)
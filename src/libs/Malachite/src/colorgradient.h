@@ -19,17 +19,28 @@ public:
 	virtual ColorGradient *clone() const { return 0; }
 };
 
+/**
+ * A ColorGradient baked into "sampleCount" + 1 evenly spaced samples, so that a draw evaluates the gradient only once per sample.
+ * Lookups return the nearest sample.
+ */
 class MALACHITESHARED_EXPORT ColorGradientCache : public ColorGradient
 {
 public:
 	
-	ColorGradientCache(ColorGradient *gradient, int sampleCount);
+	static constexpr int defaultSampleCount() { return 1024; }
+	
+	ColorGradientCache(const ColorGradient *gradient, int sampleCount = defaultSampleCount());
 	
 	Pixel at(float x) const
 	{
 		return _cache.at(roundf(x * _sampleCount));
 	}
 	
+	/**
+	 * @param index The index of the sample in [0, sampleCount()] (the sample at "index / sampleCount()")
+	 */
+	const Pixel &sample(int index) const { return _cache.at(index); }
+	
 	int sampleCount() const { return _sampleCount; }
 	
 private:
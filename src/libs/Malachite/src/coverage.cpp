@@ -0,0 +1,71 @@
+#include <emmintrin.h>
+#include <cstring>
+#include "coverage.h"
+
+namespace Malachite
+{
+
+namespace
+{
+
+/**
+ * @return Whether all bytes equal "value"
+ */
+bool allBytesEqual(const uint8_t *p, int count, uint8_t value)
+{
+	int i = 0;
+	auto v = _mm_set1_epi8(char(value));
+	
+	for (; i + 16 <= count; i += 16)
+	{
+		auto eq = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i)), v);
+		if (_mm_movemask_epi8(eq) != 0xFFFF)
+			return false;
+	}
+	
+	for (; i < count; ++i)
+	{
+		if (p[i] != value)
+			return false;
+	}
+	
+	return true;
+}
+
+}
+
+bool CoverageImage::isBlank() const
+{
+	if (!isValid())
+		return true;
+	return allBytesEqual((const uint8_t *)constBitmap().cbegin(), width() * height(), 0);
+}
+
+bool CoverageImage::isFull() const
+{
+	if (!isValid())
+		return false;
+	return allBytesEqual((const uint8_t *)constBitmap().cbegin(), width() * height(), 255);
+}
+
+void multiplyCoverages(int count, float *covers, const uint8_t *coverages)
+{
+	const auto zero = _mm_setzero_si128();
+	const auto scale = _mm_set1_ps(1.f / 255.f);
+	
+	int i = 0;
+	
+	for (; i + 4 <= count; i += 4)
+	{
+		int32_t packed;
+		std::memcpy(&packed, coverages + i, 4);
+		auto ints = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+		auto factors = _mm_mul_ps(_mm_cvtepi32_ps(ints), scale);
+		_mm_storeu_ps(covers + i, _mm_mul_ps(_mm_loadu_ps(covers + i), factors));
+	}
+	
+	for (; i < count; ++i)
+		covers[i] *= coverages[i] * (1.f / 255.f);
+}
+
+}
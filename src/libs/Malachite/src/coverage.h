@@ -0,0 +1,42 @@
+#pragma once
+
+//ExportName: Coverage
+
+#include "genericsurface.h"
+
+namespace Malachite
+{
+
+/**
+ * 8bit coverage (0 - 255) image, used as a soft mask.
+ */
+class MALACHITESHARED_EXPORT CoverageImage : public GenericImage<uint8_t>
+{
+public:
+	
+	typedef GenericImage<uint8_t> super;
+	
+	CoverageImage() : super() {}
+	CoverageImage(const super &other) : super(other) {}
+	CoverageImage(const QSize &size) : super(size) {}
+	CoverageImage(int width, int height) : super(width, height) {}
+	
+	/**
+	 * @return Whether all pixels are 0
+	 */
+	bool isBlank() const;
+	
+	/**
+	 * @return Whether all pixels are 255
+	 */
+	bool isFull() const;
+};
+
+typedef GenericSurface<CoverageImage> CoverageSurface;
+
+/**
+ * Multiplies "count" float covers by 8bit coverages (scaled to 0 - 1).
+ */
+MALACHITESHARED_EXPORT void multiplyCoverages(int count, float *covers, const uint8_t *coverages);
+
+}
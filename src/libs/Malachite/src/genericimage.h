@@ -92,6 +92,16 @@ public:
 	
 	QSize size() const { return p ? p->mBitmap.size() : QSize(); }
 
+	/**
+	 * @return The size of the pixel data in bytes
+	 */
+	qint64 byteCount() const { return qint64(size().width()) * size().height() * sizeof(TPixel); }
+
+	/**
+	 * @return An address that identifies the shared pixel data (null for invalid images)
+	 */
+	const void *dataId() const { return p.constData(); }
+
 	Bitmap<value_type> bitmap() { return p ? p->mBitmap : Bitmap<value_type>(); }
 	Bitmap<const value_type> constBitmap() const { return p ? p->mBitmap : Bitmap<const value_type>(); }
 
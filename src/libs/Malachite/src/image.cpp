@@ -145,6 +145,54 @@ static void copyColorFast(int count, BgraPremultU8 *dst, const Pixel *src)
 	}
 }
 
+void blendOnBackgroundToU8(int count, BgraPremultU8 *dst, const Pixel *src, const Pixel &background)
+{
+	int countPer4 = count / 4;
+	int rem = count % 4;
+	
+	static const PixelVec vec255(0xFF);
+	static const PixelVec vecOne(1);
+	
+	const PixelVec bg = background.v();
+	
+	auto blendAndScale = [&](const Pixel &p) -> __m128i
+	{
+		return _mm_cvtps_epi32((p.v() + bg * (vecOne - p.aV())) * vec255);
+	};
+	
+	while (countPer4--)
+	{
+		__m128i d0 = blendAndScale(*src++);
+		__m128i d1 = blendAndScale(*src++);
+		__m128i w0 = _mm_packs_epi32(d0, d1);
+		
+		__m128i d2 = blendAndScale(*src++);
+		__m128i d3 = blendAndScale(*src++);
+		__m128i w1 = _mm_packs_epi32(d2, d3);
+		
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst), _mm_packus_epi16(w0, w1));
+		
+		dst += 4;
+	}
+	
+	auto dstDwords = reinterpret_cast<uint32_t *>(dst);
+	
+	while (rem--)
+	{
+		union
+		{
+			uint32_t dwords[4];
+			__m128i d;
+		} u;
+		
+		u.d = blendAndScale(*src++);
+		u.d = _mm_packs_epi32(u.d, u.d);
+		u.d = _mm_packus_epi16(u.d, u.d);
+		
+		*dstDwords++ = u.dwords[0];
+	}
+}
+
 ImageU8 Image::toImageU8() const
 {
 	ImageU8 result(this->size());
@@ -106,6 +106,16 @@ inline Image operator*(const Image &image, float factor)
 	return result;
 }
 
+/**
+ * Blends "src" over an opaque "background" and converts the result into 8bit pixels in one pass.
+ * Equivalent to filling "background" with DestinationOver and calling toImageU8, without intermediate images.
+ * @param count The pixel count
+ * @param dst The destination (need not be aligned)
+ * @param src The source (16byte aligned)
+ * @param background The background color
+ */
+MALACHITESHARED_EXPORT void blendOnBackgroundToU8(int count, BgraPremultU8 *dst, const Pixel *src, const Pixel &background);
+
 MALACHITESHARED_EXPORT QDataStream &operator<<(QDataStream &out, const Image &image);
 MALACHITESHARED_EXPORT QDataStream &operator>>(QDataStream &in, Image &image);
 
@@ -0,0 +1,365 @@
+#include <QIODevice>
+#include <QDebug>
+#include <csetjmp>
+#include <cstdio>
+#include <vector>
+#include <png.h>
+#include <jpeglib.h>
+#include <jerror.h>
+
+#include "division.h"
+#include "imagestreamwriter.h"
+
+namespace Malachite
+{
+
+namespace
+{
+
+enum Format
+{
+	FormatUnknown,
+	FormatPng,
+	FormatJpeg
+};
+
+Format formatFromString(const QString &format)
+{
+	if (format == "png")
+		return FormatPng;
+	if (format == "jpg" || format == "jpeg")
+		return FormatJpeg;
+	return FormatUnknown;
+}
+
+/**
+ * Converts a row of "surface" into "dst".
+ */
+template <class TPixel>
+void convertRow(TPixel *dst, const Surface &surface, int x, int y, int width)
+{
+	constexpr int tileWidth = Surface::tileWidth();
+
+	for (int done = 0; done < width;)
+	{
+		QPoint key, pos;
+		IntDivision::dividePoint(QPoint(x + done, y), tileWidth, &key, &pos);
+		int count = std::min(width - done, tileWidth - pos.x());
+
+		auto tile = surface.tile(key);
+		auto src = (const Pixel *)tile.constPixelPointer(pos);
+
+		for (int i = 0; i < count; ++i)
+			dst[done + i] = TPixel(src[i]);
+
+		done += count;
+	}
+}
+
+// libpng
+
+void writePng(png_structp png, png_bytep data, png_size_t length)
+{
+	auto device = static_cast<QIODevice *>(png_get_io_ptr(png));
+	if (device->write(reinterpret_cast<const char *>(data), length) != qint64(length))
+		png_error(png, "failed to write to the device");
+}
+
+void flushPng(png_structp png)
+{
+	Q_UNUSED(png);
+}
+
+void warnPng(png_structp png, png_const_charp message)
+{
+	Q_UNUSED(png);
+	qWarning() << "libpng:" << message;
+}
+
+// libjpeg
+
+constexpr size_t jpegBufferSize = 1 << 16;
+
+struct JpegError
+{
+	jpeg_error_mgr manager;
+	std::jmp_buf jump;
+};
+
+struct JpegDestination
+{
+	jpeg_destination_mgr manager;
+	QIODevice *device;
+	JOCTET buffer[jpegBufferSize];
+};
+
+void exitJpeg(j_common_ptr info)
+{
+	char message[JMSG_LENGTH_MAX];
+	info->err->format_message(info, message);
+	qWarning() << "libjpeg:" << message;
+
+	std::longjmp(reinterpret_cast<JpegError *>(info->err)->jump, 1);
+}
+
+void initJpegDestination(j_compress_ptr info)
+{
+	auto dest = reinterpret_cast<JpegDestination *>(info->dest);
+	dest->manager.next_output_byte = dest->buffer;
+	dest->manager.free_in_buffer = jpegBufferSize;
+}
+
+boolean emptyJpegBuffer(j_compress_ptr info)
+{
+	auto dest = reinterpret_cast<JpegDestination *>(info->dest);
+
+	// libjpeg requires writing the whole buffer, regardless of free_in_buffer
+	if (dest->device->write(reinterpret_cast<const char *>(dest->buffer), jpegBufferSize) != qint64(jpegBufferSize))
+		ERREXIT(info, JERR_FILE_WRITE);
+
+	initJpegDestination(info);
+	return TRUE;
+}
+
+void termJpegDestination(j_compress_ptr info)
+{
+	auto dest = reinterpret_cast<JpegDestination *>(info->dest);
+	qint64 count = jpegBufferSize - dest->manager.free_in_buffer;
+
+	if (dest->device->write(reinterpret_cast<const char *>(dest->buffer), count) != count)
+		ERREXIT(info, JERR_FILE_WRITE);
+}
+
+}
+
+struct ImageStreamWriter::Data
+{
+	Format format = FormatUnknown;
+	int quality = 80;
+	bool alphaEnabled = true;
+
+	QSize size;
+	int writtenRowCount = 0;
+	bool started = false;
+
+	std::vector<uint8_t> rowBuffer;
+
+	png_structp png = nullptr;
+	png_infop pngInfo = nullptr;
+
+	jpeg_compress_struct jpeg;
+	JpegError jpegError;
+	JpegDestination jpegDestination;
+
+	/**
+	 * Calls libpng functions, catching their errors.
+	 */
+	template <class TFunction>
+	bool callPng(TFunction func)
+	{
+		if (setjmp(png_jmpbuf(png)))
+			return false;
+		func();
+		return true;
+	}
+
+	/**
+	 * Calls libjpeg functions, catching their errors.
+	 */
+	template <class TFunction>
+	bool callJpeg(TFunction func)
+	{
+		if (setjmp(jpegError.jump))
+			return false;
+		func();
+		return true;
+	}
+
+	void destroy()
+	{
+		if (!started)
+			return;
+
+		if (format == FormatPng)
+			png_destroy_write_struct(&png, &pngInfo);
+		else if (format == FormatJpeg)
+			jpeg_destroy_compress(&jpeg);
+
+		started = false;
+		rowBuffer = std::vector<uint8_t>();
+	}
+
+	bool beginPng(QIODevice *device)
+	{
+		png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, warnPng);
+		if (!png)
+			return false;
+		pngInfo = png_create_info_struct(png);
+		started = true;
+		if (!pngInfo)
+			return false;
+
+		int colorType = alphaEnabled ? PNG_COLOR_TYPE_RGB_ALPHA : PNG_COLOR_TYPE_RGB;
+		int channelCount = alphaEnabled ? 4 : 3;
+		rowBuffer.resize(size.width() * channelCount * sizeof(uint16_t));
+
+		return callPng([&] {
+			png_set_write_fn(png, device, writePng, flushPng);
+			png_set_IHDR(png, pngInfo, size.width(), size.height(), 16, colorType, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+			png_write_info(png, pngInfo);
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+			// 16 bit samples are big-endian in PNG
+			png_set_swap(png);
+#endif
+		});
+	}
+
+	bool beginJpeg(QIODevice *device)
+	{
+		jpeg.err = jpeg_std_error(&jpegError.manager);
+		jpegError.manager.error_exit = exitJpeg;
+
+		if (!callJpeg([&] { jpeg_create_compress(&jpeg); }))
+			return false;
+		started = true;
+
+		jpegDestination.manager.init_destination = initJpegDestination;
+		jpegDestination.manager.empty_output_buffer = emptyJpegBuffer;
+		jpegDestination.manager.term_destination = termJpegDestination;
+		jpegDestination.device = device;
+		jpeg.dest = &jpegDestination.manager;
+
+		jpeg.image_width = size.width();
+		jpeg.image_height = size.height();
+		jpeg.input_components = 3;
+		jpeg.in_color_space = JCS_RGB;
+
+		rowBuffer.resize(size.width() * 3);
+
+		return callJpeg([&] {
+			jpeg_set_defaults(&jpeg);
+			jpeg_set_quality(&jpeg, quality, TRUE);
+			jpeg_start_compress(&jpeg, TRUE);
+		});
+	}
+
+	bool writeRow(const Surface &surface, int x, int y)
+	{
+		auto row = rowBuffer.data();
+
+		if (format == FormatPng)
+		{
+			if (alphaEnabled)
+				convertRow(reinterpret_cast<RgbaU16 *>(row), surface, x, y, size.width());
+			else
+				convertRow(reinterpret_cast<RgbU16 *>(row), surface, x, y, size.width());
+
+			return callPng([&] { png_write_row(png, row); });
+		}
+		else
+		{
+			convertRow(reinterpret_cast<RgbU8 *>(row), surface, x, y, size.width());
+
+			return callJpeg([&] {
+				JSAMPROW rows[1] = { row };
+				jpeg_write_scanlines(&jpeg, rows, 1);
+			});
+		}
+	}
+
+	bool finish()
+	{
+		if (format == FormatPng)
+			return callPng([&] { png_write_end(png, pngInfo); });
+		else
+			return callJpeg([&] { jpeg_finish_compress(&jpeg); });
+	}
+};
+
+ImageStreamWriter::ImageStreamWriter(const QString &format) :
+	d(new Data)
+{
+	d->format = formatFromString(format);
+}
+
+ImageStreamWriter::~ImageStreamWriter()
+{
+	d->destroy();
+	delete d;
+}
+
+bool ImageStreamWriter::isFormatSupported(const QString &format)
+{
+	return formatFromString(format) != FormatUnknown;
+}
+
+void ImageStreamWriter::setQuality(int quality)
+{
+	d->quality = quality;
+}
+
+int ImageStreamWriter::quality() const
+{
+	return d->quality;
+}
+
+void ImageStreamWriter::setAlphaEnabled(bool enabled)
+{
+	d->alphaEnabled = enabled;
+}
+
+bool ImageStreamWriter::isAlphaEnabled() const
+{
+	return d->alphaEnabled;
+}
+
+bool ImageStreamWriter::begin(QIODevice *device, const QSize &size)
+{
+	if (d->started || d->format == FormatUnknown || size.isEmpty())
+		return false;
+
+	d->size = size;
+	d->writtenRowCount = 0;
+
+	bool succeeded = d->format == FormatPng ? d->beginPng(device) : d->beginJpeg(device);
+
+	if (!succeeded)
+		d->destroy();
+	return succeeded;
+}
+
+bool ImageStreamWriter::writeRows(const Surface &surface, const QRect &rect)
+{
+	if (!d->started)
+		return false;
+
+	if (rect.width() != d->size.width() || d->writtenRowCount + rect.height() > d->size.height())
+	{
+		qWarning() << Q_FUNC_INFO << ": invalid rect";
+		return false;
+	}
+
+	for (int y = rect.top(); y <= rect.bottom(); ++y)
+	{
+		if (!d->writeRow(surface, rect.left(), y))
+		{
+			d->destroy();
+			return false;
+		}
+		++d->writtenRowCount;
+	}
+
+	return true;
+}
+
+bool ImageStreamWriter::end()
+{
+	if (!d->started || d->writtenRowCount != d->size.height())
+		return false;
+
+	bool succeeded = d->finish();
+	d->destroy();
+	return succeeded;
+}
+
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+//ExportName: ImageStreamWriter
+
+#include "surface.h"
+
+class QIODevice;
+
+namespace Malachite
+{
+
+/**
+ * The ImageStreamWriter encodes an image band by band, from top to bottom.
+ * Only the rows being written are converted, so the whole image never has to be in memory.
+ * PNG is written with libpng (16 bit per channel) and JPEG with libjpeg.
+ */
+class MALACHITESHARED_EXPORT ImageStreamWriter
+{
+public:
+
+	ImageStreamWriter(const QString &format);
+	~ImageStreamWriter();
+
+	static bool isFormatSupported(const QString &format);
+
+	/**
+	 * Sets the image quality for JPEG files.
+	 * @param quality 0..100
+	 */
+	void setQuality(int quality);
+	int quality() const;
+
+	/**
+	 * Sets whether the alpha channel is written (PNG only).
+	 * This function must be called before begin is called.
+	 */
+	void setAlphaEnabled(bool enabled);
+	bool isAlphaEnabled() const;
+
+	/**
+	 * Starts writing an image.
+	 * @param device The device to write to (does not need to be random-access)
+	 * @param size The size of the whole image
+	 * @return
+	 */
+	bool begin(QIODevice *device, const QSize &size);
+
+	/**
+	 * Writes the next rows of the image.
+	 * @param surface The source of the rows
+	 * @param rect The region of "surface" to write. The width must equal the image width and the height must not exceed the remaining rows.
+	 * @return
+	 */
+	bool writeRows(const Surface &surface, const QRect &rect);
+
+	/**
+	 * Finishes writing. All rows must have been written.
+	 * @return
+	 */
+	bool end();
+
+private:
+
+	struct Data;
+	Data *d;
+};
+
+}
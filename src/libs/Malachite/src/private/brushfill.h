@@ -0,0 +1,285 @@
+#pragma once
+
+#include "../paintengine.h"
+#include "../painter.h"
+#include "filler.h"
+#include "gradientgenerator.h"
+#include "scalinggenerator.h"
+#include "renderer.h"
+
+namespace Malachite
+{
+
+/**
+ * A fill target that paints into a single bitmap.
+ */
+class ImageFillTarget
+{
+public:
+	ImageFillTarget(const Bitmap<Pixel> &bitmap, BlendOp *blendOp, float opacity) :
+		_bitmap(bitmap),
+		_blendOp(blendOp),
+		_opacity(opacity)
+	{}
+	
+	template <class Filler>
+	ImageBaseRenderer<Filler> baseRenderer(Filler *filler) const
+	{
+		return ImageBaseRenderer<Filler>(_bitmap, _blendOp, _opacity, filler);
+	}
+	
+private:
+	Bitmap<Pixel> _bitmap;
+	BlendOp *_blendOp;
+	float _opacity;
+};
+
+/**
+ * A fill target that paints into the tiles of a surface in one rasterization pass.
+ */
+class SurfaceFillTarget
+{
+public:
+	SurfaceFillTarget(Surface *surface, const QPointSet &keyClip, const CoverageSurface &coverageMask, BlendOp *blendOp, float opacity) :
+		_surface(surface),
+		_keyClip(keyClip),
+		_coverageMask(coverageMask),
+		_blendOp(blendOp),
+		_opacity(opacity)
+	{}
+	
+	template <class Filler>
+	SurfaceBaseRenderer<Filler> baseRenderer(Filler *filler) const
+	{
+		return SurfaceBaseRenderer<Filler>(_surface, _keyClip, _coverageMask, _blendOp, _opacity, filler);
+	}
+	
+private:
+	Surface *_surface;
+	QPointSet _keyClip;
+	CoverageSurface _coverageMask;
+	BlendOp *_blendOp;
+	float _opacity;
+};
+
+template <class Rasterizer, class Target, class Filler>
+void fill(Rasterizer *ras, const Target &target, Filler *filler)
+{
+	typedef decltype(target.baseRenderer(filler)) BaseRenderer;
+	
+	agg::scanline_pf sl;
+	BaseRenderer baseRen = target.baseRenderer(filler);
+	Renderer<BaseRenderer> ren(baseRen);
+	
+	renderScanlines(*ras, sl, ren);
+}
+
+template <class Rasterizer, Malachite::SpreadType SpreadType, class Source, class Target>
+void drawTransformedImageBrush(Rasterizer *ras, const Target &target, const Source &source, const QTransform &worldTransform, Malachite::ImageTransformType transformType)
+{
+	switch (transformType)
+	{
+	case Malachite::ImageTransformTypeNearestNeighbor:
+	{
+		typedef ScalingGeneratorNearestNeighbor<Source, SpreadType> Generator;
+		Generator gen(&source);
+		Filler<Generator, true> filler(&gen, worldTransform);
+		fill(ras, target, &filler);
+		return;
+	}
+	case Malachite::ImageTransformTypeBilinear:
+	{
+		typedef ScalingGeneratorBilinear<Source, SpreadType> Generator;
+		Generator gen(&source);
+		Filler<Generator, true> filler(&gen, worldTransform);
+		fill(ras, target, &filler);
+		return;
+	}
+	case Malachite::ImageTransformTypeBicubic:
+	{
+		if (SeparableScalingFiller<Source, SpreadType, ScalingWeightMethodBicubic>::isApplicable(worldTransform))
+		{
+			SeparableScalingFiller<Source, SpreadType, ScalingWeightMethodBicubic> filler(&source, worldTransform);
+			fill(ras, target, &filler);
+			return;
+		}
+		
+		typedef ScalingGenerator2<Source, SpreadType, ScalingWeightMethodBicubic> Generator;
+		Generator gen(&source);
+		Filler<Generator, true> filler(&gen, worldTransform);
+		fill(ras, target, &filler);
+		return;
+	}
+	case Malachite::ImageTransformTypeLanczos2:
+	{
+		if (SeparableScalingFiller<Source, SpreadType, ScalingWeightMethodLanczos2>::isApplicable(worldTransform))
+		{
+			SeparableScalingFiller<Source, SpreadType, ScalingWeightMethodLanczos2> filler(&source, worldTransform);
+			fill(ras, target, &filler);
+			return;
+		}
+		
+		typedef ScalingGenerator2<Source, SpreadType, ScalingWeightMethodLanczos2> Generator;
+		Generator gen(&source);
+		Filler<Generator, true> filler(&gen, worldTransform);
+		fill(ras, target, &filler);
+		return;
+	}
+	case Malachite::ImageTransformTypeLanczos2Hypot:
+	{
+		typedef ScalingGenerator2<Source, SpreadType, ScalingWeightMethodLanczos2Hypot> Generator;
+		Generator gen(&source);
+		Filler<Generator, true> filler(&gen, worldTransform);
+		fill(ras, target, &filler);
+		return;
+	}
+	default:
+		return;
+	}
+}
+
+template <class T_Rasterizer, Malachite::SpreadType T_SpreadType, class T_Target>
+void drawWithSpreadType(T_Rasterizer *ras, const T_Target &target, const PaintEngineState &state)
+{
+	const Brush brush = state.brush;
+	
+	if (brush.type() == Malachite::BrushTypeColor)
+	{
+		ColorFiller filler(brush.pixel());
+		fill(ras, target, &filler);
+		return;
+	}
+	
+	QTransform fillShapeTransform = brush.transform() * state.shapeTransform;
+	
+	if (brush.type() == Malachite::BrushTypeImage)
+	{
+		if (isTransformIntegerTranslating(fillShapeTransform))
+		{
+			QPoint offset(fillShapeTransform.dx(), fillShapeTransform.dy());
+			
+			ImageFiller<T_SpreadType> filler(brush.image().constBitmap(), offset);
+			fill(ras, target, &filler);
+			return;
+		}
+		else
+		{
+			drawTransformedImageBrush<T_Rasterizer, T_SpreadType, Bitmap<const Pixel> >(ras, target, brush.image().constBitmap(), fillShapeTransform.inverted(), state.imageTransformType);
+			return;
+		}
+	}
+	if (brush.type() == Malachite::BrushTypeSurface)
+	{
+		drawTransformedImageBrush<T_Rasterizer, T_SpreadType, Surface>(ras, target, brush.surface(), fillShapeTransform.inverted(), state.imageTransformType);
+		return;
+	}
+	if (brush.type() == Malachite::BrushTypeLinearGradient)
+	{
+		ColorGradientCache cache(brush.gradient());
+		LinearGradientShape info = brush.linearGradientShape();
+		
+		if (info.transformable(fillShapeTransform))
+		{
+			info.transform(fillShapeTransform);
+			fillShapeTransform = QTransform();
+		}
+		
+		if (fillShapeTransform.isIdentity())
+		{
+			LinearGradientMethod method(info.start, info.end);
+			GradientFiller<LinearGradientMethod, T_SpreadType, false> filler(&cache, &method);
+			fill(ras, target, &filler);
+			return;
+		}
+		else
+		{
+			LinearGradientMethod method(info.start, info.end);
+			GradientFiller<LinearGradientMethod, T_SpreadType, true> filler(&cache, &method, fillShapeTransform.inverted());
+			fill(ras, target, &filler);
+			return;
+		}
+	}
+	if (brush.type() == Malachite::BrushTypeRadialGradient)
+	{
+		ColorGradientCache cache(brush.gradient());
+		RadialGradientShape info = brush.radialGradientShape();
+		
+		if (info.transformable(fillShapeTransform))
+		{
+			info.transform(fillShapeTransform);
+			fillShapeTransform = QTransform();
+		}
+		
+		if (info.center == info.focal)
+		{
+			if (fillShapeTransform.isIdentity())
+			{
+				RadialGradientMethod method(info.center, info.radius);
+				GradientFiller<RadialGradientMethod, T_SpreadType, false> filler(&cache, &method);
+				fill(ras, target, &filler);
+				return;
+			}
+			else
+			{
+				RadialGradientMethod method(info.center, info.radius);
+				GradientFiller<RadialGradientMethod, T_SpreadType, true> filler(&cache, &method, fillShapeTransform.inverted());
+				fill(ras, target, &filler);
+				return;
+			}
+		}
+		else
+		{
+			if (fillShapeTransform.isIdentity())
+			{
+				FocalGradientMethod method(info.center, info.radius, info.focal);
+				GradientFiller<FocalGradientMethod, T_SpreadType, false> filler(&cache, &method);
+				fill(ras, target, &filler);
+				return;
+			}
+			else
+			{
+				FocalGradientMethod method(info.center, info.radius, info.focal);
+				GradientFiller<FocalGradientMethod, T_SpreadType, true> filler(&cache, &method, fillShapeTransform.inverted());
+				fill(ras, target, &filler);
+				return;
+			}
+		}
+	}
+}
+
+template <class T_Target>
+void drawWithBrush(agg::rasterizer_scanline_aa<> *ras, const T_Target &target, const PaintEngineState &state)
+{
+	switch (state.brush.spreadType())
+	{
+		case Malachite::SpreadTypePad:
+			drawWithSpreadType<agg::rasterizer_scanline_aa<>, Malachite::SpreadTypePad>(ras, target, state);
+			return;
+		case Malachite::SpreadTypeRepeat:
+			drawWithSpreadType<agg::rasterizer_scanline_aa<>, Malachite::SpreadTypeRepeat>(ras, target, state);
+			return;
+		case Malachite::SpreadTypeReflective:
+			drawWithSpreadType<agg::rasterizer_scanline_aa<>, Malachite::SpreadTypeReflective>(ras, target, state);
+			return;
+		default:
+			return;
+	}
+}
+
+inline void addPolygonsToRasterizer(agg::rasterizer_scanline_aa<> *ras, const FixedMultiPolygon &polygons)
+{
+	for (const FixedPolygon &polygon : polygons)
+	{
+		if (polygon.size() < 3)
+			continue;
+		
+		auto i = polygon.begin();
+		ras->move_to(i->x, i->y);
+		++i;
+		
+		for (; i != polygon.end(); ++i)
+			ras->line_to(i->x, i->y);
+	}
+}
+
+}
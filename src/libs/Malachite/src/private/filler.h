@@ -4,6 +4,7 @@
 #include "../blendop.h"
 #include "../division.h"
 #include "../interval.h"
+#include "scratcharena.h"
 
 namespace Malachite
 {
@@ -491,50 +492,44 @@ public:
 	
 	void fill(const QPoint &pos, int count, PixelIterator<Pixel> dst, PixelIterator<float> covers, BlendOp *blendOp)
 	{
-		PixelArray<Pixel> fill(count);
+		ScratchArena::Scope scratch;
+		auto fill = scratch.allocate<Pixel>(count);
+		generate(pos, count, fill);
 		
-		Vec2D centerPos(pos.x(), pos.y());
-		centerPos += Vec2D(0.5, 0.5);
-
-		for (auto &p : fill) {
-			p = _generator->at(TransformEnabled ? centerPos * _transform : centerPos);
-			centerPos += Vec2D(1, 0);
-		}
-		
-		blendOp->blend(count, dst, fill.begin(), covers);
+		blendOp->blend(count, dst, fill, covers);
 	}
 	
 	void fill(const QPoint &pos, int count, PixelIterator<Pixel> dst, float cover, BlendOp *blendOp)
 	{
-		PixelArray<Pixel> fill(count);
+		ScratchArena::Scope scratch;
+		auto fill = scratch.allocate<Pixel>(count);
+		generate(pos, count, fill);
 		
-		Vec2D centerPos(pos.x(), pos.y());
-		centerPos += Vec2D(0.5, 0.5);
-		
-		for (auto &p : fill) {
-			p = _generator->at(TransformEnabled ? centerPos * _transform : centerPos);
-			centerPos += Vec2D(1, 0);
-		}
-		
-		blendOp->blend(count, dst, fill.begin(), cover);
+		blendOp->blend(count, dst, fill, cover);
 	}
 	
 	void fill(const QPoint &pos, int count, PixelIterator<Pixel> dst, BlendOp *blendOp)
 	{
-		PixelArray<Pixel> fill(count);
+		ScratchArena::Scope scratch;
+		auto fill = scratch.allocate<Pixel>(count);
+		generate(pos, count, fill);
 		
+		blendOp->blend(count, dst, fill);
+	}
+	
+private:
+	
+	void generate(const QPoint &pos, int count, PixelIterator<Pixel> dst)
+	{
 		Vec2D centerPos(pos.x(), pos.y());
 		centerPos += Vec2D(0.5, 0.5);
 		
-		for (auto &p : fill) {
-			p = _generator->at(TransformEnabled ? centerPos * _transform : centerPos);
+		for (int i = 0; i < count; ++i) {
+			*(dst + i) = _generator->at(TransformEnabled ? centerPos * _transform : centerPos);
 			centerPos += Vec2D(1, 0);
 		}
-		
-		blendOp->blend(count, dst, fill.begin());
 	}
 	
-private:
 	T_Generator *_generator;
 	QTransform _transform;
 };
@@ -1,49 +1,15 @@
 #pragma once
 
+#include <emmintrin.h>
 #include "../vec2d.h"
 #include "../pixel.h"
+#include "../blendop.h"
+#include "../colorgradient.h"
+#include "scratcharena.h"
 
 namespace Malachite
 {
 
-template <class T_Gradient, class T_Method, Malachite::SpreadType T_SpreadType>
-class GradientGenerator
-{
-public:
-	GradientGenerator(const T_Gradient *gradient, T_Method *method) :
-		_gradient(gradient),
-		_method(method)
-	{}
-	
-	Pixel at(const Vec2D &p)
-	{
-		return _gradient->at(actualPosition(_method->position(p)));
-	}
-	
-private:
-	
-	float actualPosition(float x) const
-	{
-		switch (T_SpreadType)
-		{
-		default:
-		case Malachite::SpreadTypePad:
-			return qBound(0.f, x, 1.f);
-		case Malachite::SpreadTypeRepeat:
-			return x - floorf(x);
-		case Malachite::SpreadTypeReflective:
-		{
-			float f = floorf(x);
-			float r = x - f;
-			return (int)f % 2 ? 1.f - r : r;
-		}
-		}
-	}
-	
-	const T_Gradient *_gradient;
-	T_Method *_method;
-};
-
 class LinearGradientMethod
 {
 public:
@@ -58,7 +24,15 @@ public:
 	
 	float position(const Vec2D &p) const
 	{
-		return Vec2D::dot(p - 1, ab) * ab2inv;
+		return Vec2D::dot(p - a, ab) * ab2inv;
+	}
+	
+	__m128 positions(__m128 x, __m128 y) const
+	{
+		__m128 dx = _mm_sub_ps(x, _mm_set1_ps(a.x()));
+		__m128 dy = _mm_sub_ps(y, _mm_set1_ps(a.y()));
+		__m128 dot = _mm_add_ps(_mm_mul_ps(dx, _mm_set1_ps(ab.x())), _mm_mul_ps(dy, _mm_set1_ps(ab.y())));
+		return _mm_mul_ps(dot, _mm_set1_ps(ab2inv));
 	}
 	
 private:
@@ -107,6 +81,13 @@ public:
 		return (d * rinv).length();
 	}
 	
+	__m128 positions(__m128 x, __m128 y) const
+	{
+		__m128 dx = _mm_mul_ps(_mm_sub_ps(x, _mm_set1_ps(c.x())), _mm_set1_ps(rinv.x()));
+		__m128 dy = _mm_mul_ps(_mm_sub_ps(y, _mm_set1_ps(c.y())), _mm_set1_ps(rinv.y()));
+		return _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+	}
+	
 private:
 	Vec2D c, rinv;
 };
@@ -166,10 +147,145 @@ public:
 		return fp2 / (sqrt(dot * dot - fp2 * c) - dot); 
 	}
 	
+	__m128 positions(__m128 x, __m128 y) const
+	{
+		__m128 fpx = _mm_sub_ps(_mm_mul_ps(_mm_sub_ps(x, _mm_set1_ps(o.x())), _mm_set1_ps(rinv.x())), _mm_set1_ps(of.x()));
+		__m128 fpy = _mm_sub_ps(_mm_mul_ps(_mm_sub_ps(y, _mm_set1_ps(o.y())), _mm_set1_ps(rinv.y())), _mm_set1_ps(of.y()));
+		
+		__m128 dot = _mm_add_ps(_mm_mul_ps(fpx, _mm_set1_ps(of.x())), _mm_mul_ps(fpy, _mm_set1_ps(of.y())));
+		__m128 fp2 = _mm_add_ps(_mm_mul_ps(fpx, fpx), _mm_mul_ps(fpy, fpy));
+		
+		__m128 denominator = _mm_sub_ps(_mm_sqrt_ps(_mm_sub_ps(_mm_mul_ps(dot, dot), _mm_mul_ps(fp2, _mm_set1_ps(c)))), dot);
+		
+		// the focal point itself (0 / 0) is 0
+		return _mm_and_ps(_mm_div_ps(fp2, denominator), _mm_cmpneq_ps(denominator, _mm_setzero_ps()));
+	}
+	
 private:
 	Vec2D o, of, rinv;
 	double c;
 };
 
-}
+/**
+ * Fills spans with a gradient.
+ * Gradient positions are computed 4 pixels at a time with SSE and looked up in a ColorGradientCache.
+ */
+template <class T_Method, Malachite::SpreadType T_SpreadType, bool TransformEnabled>
+class GradientFiller
+{
+public:
+	GradientFiller(const ColorGradientCache *cache, const T_Method *method, const QTransform &worldTransform = QTransform()) :
+		_cache(cache),
+		_method(method),
+		_transform(worldTransform)
+	{}
+	
+	void fill(const QPoint &pos, int count, PixelIterator<Pixel> dst, PixelIterator<float> covers, BlendOp *blendOp)
+	{
+		ScratchArena::Scope scratch;
+		auto fill = scratch.allocate<Pixel>(count);
+		generate(pos, count, fill);
+		blendOp->blend(count, dst, fill, covers);
+	}
+	
+	void fill(const QPoint &pos, int count, PixelIterator<Pixel> dst, float cover, BlendOp *blendOp)
+	{
+		ScratchArena::Scope scratch;
+		auto fill = scratch.allocate<Pixel>(count);
+		generate(pos, count, fill);
+		blendOp->blend(count, dst, fill, cover);
+	}
+	
+	void fill(const QPoint &pos, int count, PixelIterator<Pixel> dst, BlendOp *blendOp)
+	{
+		ScratchArena::Scope scratch;
+		auto fill = scratch.allocate<Pixel>(count);
+		generate(pos, count, fill);
+		blendOp->blend(count, dst, fill);
+	}
+	
+private:
+	
+	void generate(const QPoint &pos, int count, PixelIterator<Pixel> dst) const
+	{
+		Vec2D centerPos(pos.x() + 0.5, pos.y() + 0.5);
+		
+		bool affine = !TransformEnabled || _transform.isAffine();
+		
+		// the pixel center moves by "step" for each pixel in an affine transform
+		Vec2D origin = TransformEnabled ? centerPos * _transform : centerPos;
+		Vec2D step = TransformEnabled ? Vec2D(_transform.m11(), _transform.m12()) : Vec2D(1, 0);
+		
+		const __m128 offsets = _mm_set_ps(3, 2, 1, 0);
+		
+		for (int i = 0; i < count; i += 4)
+		{
+			__m128 x, y;
+			
+			if (affine)
+			{
+				__m128 indexes = _mm_add_ps(_mm_set1_ps(i), offsets);
+				x = _mm_add_ps(_mm_set1_ps(origin.x()), _mm_mul_ps(indexes, _mm_set1_ps(step.x())));
+				y = _mm_add_ps(_mm_set1_ps(origin.y()), _mm_mul_ps(indexes, _mm_set1_ps(step.y())));
+			}
+			else
+			{
+				Vec2D p[4];
+				for (int j = 0; j < 4; ++j)
+					p[j] = (centerPos + Vec2D(i + j, 0)) * _transform;
+				x = _mm_set_ps(p[3].x(), p[2].x(), p[1].x(), p[0].x());
+				y = _mm_set_ps(p[3].y(), p[2].y(), p[1].y(), p[0].y());
+			}
+			
+			__m128i sampleIndexes = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(spread(_method->positions(x, y)), _mm_set1_ps(_cache->sampleCount())), _mm_set1_ps(0.5f)));
+			
+			alignas(16) int32_t indexArray[4];
+			_mm_store_si128(reinterpret_cast<__m128i *>(indexArray), sampleIndexes);
+			
+			int n = qMin(4, count - i);
+			for (int j = 0; j < n; ++j)
+				*(dst + i + j) = _cache->sample(indexArray[j]);
+		}
+	}
+	
+	static __m128 floor(__m128 x)
+	{
+		__m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+		return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, x), _mm_set1_ps(1.f)));
+	}
+	
+	static __m128 spread(__m128 x)
+	{
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.f);
+		
+		switch (T_SpreadType)
+		{
+		default:
+		case Malachite::SpreadTypePad:
+			break;
+		case Malachite::SpreadTypeRepeat:
+			x = _mm_sub_ps(x, floor(x));
+			break;
+		case Malachite::SpreadTypeReflective:
+		{
+			// fold into [0, 2) and mirror the odd half
+			const __m128 two = _mm_set1_ps(2.f);
+			x = _mm_sub_ps(x, _mm_mul_ps(two, floor(_mm_mul_ps(x, _mm_set1_ps(0.5f)))));
+			__m128 mirrored = _mm_sub_ps(two, x);
+			__m128 isOdd = _mm_cmpgt_ps(x, one);
+			x = _mm_or_ps(_mm_and_ps(isOdd, mirrored), _mm_andnot_ps(isOdd, x));
+			break;
+		}
+		}
+		
+		// also maps NaN to 0 (maxps returns the second operand for NaN)
+		return _mm_min_ps(_mm_max_ps(x, zero), one);
+	}
+	
+	const ColorGradientCache *_cache;
+	const T_Method *_method;
+	QTransform _transform;
+};
 
+}
@@ -1,12 +1,16 @@
 #pragma once
 
 #include <QPainterPath>
+#include <emmintrin.h>
 #include "agg_rasterizer_scanline_aa.h"
 #include "agg_scanline_p.h"
 #include "../curvesubdivision.h"
 #include "../bitmap.h"
 #include "../blendop.h"
-#include "../pixelarray.h"
+#include "../surface.h"
+#include "../coverage.h"
+#include "../division.h"
+#include "scratcharena.h"
 
 namespace Malachite
 {
@@ -85,6 +89,48 @@ void renderScanlines(T_Rasterizer& ras, T_Scanline& sl, T_Renderer& ren)
     }
 }
 
+/**
+ * Converts 8 bit rasterizer covers to float covers (0 - 1), 16 at a time.
+ */
+inline void convertCovers(int count, const uint8_t *src, float *dst)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128 scale = _mm_set1_ps(1.f / 255.f);
+	
+	int i = 0;
+	
+	for (; i + 16 <= count; i += 16)
+	{
+		__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+		__m128i low = _mm_unpacklo_epi8(bytes, zero);
+		__m128i high = _mm_unpackhi_epi8(bytes, zero);
+		
+		_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)), scale));
+		_mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)), scale));
+		_mm_storeu_ps(dst + i + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)), scale));
+		_mm_storeu_ps(dst + i + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero)), scale));
+	}
+	
+	for (; i < count; ++i)
+		dst[i] = src[i] * (1.f / 255.f);
+}
+
+/**
+ * Multiplies float covers by "factor", 4 at a time.
+ */
+inline void multiplyCovers(int count, float *covers, float factor)
+{
+	const __m128 factors = _mm_set1_ps(factor);
+	
+	int i = 0;
+	
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_ps(covers + i, _mm_mul_ps(_mm_loadu_ps(covers + i), factors));
+	
+	for (; i < count; ++i)
+		covers[i] *= factor;
+}
+
 template <class T_Filler>
 class ImageBaseRenderer8
 {
@@ -107,13 +153,12 @@ public:
 		if (newCount <= 0)
 			return;
 		
-		PixelArray<float> newCovers(newCount);
-		std::transform(covers + start - x, covers + end - x, newCovers.begin(), [](uint8_t x){
-			return x * (1.f / 255.f);
-		});
-
+		ScratchArena::Scope scratch;
+		auto newCovers = scratch.allocate<float>(newCount);
+		convertCovers(newCount, (const uint8_t *)(covers + (start - x)), (float *)newCovers);
+		
 		QPoint pos(start, y);
-		_filler->fill(pos, newCount, _bitmap.pixelPointer(pos), newCovers.begin(), _blendOp);
+		_filler->fill(pos, newCount, _bitmap.pixelPointer(pos), newCovers, _blendOp);
 	}
 	
 	void blendRasterizerLine(int x, int y, int count, uint8_t cover)
@@ -161,11 +206,8 @@ public:
 		if (newCount <= 0)
 			return;
 		
-		if (_opacity != 1) {
-			std::transform(covers, covers + count, covers, [this](float x){
-				return x * _opacity;
-			});
-		}
+		if (_opacity != 1)
+			multiplyCovers(newCount, (float *)(covers + (start - x)), _opacity);
 		
 		QPoint pos(start, y);
 		_filler->fill(pos, newCount, _bitmap.pixelPointer(pos), covers + (start - x), _blendOp);
@@ -200,5 +242,129 @@ private:
 	T_Filler *_filler;
 };
 
+/**
+ * Routes rasterizer spans of a whole surface to the tiles that own them.
+ * Spans are split at tile boundaries and each part is filled directly into the tile bitmap.
+ * Tiles are created only where spans actually exist.
+ */
+template <class T_Filler>
+class SurfaceBaseRenderer
+{
+public:
+	/**
+	 * @param keyClip Tiles outside it are not painted (painted everywhere if empty)
+	 * @param coverageMask Covers are multiplied by it (not masked if empty)
+	 */
+	SurfaceBaseRenderer(Surface *surface, const QPointSet &keyClip, const CoverageSurface &coverageMask, BlendOp *blendOp, float opacity, T_Filler *filler) :
+		_surface(surface),
+		_keyClip(keyClip),
+		_coverageMask(coverageMask),
+		_blendOp(blendOp),
+		_opacity(opacity),
+		_filler(filler)
+	{}
+	
+	void blendRasterizerSpan(int x, int y, int count, PixelIterator<float> covers)
+	{
+		if (_opacity != 1)
+			multiplyCovers(count, (float *)covers, _opacity);
+		
+		forEachTileSegment(x, y, count, [&](TileTarget &target, const QPoint &tilePos, int offset, int segmentCount) {
+			if (target.mask.isValid())
+				multiplyCoverages(segmentCount, (float *)(covers + offset), (const uint8_t *)target.mask.constPixelPointer(tilePos));
+			_filler->fill(QPoint(x + offset, y), segmentCount, target.bitmap.pixelPointer(tilePos), covers + offset, _blendOp);
+		});
+	}
+	
+	void blendRasterizerLine(int x, int y, int count, float cover)
+	{
+		cover *= _opacity;
+		
+		forEachTileSegment(x, y, count, [&](TileTarget &target, const QPoint &tilePos, int offset, int segmentCount) {
+			if (target.mask.isValid())
+			{
+				// expand the cover to a span so that it can be masked per pixel
+				ScratchArena::Scope scope;
+				auto covers = scope.allocate<float>(segmentCount);
+				std::fill((float *)covers, (float *)covers + segmentCount, cover);
+				multiplyCoverages(segmentCount, (float *)covers, (const uint8_t *)target.mask.constPixelPointer(tilePos));
+				_filler->fill(QPoint(x + offset, y), segmentCount, target.bitmap.pixelPointer(tilePos), covers, _blendOp);
+			}
+			else if (cover == 1.f)
+				_filler->fill(QPoint(x + offset, y), segmentCount, target.bitmap.pixelPointer(tilePos), _blendOp);
+			else
+				_filler->fill(QPoint(x + offset, y), segmentCount, target.bitmap.pixelPointer(tilePos), cover, _blendOp);
+		});
+	}
+	
+private:
+	
+	struct TileTarget
+	{
+		Bitmap<Pixel> bitmap;
+		CoverageImage mask;
+	};
+	
+	template <class T_Function>
+	void forEachTileSegment(int x, int y, int count, T_Function func)
+	{
+		IntDivision divisionY(y, Surface::tileWidth());
+		IntDivision divisionX(x, Surface::tileWidth());
+		
+		int keyX = divisionX.quot();
+		int tileX = divisionX.rem();
+		int offset = 0;
+		
+		while (offset < count)
+		{
+			int segmentCount = qMin(count - offset, Surface::tileWidth() - tileX);
+			
+			TileTarget *target = tileTarget(QPoint(keyX, divisionY.quot()));
+			if (target)
+				func(*target, QPoint(tileX, divisionY.rem()), offset, segmentCount);
+			
+			offset += segmentCount;
+			tileX = 0;
+			++keyX;
+		}
+	}
+	
+	TileTarget *tileTarget(const QPoint &key)
+	{
+		// spans of consecutive scanlines mostly hit the same tiles
+		auto iter = _targets.find(key);
+		if (iter != _targets.end())
+			return iter->bitmap.size().isEmpty() ? 0 : &iter.value();
+		
+		TileTarget target;
+		
+		if (_keyClip.isEmpty() || _keyClip.contains(key))
+		{
+			if (_coverageMask.isEmpty())
+			{
+				target.bitmap = _surface->tileRef(key).bitmap();
+			}
+			else
+			{
+				// tiles missing in the mask are not painted
+				target.mask = _coverageMask.tile(key, CoverageImage());
+				if (target.mask.isValid())
+					target.bitmap = _surface->tileRef(key).bitmap();
+			}
+		}
+		
+		iter = _targets.insert(key, target);
+		return iter->bitmap.size().isEmpty() ? 0 : &iter.value();
+	}
+	
+	Surface *_surface;
+	QPointSet _keyClip;
+	CoverageSurface _coverageMask;
+	BlendOp *_blendOp;
+	float _opacity;
+	T_Filler *_filler;
+	QHash<QPoint, TileTarget> _targets;
+};
+
 
 }
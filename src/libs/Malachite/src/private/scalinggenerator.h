@@ -5,6 +5,10 @@
 #include "../division.h"
 #include "../surface.h"
 #include "../image.h"
+#include "../blendop.h"
+#include "scratcharena.h"
+#include <climits>
+#include <algorithm>
 
 namespace Malachite
 {
@@ -62,17 +66,57 @@ public:
 	
 	Pixel pixel(const QPoint &p) const
 	{
-		return _src->pixel(p);
+		QPoint key, rem;
+		IntDivision::dividePoint(p, Surface::tileWidth(), &key, &rem);
+		return *(tileBitmap(key).constPixelPointer(rem));
 	}
 	
 	Pixel pixelDirect(const QPoint &p) const
 	{
-		return _src->pixel(p);
+		return pixel(p);
+	}
+	
+	/**
+	 * Reads "count" pixels of the row "y" from "x" into "dst", a tile at a time.
+	 */
+	void readRow(int x, int y, int count, PixelIterator<Pixel> dst) const
+	{
+		IntDivision divX(x, Surface::tileWidth());
+		IntDivision divY(y, Surface::tileWidth());
+		
+		int keyX = divX.quot();
+		int tileX = divX.rem();
+		
+		for (int i = 0; i < count;)
+		{
+			int segmentCount = qMin(count - i, Surface::tileWidth() - tileX);
+			auto src = tileBitmap(QPoint(keyX, divY.quot())).constPixelPointer(tileX, divY.rem());
+			std::copy(src, src + segmentCount, dst + i);
+			
+			i += segmentCount;
+			tileX = 0;
+			++keyX;
+		}
 	}
 	
 private:
 	
+	const Bitmap<const Pixel> &tileBitmap(const QPoint &key) const
+	{
+		// neighboring samples mostly hit the same tile
+		if (!_cachedTile.isValid() || key != _cachedKey)
+		{
+			_cachedKey = key;
+			_cachedTile = _src->tile(key);
+			_cachedBitmap = _cachedTile.constBitmap();
+		}
+		return _cachedBitmap;
+	}
+	
 	const Surface *_src;
+	mutable QPoint _cachedKey;
+	mutable Image _cachedTile;
+	mutable Bitmap<const Pixel> _cachedBitmap;
 };
 
 template <Malachite::SpreadType T_SpreadType>
@@ -92,6 +136,12 @@ public:
 		return _src->pixel(p);
 	}
 	
+	void readRow(int x, int y, int count, PixelIterator<Pixel> dst) const
+	{
+		for (int i = 0; i < count; ++i)
+			*(dst + i) = pixel(QPoint(x + i, y));
+	}
+	
 private:
 	
 	const Bitmap<const Pixel> *_src;
@@ -232,14 +282,17 @@ private:
 class ScalingWeightMethodBicubic
 {
 public:
+	static constexpr bool isSeparable() { return true; }
+	
 	static double weight(const Vec2D &d)
 	{
-		double dx = fabs(d.x());
-		double dy = fabs(d.y());
-		
-		double wx = dx <= 1.0 ? f01(dx) : f12(dx);
-		double wy = dy <= 1.0 ? f01(dy) : f12(dy);
-		return wx * wy;
+		return weight1D(d.x()) * weight1D(d.y());
+	}
+	
+	static double weight1D(double d)
+	{
+		d = fabs(d);
+		return d <= 1.0 ? f01(d) : f12(d);
 	}
 	
 private:
@@ -260,19 +313,27 @@ private:
 class ScalingWeightMethodLanczos2
 {
 public:
+	static constexpr bool isSeparable() { return true; }
+	
 	static double weight(const Vec2D &d)
 	{
-		Vec2D pd = M_PI * d;
-		Vec2D hpd = 0.5 * M_PI * d;
-		Vec2D dd = d * d;
+		return weight1D(d.x()) * weight1D(d.y());
+	}
+	
+	static double weight1D(double d)
+	{
+		if (d == 0)
+			return 1;
 		
-		return sin(pd.x()) * sin(hpd .x()) * sin(pd.y()) * sin(hpd.y()) / (0.25 * M_PI * M_PI * M_PI * M_PI * dd.x() * dd.y());
+		return sin(M_PI * d) * sin(0.5 * M_PI * d) / (0.5 * M_PI * M_PI * d * d);
 	}
 };
 
 class ScalingWeightMethodLanczos2Hypot
 {
 public:
+	static constexpr bool isSeparable() { return false; }
+	
 	static double weight(const Vec2D &d)
 	{
 		double dist = d.length();
@@ -280,4 +341,144 @@ public:
 	}
 };
 
+/**
+ * Fills spans with a source image scaled by a separable weight method (bicubic or Lanczos2).
+ * Only for transforms without rotation or shear, so that every span maps to a single source row position.
+ * The 4 source rows are convolved vertically once for the whole span, then each output pixel is convolved horizontally
+ * with its 4 precomputed column weights (PixelVec arithmetic processes all channels at once).
+ */
+template <class T_Source, Malachite::SpreadType T_SpreadType, class T_WeightMethod>
+class SeparableScalingFiller
+{
+	static_assert(T_WeightMethod::isSeparable(), "the weight method must be separable");
+	
+public:
+	
+	/**
+	 * @param worldTransform The transform from the destination to the source
+	 */
+	SeparableScalingFiller(const T_Source *source, const QTransform &worldTransform) :
+		_srcWrapper(source),
+		_transform(worldTransform)
+	{
+		Q_ASSERT(isApplicable(worldTransform));
+	}
+	
+	/**
+	 * The intermediate row covers every source column under the span, so heavy downscaling is left to ScalingGenerator2.
+	 */
+	static bool isApplicable(const QTransform &worldTransform)
+	{
+		return worldTransform.isAffine() && worldTransform.m12() == 0 && worldTransform.m21() == 0 && fabs(worldTransform.m11()) <= 4;
+	}
+	
+	void fill(const QPoint &pos, int count, PixelIterator<Pixel> dst, PixelIterator<float> covers, BlendOp *blendOp)
+	{
+		ScratchArena::Scope scratch;
+		auto fill = scratch.allocate<Pixel>(count);
+		generate(pos, count, fill);
+		blendOp->blend(count, dst, fill, covers);
+	}
+	
+	void fill(const QPoint &pos, int count, PixelIterator<Pixel> dst, float cover, BlendOp *blendOp)
+	{
+		ScratchArena::Scope scratch;
+		auto fill = scratch.allocate<Pixel>(count);
+		generate(pos, count, fill);
+		blendOp->blend(count, dst, fill, cover);
+	}
+	
+	void fill(const QPoint &pos, int count, PixelIterator<Pixel> dst, BlendOp *blendOp)
+	{
+		ScratchArena::Scope scratch;
+		auto fill = scratch.allocate<Pixel>(count);
+		generate(pos, count, fill);
+		blendOp->blend(count, dst, fill);
+	}
+	
+private:
+	
+	static constexpr int tapCount() { return 4; }
+	
+	/**
+	 * Computes the normalized weights of the 4 source pixels around "p" and returns the first source pixel index.
+	 */
+	static int weights(double p, float *w)
+	{
+		int first = int(round(p)) - 2;
+		float sum = 0;
+		
+		for (int i = 0; i < tapCount(); ++i)
+		{
+			w[i] = T_WeightMethod::weight1D(first + i + 0.5 - p);
+			sum += w[i];
+		}
+		
+		float inv = sum == 0 ? 0 : 1.f / sum;
+		for (int i = 0; i < tapCount(); ++i)
+			w[i] *= inv;
+		
+		return first;
+	}
+	
+	void generate(const QPoint &pos, int count, PixelIterator<Pixel> dst) const
+	{
+		ScratchArena::Scope scratch;
+		
+		// column weights for each output pixel
+		auto columnWeights = scratch.allocate<float>(count * tapCount());
+		auto columnFirsts = scratch.allocate<int>(count);
+		
+		int left = INT_MAX, right = INT_MIN;
+		
+		for (int i = 0; i < count; ++i)
+		{
+			double sx = _transform.m11() * (pos.x() + i + 0.5) + _transform.dx();
+			int first = weights(sx, (float *)(columnWeights + i * tapCount()));
+			*(columnFirsts + i) = first;
+			left = qMin(left, first);
+			right = qMax(right, first + tapCount() - 1);
+		}
+		
+		// vertical pass over every source column under the span
+		float rowWeights[tapCount()];
+		int top = weights(_transform.m22() * (pos.y() + 0.5) + _transform.dy(), rowWeights);
+		
+		int width = right - left + 1;
+		auto row = scratch.allocate<Pixel>(width);
+		auto vertical = scratch.allocate<Pixel>(width);
+		
+		for (int j = 0; j < tapCount(); ++j)
+		{
+			_srcWrapper.readRow(left, top + j, width, row);
+			
+			PixelVec w(rowWeights[j]);
+			
+			for (int k = 0; k < width; ++k)
+			{
+				if (j == 0)
+					(vertical + k)->rv() = (row + k)->v() * w;
+				else
+					(vertical + k)->rv() += (row + k)->v() * w;
+			}
+		}
+		
+		// horizontal pass
+		for (int i = 0; i < count; ++i)
+		{
+			auto src = vertical + (*(columnFirsts + i) - left);
+			auto w = columnWeights + i * tapCount();
+			
+			PixelVec sum = src->v() * PixelVec(*w);
+			for (int c = 1; c < tapCount(); ++c)
+				sum += (src + c)->v() * PixelVec(*(w + c));
+			
+			(dst + i)->rv() = sum.bound(PixelVec(0), PixelVec(1));
+		}
+	}
+	
+	SourceWrapper<T_Source, T_SpreadType> _srcWrapper;
+	QTransform _transform;
+};
+
 }
@@ -0,0 +1,51 @@
+#include <QThreadStorage>
+#include <algorithm>
+#include <cstdint>
+#include "scratcharena.h"
+
+namespace Malachite
+{
+
+static QThreadStorage<ScratchArena *> scratchArenas;
+
+ScratchArena *ScratchArena::local()
+{
+	if (!scratchArenas.hasLocalData())
+		scratchArenas.setLocalData(new ScratchArena());
+	return scratchArenas.localData();
+}
+
+void *ScratchArena::allocateBytes(size_t size)
+{
+	size = (size + alignment() - 1) & ~(alignment() - 1);
+	
+	// block bases are aligned, so aligned offsets stay aligned
+	if (_blockIndex < 0 || _offset + size > _blocks[_blockIndex].size)
+	{
+		// find the next retained block large enough, or add one
+		++_blockIndex;
+		while (_blockIndex < int(_blocks.size()) && _blocks[_blockIndex].size < size)
+			++_blockIndex;
+		
+		if (_blockIndex == int(_blocks.size()))
+		{
+			Block block;
+			block.size = std::max(blockSize(), size);
+			
+			// operator new does not guarantee 16-byte alignment, so the base is rounded up within a padded block
+			block.data.reset(new char[block.size + alignment() - 1]);
+			auto address = reinterpret_cast<std::uintptr_t>(block.data.get());
+			block.base = reinterpret_cast<char *>((address + alignment() - 1) & ~std::uintptr_t(alignment() - 1));
+			
+			_blocks.push_back(std::move(block));
+		}
+		
+		_offset = 0;
+	}
+	
+	auto p = _blocks[_blockIndex].base + _offset;
+	_offset += size;
+	return p;
+}
+
+}
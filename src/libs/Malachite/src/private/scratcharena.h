@@ -0,0 +1,86 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "../pixeliterator.h"
+
+namespace Malachite
+{
+
+/**
+ * A per-thread bump allocator for the temporary cover and pixel buffers of the paint engines.
+ * Memory is reused across draws and never returned to the heap while the thread lives.
+ * Allocations are released by the innermost Scope in LIFO order.
+ */
+class ScratchArena
+{
+public:
+	
+	/**
+	 * Restores the arena to its state at construction on destruction.
+	 */
+	class Scope
+	{
+	public:
+		Scope() :
+			_arena(ScratchArena::local()),
+			_blockIndex(_arena->_blockIndex),
+			_offset(_arena->_offset)
+		{}
+		
+		~Scope()
+		{
+			_arena->_blockIndex = _blockIndex;
+			_arena->_offset = _offset;
+		}
+		
+		template <class T>
+		PixelIterator<T> allocate(int count)
+		{
+			return _arena->allocate<T>(count);
+		}
+		
+	private:
+		ScratchArena *_arena;
+		int _blockIndex;
+		size_t _offset;
+	};
+	
+	/**
+	 * @return The arena of the current thread
+	 */
+	static ScratchArena *local();
+	
+	/**
+	 * Allocates uninitialized memory aligned to 16 bytes (for SSE).
+	 */
+	template <class T>
+	PixelIterator<T> allocate(int count)
+	{
+		auto p = reinterpret_cast<T *>(allocateBytes(count * sizeof(T)));
+		return makePixelIterator(p, count);
+	}
+	
+	static constexpr size_t blockSize() { return 64 * 1024; }
+	
+private:
+	
+	ScratchArena() = default;
+	
+	void *allocateBytes(size_t size);
+	
+	static constexpr size_t alignment() { return 16; }
+	
+	struct Block
+	{
+		std::unique_ptr<char[]> data;
+		char *base; // "data" rounded up to alignment()
+		size_t size;
+	};
+	
+	std::vector<Block> _blocks;
+	int _blockIndex = -1;
+	size_t _offset = 0;
+};
+
+}
@@ -4,6 +4,7 @@
 #include "./misc.h"
 #include "./painter.h"
 #include "./surfacepainter.h"
+#include "brushfill.h"
 #include "surfacepaintengine.h"
 
 namespace Malachite
@@ -33,63 +34,78 @@ bool SurfacePaintEngine::flush()
 
 void SurfacePaintEngine::drawPreTransformedPolygons(const FixedMultiPolygon &polygons)
 {
-	QRect boundingRect = polygons.boundingRect().toAlignedRect();
+	// rasterize the whole shape once and route the spans to the tiles
+	agg::rasterizer_scanline_aa<> ras;
+	addPolygonsToRasterizer(&ras, polygons);
 	
-	QPointSet keys = Surface::rectToKeys(boundingRect);
+	drawWithBrush(&ras, SurfaceFillTarget(_surface, _keyClip, _coverageMask, BlendMode(state()->blendMode).op(), state()->opacity), *state());
+}
+
+void SurfacePaintEngine::drawPreTransformedImage(const QPoint &point, const Image &image)
+{
+	drawPreTransformedImage(point, image, image.rect());
+}
+
+void SurfacePaintEngine::drawPreTransformedImage(const QPoint &point, const Image &image, const QRect &imageMaskRect)
+{
+	BlendOp *op = BlendMode(state()->blendMode).op();
+	if (!op)
+		return;
+	
+	QRect srcRect = (image.rect() & imageMaskRect).translated(point);
+	
+	QPointSet keys = Surface::rectToKeys(srcRect);
 	if (!_keyClip.isEmpty())
 		keys &= _keyClip;
 	
+	float opacity = state()->opacity;
+	
+	// blend straight into the tile bitmaps instead of setting up a painter for each tile
 	for (const QPoint &key : keys)
 	{
-		FixedMultiPolygon rectShape = FixedPolygon::fromRect(Surface::keyToRect(key));
-		FixedMultiPolygon clippedShape = rectShape & polygons;
+		QPoint delta = key * Surface::tileWidth();
+		QRect targetRect = srcRect.translated(-delta) & QRect(QPoint(), Surface::tileSize());
 		
-		QPoint delta = -key * Surface::tileWidth();
+		if (targetRect.isEmpty())
+			continue;
 		
-		clippedShape.translate(delta);
+		CoverageImage mask;
+		if (!maskTile(key, &mask))
+			continue;
 		
-		Painter painter(&_surface->tileRef(key));
-		*painter.state() = *state();
-		painter.setShapeTransform(state()->shapeTransform * QTransform::fromTranslate(delta.x(), delta.y()));
+		auto bitmap = _surface->tileRef(key).bitmap();
 		
-		painter.drawPreTransformedPolygons(clippedShape);
+		for (int y = targetRect.top(); y <= targetRect.bottom(); ++y)
+		{
+			QPoint p(targetRect.left(), y);
+			blendRow(op, bitmap, mask, p, targetRect.width(), image.constPixelPointer(p + delta - point), opacity);
+		}
 	}
 }
 
-void SurfacePaintEngine::drawPreTransformedImage(const QPoint &point, const Image &image)
+bool SurfacePaintEngine::maskTile(const QPoint &key, CoverageImage *mask) const
 {
-	QPointSet keys = Surface::rectToKeys(QRect(point, image.size()));
-	if (!_keyClip.isEmpty())
-		keys &= _keyClip;
+	if (_coverageMask.isEmpty())
+		return true;
 	
-	for (const QPoint &key : keys)
-	{
-		Painter painter(&_surface->tileRef(key));
-		*painter.state() = *state();
-		painter.drawPreTransformedImage(point - key * Surface::tileWidth(), image);
-	}
+	*mask = _coverageMask.tile(key, CoverageImage());
+	return mask->isValid();
 }
 
-void SurfacePaintEngine::drawPreTransformedImage(const QPoint &point, const Image &image, const QRect &imageMaskRect)
+void SurfacePaintEngine::blendRow(BlendOp *op, Bitmap<Pixel> &bitmap, const CoverageImage &mask, const QPoint &pos, int count, PixelIterator<const Pixel> src, float opacity)
 {
-	QPointSet keys = Surface::rectToKeys((imageMaskRect & image.rect()).translated(point));
-	if (!_keyClip.isEmpty())
-		keys &= _keyClip;
-	
-	for (const QPoint &key : keys)
-	{
-		Painter painter(&_surface->tileRef(key));
-		*painter.state() = *state();
-		
-		QPoint delta = key * Surface::tileWidth();
-		
-		painter.drawPreTransformedImage(point - delta, image, imageMaskRect.translated(-delta));
-	}
+	if (mask.isValid())
+		op->blend(count, bitmap.pixelPointer(pos), src, (const uint8_t *)mask.constPixelPointer(pos), opacity);
+	else if (opacity == 1.0)
+		op->blend(count, bitmap.pixelPointer(pos), src);
+	else
+		op->blend(count, bitmap.pixelPointer(pos), src, opacity);
 }
 
 void SurfacePaintEngine::drawPreTransformedSurface(const QPoint &point, const Surface &surface)
 {
-	if (point == QPoint())
+	// tiles can be replaced as a whole only when nothing is masked
+	if (point == QPoint() && _coverageMask.isEmpty())
 	{
 		auto drawTile = [=](const QPoint &key, const QRect &rect)
 		{
@@ -139,8 +155,33 @@ void SurfacePaintEngine::drawPreTransformedSurface(const QPoint &point, const Su
 	}
 	else
 	{
-		for (const QPoint &key : surface.keys())
-			drawPreTransformedImage(point + key * Surface::tileWidth(), surface.tile(key));
+		BlendOp *op = state()->blendMode.op();
+		if (!op)
+			return;
+
+		float opacity = state()->opacity;
+
+		// read the shifted surface per destination tile, so only the clipped tiles are visited
+		SurfaceOffsetView view(surface, point);
+		QPointSet keys = _keyClip.isEmpty() ? view.keys() : _keyClip;
+
+		for (const QPoint &key : keys)
+		{
+			CoverageImage mask;
+			if (!maskTile(key, &mask))
+				continue;
+
+			Bitmap<Pixel> bitmap;
+
+			view.forEachSourceTile(key, [&](const Image &sourceTile, const QRect &targetRect, const QPoint &sourcePos)
+			{
+				if (bitmap.size().isEmpty())
+					bitmap = _surface->tileRef(key).bitmap();
+
+				for (int y = 0; y < targetRect.height(); ++y)
+					blendRow(op, bitmap, mask, targetRect.topLeft() + QPoint(0, y), targetRect.width(), sourceTile.constPixelPointer(sourcePos + QPoint(0, y)), opacity);
+			});
+		}
 	}
 }
 
@@ -3,6 +3,7 @@
 #include <QPaintEngine>
 #include "../surface.h"
 #include "../paintengine.h"
+#include "../coverage.h"
 
 namespace Malachite
 {
@@ -29,11 +30,22 @@ public:
 	void setKeyRectClip(const QHash<QPoint, QRect> &keyRectClip) { _keyRectClip = keyRectClip; _keyClip = keyRectClip.keys().toSet(); }
 	QHash<QPoint, QRect> keyRectClip() const { return _keyRectClip; }
 	
+	void setCoverageMask(const CoverageSurface &mask) { _coverageMask = mask; }
+	CoverageSurface coverageMask() const { return _coverageMask; }
+	
 private:
 	
+	/**
+	 * @return false if the tile "key" is masked out entirely
+	 */
+	bool maskTile(const QPoint &key, CoverageImage *mask) const;
+	
+	static void blendRow(BlendOp *op, Bitmap<Pixel> &bitmap, const CoverageImage &mask, const QPoint &pos, int count, PixelIterator<const Pixel> src, float opacity);
+	
 	Surface *_surface = 0;
 	QPointSet _keyClip;
 	QHash<QPoint, QRect> _keyRectClip;
+	CoverageSurface _coverageMask;
 };
 
 }
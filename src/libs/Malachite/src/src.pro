@@ -9,7 +9,7 @@ DEFINES += MALACHITE_LIBRARY
 
 include(../malachite.pri)
 
-LIBS += -lfreeimage
+LIBS += -lfreeimage -lpng -ljpeg
 
 # Input
 HEADERS += bitmap.h \
@@ -17,6 +17,7 @@ HEADERS += bitmap.h \
            blendop.h \
            brush.h \
            color.h \
+           coverage.h \
            colorgradient.h \
            container.h \
            curves.h \
@@ -27,6 +28,7 @@ HEADERS += bitmap.h \
            global.h \
            image.h \
            imageio.h \
+           imagestreamwriter.h \
            misc.h \
            paintable.h \
            paintengine.h \
@@ -46,11 +48,13 @@ HEADERS += bitmap.h \
            private/agg_rasterizer_sl_clip.h \
            private/agg_scanline_p.h \
            private/clipper.hpp \
+    private/brushfill.h \
     private/filler.h \
     private/gradientgenerator.h \
     private/imagepaintengine.h \
     private/renderer.h \
     private/scalinggenerator.h \
+    private/scratcharena.h \
     private/surfacepaintengine.h \
     vector_generic.h \
     vector_sse.h \
@@ -69,12 +73,14 @@ SOURCES += blendmode.cpp \
            blendop.cpp \
            brush.cpp \
            color.cpp \
+           coverage.cpp \
            colorgradient.cpp \
            curves.cpp \
            curvesubdivision.cpp \
            fixedpolygon.cpp \
            image.cpp \
            imageio.cpp \
+           imagestreamwriter.cpp \
            misc.cpp \
            paintengine.cpp \
            painter.cpp \
@@ -85,5 +91,6 @@ SOURCES += blendmode.cpp \
            private/clipper.cpp \
     private/imagepaintengine.cpp \
     private/renderer.cpp \
+    private/scratcharena.cpp \
     private/surfacepaintengine.cpp
 RESOURCES += resources.qrc
@@ -13,6 +13,66 @@ PaintEngine *Surface::createPaintEngine()
 	return new SurfacePaintEngine();
 }
 
+QPointSet SurfaceOffsetView::keys() const
+{
+	if (isTileAligned())
+	{
+		QPointSet keys;
+		keys.reserve(_surface.tileCount());
+		for (auto iter = _surface.begin(); iter != _surface.end(); ++iter)
+			keys << iter.key() + _keyOffset;
+		return keys;
+	}
+
+	return Surface::offsetKeys(_surface.keys(), offset());
+}
+
+Image SurfaceOffsetView::tile(const QPoint &key) const
+{
+	if (isTileAligned())
+		return _surface.tile(key - _keyOffset);
+
+	Image result;
+
+	forEachSourceTile(key, [&](const Image &sourceTile, const QRect &targetRect, const QPoint &sourcePos)
+	{
+		if (!result.isValid())
+			result = Surface::createTile();
+
+		auto bitmap = result.bitmap();
+
+		for (int y = 0; y < targetRect.height(); ++y)
+		{
+			auto sp = sourceTile.constPixelPointer(sourcePos + QPoint(0, y));
+			std::copy(sp, sp + targetRect.width(), bitmap.pixelPointer(targetRect.topLeft() + QPoint(0, y)));
+		}
+	});
+
+	return result.isValid() ? result : Surface::defaultTile();
+}
+
+Surface SurfaceOffsetView::toSurface() const
+{
+	Surface surface;
+
+	if (isTileAligned())
+	{
+		// only the keys change
+		for (auto iter = _surface.begin(); iter != _surface.end(); ++iter)
+			surface.setTile(iter.key() + _keyOffset, iter.value());
+		return surface;
+	}
+
+	for (const QPoint &key : keys())
+	{
+		auto image = tile(key);
+		if (!image.isBlank())
+			surface.setTile(key, image);
+	}
+
+	return surface;
+}
+
 QDataStream &operator<<(QDataStream &out, const Surface &surface)
 {
 	out << quint64(surface.tileWidth());
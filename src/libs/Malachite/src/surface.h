@@ -56,6 +56,85 @@ private:
 	QSet<QPoint> _editedKeys;
 };
 
+/**
+ * The SurfaceOffsetView is a Surface moved by an integer offset without rearranging its tiles.
+ *
+ * Moving the view only changes the offset.
+ * A tile of the view is read from the (at most 4) source tiles it overlaps,
+ * and toSurface() rearranges the data physically only when it is needed.
+ */
+class MALACHITESHARED_EXPORT SurfaceOffsetView
+{
+public:
+
+	SurfaceOffsetView() {}
+	SurfaceOffsetView(const Surface &surface, const QPoint &offset = QPoint()) :
+		_surface(surface)
+	{
+		setOffset(offset);
+	}
+
+	Surface source() const { return _surface; }
+
+	QPoint offset() const { return _keyOffset * Surface::tileWidth() + _shift; }
+	void setOffset(const QPoint &offset) { IntDivision::dividePoint(offset, Surface::tileWidth(), &_keyOffset, &_shift); }
+	void translate(const QPoint &delta) { setOffset(offset() + delta); }
+
+	/**
+	 * @return Whether the offset is a multiple of the tile width (every tile of the view is a source tile)
+	 */
+	bool isTileAligned() const { return _shift == QPoint(); }
+
+	QPointSet keys() const;
+
+	/**
+	 * @return The tile of the view at "key" (the source tile itself if the view is tile-aligned)
+	 */
+	Image tile(const QPoint &key) const;
+
+	/**
+	 * Calls func(const Image &sourceTile, const QRect &targetRect, const QPoint &sourcePos)
+	 * for each source tile overlapping the tile "key" of the view.
+	 * targetRect is relative to the view tile and sourcePos is the pixel of sourceTile at targetRect.topLeft().
+	 */
+	template <class TFunction>
+	void forEachSourceTile(const QPoint &key, TFunction func) const
+	{
+		constexpr int tileWidth = Surface::tileWidth();
+		QPoint sourceKey = key - _keyOffset;
+
+		int countX = _shift.x() ? 2 : 1;
+		int countY = _shift.y() ? 2 : 1;
+
+		for (int i = 0; i < countY; ++i)
+		{
+			for (int j = 0; j < countX; ++j)
+			{
+				QPoint k = sourceKey - QPoint(j, i);
+				auto sourceTile = _surface.tile(k, Image());
+				if (!sourceTile.isValid())
+					continue;
+
+				// the source tile k is at (k - sourceKey) * tileWidth + _shift relative to the view tile
+				QPoint pos = (k - sourceKey) * tileWidth + _shift;
+				QRect targetRect = QRect(pos, Surface::tileSize()) & QRect(QPoint(), Surface::tileSize());
+				func(sourceTile, targetRect, targetRect.topLeft() - pos);
+			}
+		}
+	}
+
+	/**
+	 * Rearranges the tiles physically.
+	 * Blank tiles are not included.
+	 */
+	Surface toSurface() const;
+
+private:
+
+	Surface _surface;
+	QPoint _keyOffset, _shift;
+};
+
 MALACHITESHARED_EXPORT QDataStream &operator<<(QDataStream &out, const Surface &surface);
 MALACHITESHARED_EXPORT QDataStream &operator>>(QDataStream &in, Surface &surfaceOut);
 
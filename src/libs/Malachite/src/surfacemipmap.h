@@ -54,6 +54,50 @@ struct MipmapPixelTraits<BgraPremultU8>
 	}
 };
 
+/**
+ * Downsamples a rect of a tile into the next mipmap level, pixel by pixel with TMipmapPixelTraits::average.
+ * Specialize this for tile types that can be downsampled faster as a whole.
+ */
+template <class TImage, class TMipmapPixelTraits>
+struct MipmapTileDownsampler
+{
+	/**
+	 * @param dstTopLeft The top left of the rect to write in "dst"
+	 * @param srcTopLeft The top left of the corresponding rect (twice as large) in "src"
+	 * @param size The size of the rect in "dst"
+	 */
+	static void downsample(TImage &dst, const QPoint &dstTopLeft, const TImage &src, const QPoint &srcTopLeft, const QSize &size)
+	{
+		for (int ycount = 0; ycount < size.height(); ++ycount)
+		{
+			auto dstPos = dstTopLeft + QPoint(0, ycount);
+			auto srcPos0 = srcTopLeft + QPoint(0, 2 * ycount);
+			auto srcPos1 = srcPos0 + QPoint(0, 1);
+			auto dstScanline = dst.pixelPointer(dstPos);
+			auto srcScanline0 = src.constPixelPointer(srcPos0);
+			auto srcScanline1 = src.constPixelPointer(srcPos1);
+
+			for (int xcount = 0; xcount < size.width(); ++xcount)
+			{
+				std::array<typename TImage::PixelType, 4> srcs;
+				srcs[0] = *srcScanline0++;
+				srcs[1] = *srcScanline0++;
+				srcs[2] = *srcScanline1++;
+				srcs[3] = *srcScanline1++;
+				*dstScanline = TMipmapPixelTraits::average(srcs);
+				dstScanline++;
+			}
+		}
+	}
+};
+
+/**
+ * The SurfaceMipmap holds a pyramid of downsampled surfaces of level 0.
+ *
+ * Upper levels are computed lazily: an update of level 0 only marks the affected tiles of each level dirty,
+ * and dirty tiles are downsampled when they are requested with surface(level, rect).
+ * Levels that have not been used recently can be released and are computed again on demand.
+ */
 template <
 	class TSurface,
 	class TMipmapPixelTraits = MipmapPixelTraits<typename TSurface::PixelType>,
@@ -68,28 +112,32 @@ public:
 	constexpr static int depth() { return TDepth; }
 
 	SurfaceMipmap() :
-		mSurfaces(depth())
+		mSurfaces(depth()),
+		mDirtyRects(depth()),
+		mLastUsed(depth(), 0)
 	{
 	}
 
 	void setSceneSize(const QSize &size)
 	{
 		constexpr auto tileWidth = TSurface::tileWidth();
+		mSceneRect = QRect(QPoint(), size);
 		mTileCountX = (size.width() - 1) / tileWidth + 1;
 		mTileCountY = (size.height() - 1) / tileWidth + 1;
-		mMaxUpToDateLevels.resize(mTileCountX * mTileCountY);
-		mMaxUpToDateLevels.fill(0);
-		update(mCurrentLevel);
+
+		for (int level = 1; level < mSurfaces.size(); ++level)
+			markLevelDirty(level);
 	}
 
+	/**
+	 * Marks "level" as the most recently used level.
+	 * Nothing is computed until the level is requested with surface().
+	 */
 	void setCurrentLevel(int level)
 	{
-		if (mCurrentLevel != level)
-		{
-			extendSurfaceVector(level);
-			mCurrentLevel = level;
-			update(level);
-		}
+		extendLevels(level);
+		mCurrentLevel = level;
+		touch(level);
 	}
 
 	int currentLevel() const { return mCurrentLevel; }
@@ -103,26 +151,54 @@ public:
 			mSurfaces[0].tileRef(key).paste(image, relativePos);
 		}
 
-		auto globalRect = QRect(relativePos, size).translated(key * TSurface::tileWidth());
+		markDirty(QRect(relativePos, size).translated(key * TSurface::tileWidth()));
+	}
 
-		update(globalRect, 0, mCurrentLevel);
+	/**
+	 * Lets "write" modify the level-0 tile of "key" in place and marks the upper levels dirty.
+	 * @param key The tile key
+	 * @param relativeRect The region "write" modifies (relative to the tile)
+	 * @param write A function that takes typename TSurface::ImageType &
+	 */
+	template <class TWriter>
+	void modify(const QPoint &key, const QRect &relativeRect, const TWriter &write)
+	{
+		write(mSurfaces[0].tileRef(key));
 
-		mMaxUpToDateLevels[indexFromKey(key)] = mCurrentLevel;
+		markDirty(relativeRect.translated(key * TSurface::tileWidth()));
 	}
 
 	void replace(const TSurface &surface, const QPointSet &keys)
 	{
 		mSurfaces[0].replace(surface, keys);
-		for (const auto &key : keys) {
-			auto rect = QRect(key * TSurface::tileWidth(), TSurface::tileSize());
-			update(rect, 0, mCurrentLevel);
-			mMaxUpToDateLevels[indexFromKey(key)] = mCurrentLevel;
-		}
+		for (const auto &key : keys)
+			markDirty(TSurface::keyToRect(key));
 	}
 
-	TSurface surface() const
+	/**
+	 * @return The surface of the current level, with every tile up to date
+	 */
+	TSurface surface()
 	{
-		return mSurfaces.at(mCurrentLevel);
+		return surface(mCurrentLevel, mSceneRect);
+	}
+
+	/**
+	 * Brings the tiles of "level" that cover "sceneRect" up to date.
+	 * @param sceneRect The rect in level-0 coordinates
+	 * @return The surface of "level" (tiles outside "sceneRect" may be out of date)
+	 */
+	TSurface surface(int level, const QRect &sceneRect)
+	{
+		extendLevels(level);
+		touch(level);
+
+		auto rect = rectForLevel(sceneRect & mSceneRect, level);
+		if (level > 0) {
+			for (const auto &key : TSurface::rectToKeys(rect))
+				updateTile(level, key);
+		}
+		return mSurfaces.at(level);
 	}
 
 	TSurface baseSurface() const
@@ -130,48 +206,156 @@ public:
 		return mSurfaces.at(0);
 	}
 
+	/**
+	 * @return The surface of "level" as it is (it may be out of date)
+	 */
+	TSurface levelSurface(int level) const
+	{
+		return mSurfaces.value(level);
+	}
+
+	int levelCount() const { return mSurfaces.size(); }
+
+	/**
+	 * Frees an upper level. It is computed again when it is requested.
+	 */
+	void releaseLevel(int level)
+	{
+		if (level <= 0 || level >= mSurfaces.size())
+			return;
+		mSurfaces[level] = TSurface();
+		markLevelDirty(level);
+	}
+
+	/**
+	 * Frees the upper levels except the "keepCount" most recently used ones.
+	 */
+	void releaseUnusedLevels(int keepCount)
+	{
+		QVector<int> levels;
+		for (int level = 1; level < mSurfaces.size(); ++level) {
+			if (mSurfaces.at(level).tileCount())
+				levels << level;
+		}
+
+		std::sort(levels.begin(), levels.end(), [this](int a, int b) {
+			return mLastUsed.at(a) > mLastUsed.at(b);
+		});
+
+		for (int i = keepCount; i < levels.size(); ++i)
+			releaseLevel(levels.at(i));
+	}
+
+	/**
+	 * Frees the upper levels except the current level.
+	 */
+	void releaseUpperLevels()
+	{
+		for (int level = 1; level < mSurfaces.size(); ++level) {
+			if (level != mCurrentLevel)
+				releaseLevel(level);
+		}
+	}
+
 private:
 
-	void update(const QRect &rect, int alreadyUpToDateLevel, int maxLevel)
+	void extendLevels(int maxLevel)
+	{
+		int count = mSurfaces.size();
+		if (count > maxLevel)
+			return;
+
+		mSurfaces.resize(maxLevel + 1);
+		mDirtyRects.resize(maxLevel + 1);
+		mLastUsed.resize(maxLevel + 1);
+		for (int level = count; level <= maxLevel; ++level)
+			markLevelDirty(level);
+	}
+
+	void touch(int level)
+	{
+		mLastUsed[level] = ++mUseCount;
+	}
+
+	/**
+	 * Marks a rect of level 0 dirty in every upper level.
+	 */
+	void markDirty(const QRect &rect)
 	{
 		auto rectForLevel = rect;
 
-		for (int level = 0; level <= maxLevel; ++level) {
-			if (level > alreadyUpToDateLevel)
-				updateMipmap(mSurfaces[level], rectForLevel, mSurfaces[level - 1]);
+		for (int level = 1; level < mSurfaces.size(); ++level) {
 			rectForLevel = alignedHalfRect(rectForLevel);
+			if (rectForLevel.isEmpty())
+				break;
+			// a rect inside one tile stays inside one tile when halved
+			auto key = QPoint(rectForLevel.left() / TSurface::tileWidth(), rectForLevel.top() / TSurface::tileWidth());
+			mDirtyRects[level][key] |= rectForLevel;
 		}
 	}
 
-	void update(int maxLevel)
+	void markLevelDirty(int level)
 	{
-		Q_ASSERT(mSurfaces.size() > maxLevel);
-
-		constexpr auto tileWidth = TSurface::tileWidth();
+		auto &dirtyRects = mDirtyRects[level];
+		dirtyRects.clear();
 
-		for (auto tileY = 0; tileY < mTileCountY; ++tileY)
-		{
-			for (auto tileX = 0; tileX < mTileCountX; ++tileX)
-			{
-				auto key = QPoint(tileX, tileY);
-				auto alreadyUpToDateLevel = mMaxUpToDateLevels[indexFromKey(key)];
+		if (mSceneRect.isEmpty())
+			return;
 
-				auto rect = QRect(key * tileWidth, QSize(tileWidth, tileWidth));
-				update(rect, alreadyUpToDateLevel, maxLevel);
+		int countX = ((mTileCountX - 1) >> level) + 1;
+		int countY = ((mTileCountY - 1) >> level) + 1;
 
-				// set max up-to-date level if needed
-				if (alreadyUpToDateLevel < maxLevel)
-					mMaxUpToDateLevels[indexFromKey(key)] = maxLevel;
+		for (int y = 0; y < countY; ++y) {
+			for (int x = 0; x < countX; ++x) {
+				auto key = QPoint(x, y);
+				dirtyRects.insert(key, TSurface::keyToRect(key));
 			}
 		}
 	}
 
-	int indexFromKey(const QPoint &key) { return key.y() * mTileCountX + key.x(); }
-
-	void extendSurfaceVector(int max)
+	/**
+	 * Downsamples the dirty region of a tile, updating the tiles it depends on first.
+	 */
+	void updateTile(int level, const QPoint &key)
 	{
-		if (mSurfaces.size() <= max)
-			mSurfaces.resize(max + 1);
+		auto &dirtyRects = mDirtyRects[level];
+		auto iter = dirtyRects.find(key);
+		if (iter == dirtyRects.end())
+			return;
+
+		auto rect = iter.value();
+		dirtyRects.erase(iter);
+
+		auto srcRect = QRect(rect.topLeft() * 2, rect.size() * 2);
+		auto srcKeys = TSurface::rectToKeys(srcRect);
+
+		if (level > 1) {
+			for (const auto &srcKey : srcKeys)
+				updateTile(level - 1, srcKey);
+		}
+
+		auto &src = mSurfaces[level - 1];
+		auto &dst = mSurfaces[level];
+
+		// tiles of empty regions stay empty (the default pixels average to the default pixel)
+		bool hasSource = std::any_of(srcKeys.begin(), srcKeys.end(), [&](const QPoint &srcKey) {
+			return src.contains(srcKey);
+		});
+		if (!hasSource && rect == TSurface::keyToRect(key)) {
+			dst.remove(key);
+			return;
+		}
+
+		// each source tile covers one quadrant of the tile
+		constexpr auto tileWidthHalf = TSurface::tileWidth() / 2;
+
+		for (int y = 0; y < 2; ++y) {
+			for (int x = 0; x < 2; ++x) {
+				auto quadrant = QRect(key * TSurface::tileWidth() + QPoint(x, y) * tileWidthHalf, QSize(tileWidthHalf, tileWidthHalf)) & rect;
+				if (!quadrant.isEmpty())
+					updateMipmap(dst, quadrant, src);
+			}
+		}
 	}
 
 	static void updateMipmap(TSurface &dst, const QRect &dstRect, const TSurface &src)
@@ -188,26 +372,7 @@ private:
 		auto dstTopLeft = QPoint(dstRect.left() % tileWidth, dstRect.top() % tileWidth);
 		auto srcTopLeft = QPoint(dstRect.left() % tileWidthHalf, dstRect.top() % tileWidthHalf) * 2;
 
-		for (int ycount = 0; ycount < dstRect.height(); ++ycount)
-		{
-			auto dstPos = dstTopLeft + QPoint(0, ycount);
-			auto srcPos0 = srcTopLeft + QPoint(0, 2 * ycount);
-			auto srcPos1 = srcPos0 + QPoint(0, 1);
-			auto dstScanline = dstTile.pixelPointer(dstPos);
-			auto srcScanline0 = srcTile.constPixelPointer(srcPos0);
-			auto srcScanline1 = srcTile.constPixelPointer(srcPos1);
-
-			for (int xcount = 0; xcount < dstRect.width(); ++xcount)
-			{
-				std::array<typename TSurface::PixelType, 4> srcs;
-				srcs[0] = *srcScanline0++;
-				srcs[1] = *srcScanline0++;
-				srcs[2] = *srcScanline1++;
-				srcs[3] = *srcScanline1++;
-				*dstScanline = TMipmapPixelTraits::average(srcs);
-				dstScanline++;
-			}
-		}
+		MipmapTileDownsampler<typename TSurface::ImageType, TMipmapPixelTraits>::downsample(dstTile, dstTopLeft, srcTile, srcTopLeft, dstRect.size());
 	}
 
 	static QRect rectForLevel(const QRect &originalRect, int level)
@@ -221,12 +386,18 @@ private:
 	}
 
 	int mCurrentLevel = 0;
+	QRect mSceneRect;
 	int mTileCountX = 0, mTileCountY = 0;
 
-	QVector<uint8_t> mMaxUpToDateLevels;
 	QVector<TSurface> mSurfaces;
+
+	// dirty rects of each tile (in the coordinates of each level)
+	QVector<QHash<QPoint, QRect>> mDirtyRects;
+
+	// for releasing the least recently used levels
+	QVector<quint64> mLastUsed;
+	quint64 mUseCount = 0;
 };
 
 
 }
-
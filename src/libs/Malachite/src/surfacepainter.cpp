@@ -25,5 +25,14 @@ QHash<QPoint, QRect> SurfacePainter::keyRectClip() const
 	return static_cast<const SurfacePaintEngine *>(paintEngine())->keyRectClip();
 }
 
+void SurfacePainter::setCoverageMask(const CoverageSurface &mask)
+{
+	static_cast<SurfacePaintEngine *>(paintEngine())->setCoverageMask(mask);
 }
 
+CoverageSurface SurfacePainter::coverageMask() const
+{
+	return static_cast<const SurfacePaintEngine *>(paintEngine())->coverageMask();
+}
+
+}
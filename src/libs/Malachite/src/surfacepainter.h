@@ -3,6 +3,7 @@
 //ExportName: SurfacePainter
 
 #include "painter.h"
+#include "coverage.h"
 
 namespace Malachite
 {
@@ -18,6 +19,14 @@ public:
 	
 	void setKeyRectClip(const QHash<QPoint, QRect> &keyRectClip);
 	QHash<QPoint, QRect> keyRectClip() const;
+	
+	/**
+	 * Sets a soft mask that every drawing is multiplied by.
+	 * Tiles missing in the mask are not painted.
+	 * An empty surface disables the mask.
+	 */
+	void setCoverageMask(const CoverageSurface &mask);
+	CoverageSurface coverageMask() const;
 };
 
 }
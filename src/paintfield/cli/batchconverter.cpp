@@ -0,0 +1,119 @@
+#include <QtConcurrent>
+#include <QDir>
+#include <QFileInfo>
+#include <QMutex>
+
+#include "paintfield/core/formatsupport.h"
+#include "paintfield/core/paintfieldformatsupport.h"
+#include "paintfield/core/layerrenderer.h"
+#include "paintfield/core/rasterlayer.h"
+#include "paintfield/extensions/formatsupports/malachiteformatsupport.h"
+#include "paintfield/extensions/formatsupports/openrasterformatsupport.h"
+#include "paintfield/extensions/formatsupports/psdformatsupport.h"
+
+#include "batchconverter.h"
+
+namespace PaintField {
+
+struct BatchConverter::Data
+{
+	Options mOptions;
+};
+
+BatchConverter::BatchConverter(const Options &options) :
+	d(new Data)
+{
+	d->mOptions = options;
+}
+
+BatchConverter::~BatchConverter()
+{
+}
+
+QList<FormatSupport *> BatchConverter::createFormatSupports(QObject *parent)
+{
+	return {
+		new PaintFieldFormatSupport(parent),
+		new JpegFormatSupport(parent),
+		new PngFormatSupport(parent),
+		new OpenRasterFormatSupport(parent),
+		new PsdFormatSupport(parent)
+	};
+}
+
+BatchConverter::Result BatchConverter::convert(const QString &inputPath) const
+{
+	Result result;
+	result.inputPath = inputPath;
+
+	// format supports are not shared between threads
+	QObject formatParent;
+	auto formats = createFormatSupports(&formatParent);
+
+	QFileInfo inputInfo(inputPath);
+	QDir outputDir(d->mOptions.outputDir.isEmpty() ? inputInfo.path() : d->mOptions.outputDir);
+	result.outputPath = outputDir.filePath(inputInfo.completeBaseName() + "." + d->mOptions.outputSuffix);
+
+	auto outputFormat = FormatSupport::formatForPath(result.outputPath, formats);
+	if (!outputFormat) {
+		result.errorString = QObject::tr("Unknown output format.");
+		return result;
+	}
+
+	if (QFileInfo(result.outputPath).absoluteFilePath() == inputInfo.absoluteFilePath()) {
+		result.errorString = QObject::tr("The output would overwrite the input.");
+		return result;
+	}
+
+	QList<LayerRef> layers;
+	QSize size;
+	if (!FormatSupport::readFromFile(inputPath, formats, &layers, &size, &result.errorString))
+		return result;
+
+	QList<LayerConstRef> outputLayers;
+	for (const auto &layer : layers)
+		outputLayers << layer;
+
+	// single layer formats flatten the layers themselves (band by band if possible)
+	if (outputFormat->capabilities() & FormatSupport::CapabilityLayers) {
+		LayerRenderer renderer;
+		auto flattened = makeSP<RasterLayer>(inputInfo.completeBaseName());
+		flattened->setSurface(renderer.renderToSurface(outputLayers, Malachite::Surface::rectToKeys(QRect(QPoint(), size))));
+		outputLayers = { flattened };
+	}
+
+	if (!FormatSupport::writeToFile(result.outputPath, outputFormat, outputLayers, size, QVariant(), &result.errorString))
+		return result;
+
+	result.succeeded = true;
+	return result;
+}
+
+int BatchConverter::run(const QStringList &inputPaths, const std::function<void (const Result &)> &onFinished)
+{
+	QThreadPool pool;
+	pool.setMaxThreadCount(std::max(1, d->mOptions.jobCount));
+
+	QMutex mutex;
+	int failedCount = 0;
+
+	QList<QFuture<void>> futures;
+
+	for (const QString &path : inputPaths) {
+		futures << QtConcurrent::run(&pool, [&, path] {
+			auto result = convert(path);
+
+			QMutexLocker locker(&mutex);
+			if (!result.succeeded)
+				++failedCount;
+			onFinished(result);
+		});
+	}
+
+	for (auto &future : futures)
+		future.waitForFinished();
+
+	return failedCount;
+}
+
+} // namespace PaintField
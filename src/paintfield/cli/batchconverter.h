@@ -0,0 +1,60 @@
+#pragma once
+
+#include <QStringList>
+#include <QScopedPointer>
+#include <functional>
+
+namespace PaintField {
+
+class FormatSupport;
+
+/**
+ * The BatchConverter loads documents, flattens them and exports them without any GUI.
+ * Files are converted in parallel and each result is reported as soon as it is finished.
+ */
+class BatchConverter
+{
+public:
+
+	struct Options
+	{
+		QString outputDir;	// empty: next to each input
+		QString outputSuffix = "png";
+		int jobCount = 1;
+	};
+
+	struct Result
+	{
+		QString inputPath;
+		QString outputPath;
+		bool succeeded = false;
+		QString errorString;
+	};
+
+	explicit BatchConverter(const Options &options);
+	~BatchConverter();
+
+	/**
+	 * Converts the files and waits for them to finish.
+	 * @param onFinished Called for each file in the order of completion (serialized, from the worker threads)
+	 * @return The number of failed files
+	 */
+	int run(const QStringList &inputPaths, const std::function<void (const Result &)> &onFinished);
+
+	/**
+	 * Converts a single file (thread-safe).
+	 */
+	Result convert(const QString &inputPath) const;
+
+	/**
+	 * Creates the format supports that work without AppController.
+	 */
+	static QList<FormatSupport *> createFormatSupports(QObject *parent);
+
+private:
+
+	struct Data;
+	QScopedPointer<Data> d;
+};
+
+} // namespace PaintField
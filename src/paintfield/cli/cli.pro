@@ -0,0 +1,13 @@
+TEMPLATE = app
+TARGET = PaintFieldCLI
+
+CONFIG += console
+CONFIG -= app_bundle
+
+include(../paintfield-exec.pri)
+
+SOURCES += main.cpp \
+    batchconverter.cpp
+
+HEADERS += \
+    batchconverter.h
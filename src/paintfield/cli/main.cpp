@@ -0,0 +1,58 @@
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+#include <QThread>
+#include "batchconverter.h"
+
+using namespace PaintField;
+
+int main(int argc, char *argv[])
+{
+	// layers with text and shapes need fonts, but no display is required
+	if (qgetenv("QT_QPA_PLATFORM").isEmpty())
+		qputenv("QT_QPA_PLATFORM", "offscreen");
+	
+	QGuiApplication a(argc, argv);
+	a.setApplicationName("PaintFieldCLI");
+	
+	QCommandLineParser parser;
+	parser.setApplicationDescription(QObject::tr("Flattens documents and exports them."));
+	parser.addHelpOption();
+	parser.addPositionalArgument("files", QObject::tr("The documents to convert (pfield, psd, ora, png, jpg)."), "files...");
+	
+	QCommandLineOption jobsOption(QStringList() << "j" << "jobs", QObject::tr("The number of files converted in parallel."), "count", QString::number(QThread::idealThreadCount()));
+	QCommandLineOption outputOption(QStringList() << "o" << "output-dir", QObject::tr("The folder to write to (default: next to each input)."), "dir");
+	QCommandLineOption formatOption(QStringList() << "f" << "format", QObject::tr("The suffix of the output format (default: png)."), "suffix", "png");
+	parser.addOption(jobsOption);
+	parser.addOption(outputOption);
+	parser.addOption(formatOption);
+	
+	parser.process(a);
+	
+	auto inputPaths = parser.positionalArguments();
+	if (inputPaths.isEmpty())
+		parser.showHelp(1);
+	
+	BatchConverter::Options options;
+	options.jobCount = parser.value(jobsOption).toInt();
+	options.outputDir = parser.value(outputOption);
+	options.outputSuffix = parser.value(formatOption);
+	
+	QTextStream out(stdout);
+	QTextStream err(stderr);
+	
+	BatchConverter converter(options);
+	
+	int failedCount = converter.run(inputPaths, [&](const BatchConverter::Result &result) {
+		if (result.succeeded) {
+			out << result.inputPath << " -> " << result.outputPath << endl;
+		} else {
+			err << result.inputPath << ": " << result.errorString << endl;
+		}
+	});
+	
+	if (failedCount)
+		err << QObject::tr("%1 of %2 files failed.").arg(failedCount).arg(inputPaths.size()) << endl;
+	
+	return failedCount ? 1 : 0;
+}
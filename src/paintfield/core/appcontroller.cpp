@@ -13,6 +13,10 @@
 #include "documentreferencemanager.h"
 #include "blendmodetexts.h"
 #include "formatsupportmanager.h"
+#include "memoryaccountant.h"
+#include "startupprofiler.h"
+#include "dialogs/memoryusagedialog.h"
+#include "dialogs/messagebox.h"
 
 #include "appcontroller.h"
 
@@ -30,6 +34,8 @@ struct AppController::Data
 	SettingsManager *settingsManager = nullptr;
 	CursorStack *cursorStack = nullptr;
 	DocumentReferenceManager *documentReferenceManager = nullptr;
+	MemoryAccountant *memoryAccountant = nullptr;
+	StartupProfiler *startupProfiler = nullptr;
 	
 	QList<AppExtension *> extensions;
 	QList<QAction *> actions;
@@ -40,6 +46,7 @@ AppController::AppController(Application *app, QObject *parent) :
     d(new Data)
 {
 	d->app = app;
+	d->startupProfiler = new StartupProfiler(this);
 	d->formatSupportManager = new FormatSupportManager(this);
 	d->blendModeTexts = new BlendModeTexts(this);
 	d->workspaceManager = new WorkspaceManager(this);
@@ -47,6 +54,8 @@ AppController::AppController(Application *app, QObject *parent) :
 	d->settingsManager = new SettingsManager(this);
 	d->cursorStack = new CursorStack(this);
 	d->documentReferenceManager = new DocumentReferenceManager(this);
+	d->memoryAccountant = new MemoryAccountant(this);
+	connect(d->memoryAccountant, SIGNAL(budgetExceeded(qint64,qint64)), this, SLOT(onMemoryBudgetExceeded(qint64,qint64)));
 	
 	_instance = this;
 	
@@ -63,12 +72,28 @@ AppController::~AppController()
 
 void AppController::begin()
 {
-	d->settingsManager->loadSettings();
+	{
+		StartupProfiler::Scope scope(d->startupProfiler, "load settings");
+		d->settingsManager->loadSettings();
+	}
 	
-	extensionManager()->initialize(this);
-	addExtensions(extensionManager()->createAppExtensions(this, this));
+	d->memoryAccountant->setBudget(d->settingsManager->value({"memory-budget-mb"}, 0).toLongLong() * 1024 * 1024);
+	
+	{
+		StartupProfiler::Scope scope(d->startupProfiler, "initialize extensions");
+		extensionManager()->initialize(this);
+	}
+	{
+		StartupProfiler::Scope scope(d->startupProfiler, "create app extensions");
+		addExtensions(extensionManager()->createAppExtensions(this, this));
+	}
+	{
+		StartupProfiler::Scope scope(d->startupProfiler, "restore workspaces");
+		workspaceManager()->loadLastWorkspaces();
+	}
 	
-	workspaceManager()->loadLastWorkspaces();
+	// the application is ready when the event loop gets to run
+	QMetaObject::invokeMethod(d->startupProfiler, "markReady", Qt::QueuedConnection);
 }
 
 FormatSupportManager *AppController::formatSupportManager() { return d->formatSupportManager; }
@@ -78,6 +103,8 @@ ExtensionManager *AppController::extensionManager() { return d->extensionManager
 SettingsManager *AppController::settingsManager() { return d->settingsManager; }
 CursorStack *AppController::cursorStack() { return d->cursorStack; }
 DocumentReferenceManager *AppController::documentReferenceManager() { return d->documentReferenceManager; }
+MemoryAccountant *AppController::memoryAccountant() { return d->memoryAccountant; }
+StartupProfiler *AppController::startupProfiler() { return d->startupProfiler; }
 
 void AppController::addExtensions(const AppExtensionList &extensions)
 {
@@ -183,6 +210,22 @@ void AppController::openFile(const QString &path)
 	}
 }
 
+void AppController::showMemoryUsage()
+{
+	d->memoryAccountant->refresh();
+	MemoryUsageDialog dialog(d->memoryAccountant, qApp->activeWindow());
+	dialog.exec();
+}
+
+void AppController::onMemoryBudgetExceeded(qint64 usage, qint64 budget)
+{
+	auto toMB = [](qint64 bytes) { return QString::number(bytes / (1024 * 1024)); };
+	
+	MessageBox::show(QMessageBox::Warning,
+	                 tr("PaintField is using more memory than the budget (%1 MB of %2 MB).").arg(toMB(usage), toMB(budget)),
+	                 tr("Close documents you are not using or save your work to avoid running out of memory."));
+}
+
 void AppController::quit()
 {
 	d->settingsManager->saveUserSettings();
@@ -257,6 +300,8 @@ void AppController::declareMenus()
 	                                 tr("Minimize"));
 	settingsManager()->declareAction("paintfield.window.zoom",
 	                                 tr("Zoom"));
+	settingsManager()->declareAction("paintfield.window.memoryUsage",
+	                                 tr("Memory Usage..."));
 	
 	settingsManager()->declareMenu("paintfield.help",
 	                               tr("Help"));
@@ -267,6 +312,7 @@ void AppController::createActions()
 	d->actions << Util::createAction("paintfield.file.quit", d->workspaceManager, SLOT(closeAllAndQuit()));
 	d->actions << Util::createAction("paintfield.window.minimize", this, SLOT(minimizeCurrentWindow()));
 	d->actions << Util::createAction("paintfield.window.zoom", this, SLOT(zoomCurrentWindow()));
+	d->actions << Util::createAction("paintfield.window.memoryUsage", this, SLOT(showMemoryUsage()));
 	d->actions << Util::createAction("paintfield.window.newWorkspace", d->workspaceManager, SLOT(newWorkspace()));
 	
 	d->actions << new GeneralEditAction("paintfield.edit.cut", this);
@@ -21,6 +21,8 @@ class Canvas;
 class Workspace;
 class BlendModeTexts;
 class FormatSupportManager;
+class MemoryAccountant;
+class StartupProfiler;
 
 /**
  * AppController is an singleton class that manages application-wide classes.
@@ -42,6 +44,8 @@ public:
 	SettingsManager *settingsManager();
 	CursorStack *cursorStack();
 	DocumentReferenceManager *documentReferenceManager();
+	MemoryAccountant *memoryAccountant();
+	StartupProfiler *startupProfiler();
 	
 	void addExtensions(const QList<AppExtension *> &extensions);
 	QList<AppExtension *> extensions();
@@ -65,10 +69,16 @@ public slots:
 	
 	void openFile(const QString &path);
 	
+	void showMemoryUsage();
+	
 	void quit();
 	
 signals:
 	
+private slots:
+	
+	void onMemoryBudgetExceeded(qint64 usage, qint64 budget);
+	
 private:
 	
 	void declareMenus();
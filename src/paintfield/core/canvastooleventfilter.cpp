@@ -5,6 +5,7 @@
 #include "canvascursorevent.h"
 #include "tool.h"
 #include "canvas.h"
+#include "document.h"
 #include "application.h"
 #include "appcontroller.h"
 #include "util.h"
@@ -84,7 +85,8 @@ bool CanvasToolEventFilter::eventFilter(QObject *, QEvent *event)
 
 bool CanvasToolEventFilter::Data::sendCanvasTabletEvent(QTabletEvent *event)
 {
-	if (!this->tool)
+	// layers cannot be edited until their data is loaded
+	if (!this->tool || this->canvas->document()->isLoading())
 		return false;
 
 	auto toCanvasEventType = [](QEvent::Type type)
@@ -111,7 +113,8 @@ bool CanvasToolEventFilter::Data::sendCanvasTabletEvent(QTabletEvent *event)
 
 bool CanvasToolEventFilter::Data::sendCanvasTabletEvent(QMouseEvent *mouseEvent)
 {
-	if (!this->tool)
+	// layers cannot be edited until their data is loaded
+	if (!this->tool || this->canvas->document()->isLoading())
 		return false;
 
 	if (this->tabletOnProximity)
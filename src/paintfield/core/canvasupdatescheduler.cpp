@@ -0,0 +1,241 @@
+#include <QTimer>
+#include <QThread>
+#include <QElapsedTimer>
+#include <atomic>
+#include <algorithm>
+
+#include "tiledirtymap.h"
+#include "canvasupdatescheduler.h"
+
+using namespace Malachite;
+
+namespace PaintField {
+
+struct CanvasUpdateScheduler::Data
+{
+	RenderFunction renderFunction;
+
+	TileDirtyMap dirtyMap;
+	std::atomic<bool> frameRequested { false };
+
+	// owned by the scheduler's thread
+	QHash<QPoint, QRect> pendingRects;
+
+	QRect visibleKeyRect;
+	QPoint focusKey;
+	bool offscreenPaused = false;
+
+	QTimer *timer = 0;
+	QElapsedTimer sinceLastFrame;
+
+	qint64 priority(const QPoint &key) const
+	{
+		auto delta = key - focusKey;
+		return qint64(delta.x()) * delta.x() + qint64(delta.y()) * delta.y();
+	}
+
+	bool hasPendingVisibleTiles() const
+	{
+		for (auto iter = pendingRects.begin(); iter != pendingRects.end(); ++iter) {
+			if (visibleKeyRect.contains(iter.key()))
+				return true;
+		}
+		return false;
+	}
+
+	bool needsNextFrame() const
+	{
+		if (offscreenPaused)
+			return hasPendingVisibleTiles();
+		return !pendingRects.isEmpty();
+	}
+
+	/**
+	 * Takes at most "count" pending tiles with the highest priority.
+	 */
+	QHash<QPoint, QRect> takeSlice(QVector<QPoint> &orderedKeys, int count)
+	{
+		QHash<QPoint, QRect> slice;
+		while (slice.size() < count && !orderedKeys.isEmpty()) {
+			auto key = orderedKeys.takeLast();
+			auto iter = pendingRects.find(key);
+			if (iter == pendingRects.end())
+				continue;
+			slice.insert(key, iter.value());
+			pendingRects.erase(iter);
+		}
+		return slice;
+	}
+
+	/**
+	 * Renders "keys" in slices, nearest to the focus first, until "budget" ms have passed since "timer" started.
+	 */
+	QRect renderSlices(QVector<QPoint> &keys, const QElapsedTimer &timer, int budget)
+	{
+		// only the tail is consumed, so sort the best candidates to the back in batches
+		auto isLowerPriority = [this](const QPoint &a, const QPoint &b) {
+			return priority(a) > priority(b);
+		};
+
+		QRect repaintRect;
+
+		while (!keys.isEmpty() && timer.elapsed() < budget) {
+			auto batchCount = std::min(keys.size(), sliceTileCount());
+			std::nth_element(keys.begin(), keys.end() - batchCount, keys.end(), isLowerPriority);
+
+			auto slice = takeSlice(keys, batchCount);
+			if (!slice.isEmpty())
+				repaintRect |= renderFunction(slice);
+		}
+
+		return repaintRect;
+	}
+
+	void mergeDirtyTiles()
+	{
+		auto rects = dirtyMap.take();
+		for (auto iter = rects.begin(); iter != rects.end(); ++iter) {
+			auto &rect = pendingRects[iter.key()];
+			rect |= iter.value();
+		}
+	}
+};
+
+CanvasUpdateScheduler::CanvasUpdateScheduler(const RenderFunction &renderFunction, QObject *parent) :
+	QObject(parent),
+	d(new Data)
+{
+	d->renderFunction = renderFunction;
+
+	d->timer = new QTimer(this);
+	d->timer->setSingleShot(true);
+	connect(d->timer, SIGNAL(timeout()), this, SLOT(renderFrame()));
+
+	d->sinceLastFrame.start();
+}
+
+CanvasUpdateScheduler::~CanvasUpdateScheduler()
+{
+}
+
+void CanvasUpdateScheduler::setSceneSize(const QSize &size)
+{
+	d->dirtyMap.setSceneSize(size);
+	d->pendingRects.clear();
+}
+
+void CanvasUpdateScheduler::setVisibleSceneRect(const QRect &rect)
+{
+	QRect keyRect;
+	if (!rect.isEmpty())
+		keyRect = QRect(Surface::keyForPixel(rect.topLeft()), Surface::keyForPixel(rect.bottomRight()));
+
+	if (d->visibleKeyRect == keyRect)
+		return;
+
+	d->visibleKeyRect = keyRect;
+
+	// deferred tiles may have been scrolled into view
+	if (d->hasPendingVisibleTiles())
+		requestFrame();
+}
+
+void CanvasUpdateScheduler::setFocusScenePos(const QPoint &pos)
+{
+	d->focusKey = Surface::keyForPixel(pos);
+}
+
+void CanvasUpdateScheduler::setOffscreenRenderingPaused(bool paused)
+{
+	if (d->offscreenPaused == paused)
+		return;
+
+	d->offscreenPaused = paused;
+
+	if (!paused && !d->pendingRects.isEmpty())
+		requestFrame();
+}
+
+bool CanvasUpdateScheduler::isOffscreenRenderingPaused() const
+{
+	return d->offscreenPaused;
+}
+
+void CanvasUpdateScheduler::addTiles(const QPointSet &keys)
+{
+	if (keys.isEmpty())
+		return;
+	d->dirtyMap.markTiles(keys);
+	requestFrame();
+}
+
+void CanvasUpdateScheduler::addTiles(const QHash<QPoint, QRect> &rects)
+{
+	if (rects.isEmpty())
+		return;
+	d->dirtyMap.markRects(rects);
+	requestFrame();
+}
+
+bool CanvasUpdateScheduler::hasPendingTiles() const
+{
+	return !d->pendingRects.isEmpty() || d->dirtyMap.mayHaveDirtyTiles();
+}
+
+void CanvasUpdateScheduler::requestFrame()
+{
+	if (d->frameRequested.exchange(true))
+		return;
+
+	if (QThread::currentThread() == thread())
+		scheduleFrame();
+	else
+		QMetaObject::invokeMethod(this, "scheduleFrame", Qt::QueuedConnection);
+}
+
+void CanvasUpdateScheduler::scheduleFrame()
+{
+	if (d->timer->isActive())
+		return;
+
+	// render immediately after an idle period, otherwise wait for the next frame
+	auto elapsed = d->sinceLastFrame.elapsed();
+	d->timer->start(std::max(0, frameInterval() - int(elapsed)));
+}
+
+void CanvasUpdateScheduler::renderFrame()
+{
+	d->sinceLastFrame.restart();
+
+	// tiles added after this point request a new frame
+	d->frameRequested = false;
+	d->mergeDirtyTiles();
+
+	if (d->pendingRects.isEmpty())
+		return;
+
+	QElapsedTimer budgetTimer;
+	budgetTimer.start();
+
+	QVector<QPoint> visibleKeys, offscreenKeys;
+	for (auto iter = d->pendingRects.begin(); iter != d->pendingRects.end(); ++iter) {
+		if (d->visibleKeyRect.contains(iter.key()))
+			visibleKeys << iter.key();
+		else
+			offscreenKeys << iter.key();
+	}
+
+	auto repaintRect = d->renderSlices(visibleKeys, budgetTimer, renderBudget());
+
+	// offscreen tiles only get the rest of an idle frame
+	if (visibleKeys.isEmpty() && !d->offscreenPaused)
+		repaintRect |= d->renderSlices(offscreenKeys, budgetTimer, backgroundRenderBudget());
+
+	if (!repaintRect.isEmpty())
+		emit repaintRequested(repaintRect);
+
+	if (d->needsNextFrame())
+		requestFrame();
+}
+
+} // namespace PaintField
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <QObject>
+#include <QRect>
+#include <functional>
+#include <Malachite/Surface>
+
+namespace PaintField {
+
+/**
+ * The CanvasUpdateScheduler collects dirty tiles from every source (layer scene, tools) and renders them paced to the display frame rate.
+ *
+ * Tiles can be added from any thread.
+ * Once per frame, pending tiles are rendered on the scheduler's thread in slices,
+ * visible tiles nearest to the focus point first, until the frame budget runs out.
+ * The rest is carried over to the next frame, so a huge invalidation never blocks input for more than one frame.
+ *
+ * Offscreen tiles are rendered only after every visible tile is up to date, in smaller background slices.
+ * While offscreen rendering is paused they stay dirty until they are scrolled into view.
+ */
+class CanvasUpdateScheduler : public QObject
+{
+	Q_OBJECT
+
+public:
+
+	/**
+	 * Renders the given tiles and returns the view rect to be repainted.
+	 */
+	using RenderFunction = std::function<QRect (const QHash<QPoint, QRect> &)>;
+
+	CanvasUpdateScheduler(const RenderFunction &renderFunction, QObject *parent = 0);
+	~CanvasUpdateScheduler();
+
+	void setSceneSize(const QSize &size);
+
+	/**
+	 * Sets the scene rect currently visible in the view.
+	 * Tiles inside it are rendered before the others.
+	 */
+	void setVisibleSceneRect(const QRect &rect);
+
+	/**
+	 * Sets the scene position that the user is working on (usually the cursor).
+	 */
+	void setFocusScenePos(const QPoint &pos);
+
+	/**
+	 * Pauses rendering of offscreen tiles (eg while the user is stroking).
+	 */
+	void setOffscreenRenderingPaused(bool paused);
+	bool isOffscreenRenderingPaused() const;
+
+	/**
+	 * Thread-safe.
+	 */
+	void addTiles(const QPointSet &keys);
+
+	/**
+	 * Thread-safe.
+	 * @param rects Dirty regions relative to each tile
+	 */
+	void addTiles(const QHash<QPoint, QRect> &rects);
+
+	bool hasPendingTiles() const;
+
+	static constexpr int frameInterval() { return 16; }
+	static constexpr int renderBudget() { return 12; }
+	static constexpr int backgroundRenderBudget() { return 4; }
+	static constexpr int sliceTileCount() { return 8; }
+
+signals:
+
+	void repaintRequested(const QRect &viewRect);
+
+private slots:
+
+	void scheduleFrame();
+	void renderFrame();
+
+private:
+
+	void requestFrame();
+
+	struct Data;
+	QScopedPointer<Data> d;
+};
+
+} // namespace PaintField
@@ -2,6 +2,7 @@
 
 #include "appcontroller.h"
 #include "canvasviewportstate.h"
+#include "canvasupdatescheduler.h"
 #include "canvastooleventfilter.h"
 #include "canvasnavigatoreventfilter.h"
 #include "keytracker.h"
@@ -13,10 +14,12 @@
 #include "layerscene.h"
 #include "cursorstack.h"
 #include "widgets/vanishingscrollbar.h"
-#include "selection.h"
+#include "memoryaccountant.h"
 
 #include <QTimer>
 #include <QPaintEvent>
+#include <QMouseEvent>
+#include <QTabletEvent>
 #include <QPainter>
 
 #include <boost/variant.hpp>
@@ -37,12 +40,15 @@ struct CanvasViewport::Data
 	QCursor mToolCursor;
 
 	CanvasViewportState mState;
+	CanvasUpdateScheduler *mScheduler = 0;
+	bool mRendering = false;
 
 	VanishingScrollBar *mScrollBarX = 0, *mScrollBarY = 0;
 
 	void setTransforms(const SP<const CanvasTransforms> &transforms)
 	{
 		mState.setTransforms(transforms);
+		mScheduler->setVisibleSceneRect(transforms->viewToScene.mapRect(QRectF(QPoint(), transforms->viewSize)).toAlignedRect());
 
 		auto maxAbsTranslation = mCanvas->maxAbsoluteTranslation();
 		// update scroll bar range
@@ -73,6 +79,7 @@ struct CanvasViewport::Data
 	void setDocumentSize(const QSize &size)
 	{
 		mState.setDocumentSize(size);
+		mScheduler->setSceneSize(size);
 	}
 
 	void setTool(Tool *tool)
@@ -114,6 +121,8 @@ struct CanvasViewport::Data
 			} else {
 				mCanvas->enableUndoRedo();
 			}
+			// offscreen tiles wait until the stroke ends or they are scrolled into view
+			mScheduler->setOffscreenRenderingPaused(strokingOrToolEditing);
 			mStrokingOrToolEditing = strokingOrToolEditing;
 		}
 	}
@@ -139,16 +148,45 @@ struct CanvasViewport::Data
 		mCanvas->workspace()->setCurrentCanvas(mCanvas);
 	}
 
-	void updateSelectionTiles(const SelectionSurface &surface, const QPointSet &keys)
+	QRect renderTiles(const QHash<QPoint, QRect> &rects)
 	{
+		mRendering = true;
+		auto rect = mState.updateTiles(rects);
+		mRendering = false;
+		return rect;
+	}
+
+	/// called when the shared cache was updated, by this viewport or another one
+	void onCacheTilesUpdated(const QRect &sceneRect)
+	{
+		// the rendering viewport repaints through the scheduler
+		if (mRendering)
+			return;
+		auto rect = mState.invalidateSceneRect(sceneRect);
 		if (mUpdateEnabled)
-			mSelf->repaint(mState.updateSelectionTiles(surface, keys));
+			mSelf->update(rect);
 	}
 
 	void updateTiles(const boost::variant<QPointSet, QHash<QPoint, QRect>> &keysOrRectForKeys)
 	{
-		if (mUpdateEnabled)
-			mSelf->repaint(mState.updateTiles(keysOrRectForKeys));
+		if (!mUpdateEnabled)
+			return;
+
+		// composited once in the shared cache, on the next frame of whichever viewport renders them first
+		if (keysOrRectForKeys.which() == 0) {
+			auto keys = boost::get<QPointSet>(keysOrRectForKeys);
+			mState.cache()->markDirty(keys);
+			mScheduler->addTiles(keys);
+		} else {
+			auto rects = boost::get<QHash<QPoint, QRect>>(keysOrRectForKeys);
+			mState.cache()->markDirty(rects);
+			mScheduler->addTiles(rects);
+		}
+	}
+
+	void setFocusWindowPos(const QPointF &pos)
+	{
+		mScheduler->setFocusScenePos((pos * mCanvas->transforms()->windowToScene).toPoint());
 	}
 };
 
@@ -221,6 +259,24 @@ bool CanvasViewport::event(QEvent *event)
 	return QWidget::event(event);
 }
 
+bool CanvasViewport::eventFilter(QObject *watched, QEvent *event)
+{
+	// installed last so that it sees cursor moves before the tool consumes them
+	if (watched == this) {
+		switch (event->type()) {
+			case QEvent::TabletMove:
+				d->setFocusWindowPos(static_cast<QTabletEvent *>(event)->posF());
+				break;
+			case QEvent::MouseMove:
+				d->setFocusWindowPos(static_cast<QMouseEvent *>(event)->localPos());
+				break;
+			default:
+				break;
+		}
+	}
+	return false;
+}
+
 CanvasViewport::CanvasViewport(Canvas *canvas, QWidget *parent) :
 	QWidget(parent),
 	d(new Data)
@@ -229,7 +285,17 @@ CanvasViewport::CanvasViewport(Canvas *canvas, QWidget *parent) :
 
 	d->mSelf = this;
 	d->mCanvas = canvas;
-	d->mState.setCanvas(canvas);
+	d->mState.setCache(CanvasViewportCache::forDocument(canvas->document()));
+	connect(d->mState.cache().get(), &CanvasViewportCache::tilesUpdated, this, std::bind(&Data::onCacheTilesUpdated, d.data(), _1));
+
+	d->mScheduler = new CanvasUpdateScheduler(std::bind(&Data::renderTiles, d.data(), _1), this);
+	connect(d->mState.cache().get(), &CanvasViewportCache::tilesInvalidated, d->mScheduler, [this](const QPointSet &keys) {
+		d->mScheduler->addTiles(keys);
+	});
+	connect(d->mScheduler, &CanvasUpdateScheduler::repaintRequested, this, [this](const QRect &rect) {
+		if (d->mUpdateEnabled)
+			repaint(rect);
+	});
 
 	setAttribute(Qt::WA_NoSystemBackground);
 	setAttribute(Qt::WA_OpaquePaintEvent);
@@ -244,6 +310,7 @@ CanvasViewport::CanvasViewport(Canvas *canvas, QWidget *parent) :
 	installEventFilter(eventSender);
 	installEventFilter(navigator);
 	installEventFilter(keyTracker);
+	installEventFilter(this);
 
 	// setup scrollbars
 	{
@@ -300,16 +367,22 @@ CanvasViewport::CanvasViewport(Canvas *canvas, QWidget *parent) :
 		};
 		connect(canvas->workspace(), &Workspace::currentCanvasChanged, this, setFocusIfCanvasSame);
 		setFocusIfCanvasSame(canvas->workspace()->currentCanvas());
-
-		connect(canvas->document()->selection(), &Selection::surfaceChanged, this, std::bind(&Data::updateSelectionTiles, d.data(), _1, _2));
-		d->updateSelectionTiles(canvas->document()->selection()->surface(), canvas->document()->tileKeys());
 	}
 	connect(canvas->document()->layerScene(), &LayerScene::tilesUpdated, this, std::bind(&Data::updateTiles, d.data(), _1));
-	d->updateTiles(canvas->document()->tileKeys());
+
+	// tiles already composited for another viewport of the document are not marked dirty again
+	d->mScheduler->addTiles(canvas->document()->tileKeys());
+
+	if (appController()) {
+		appController()->memoryAccountant()->addSource(this, MemoryAccountant::CategoryViewportMipmap, canvas->document(),
+			[this](MemoryCounter &counter) { d->mState.countBackingStoreMemory(counter); });
+	}
 }
 
 CanvasViewport::~CanvasViewport()
 {
+	if (appController())
+		appController()->memoryAccountant()->removeSources(this);
 }
 
 } // namespace PaintField
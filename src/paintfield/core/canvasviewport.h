@@ -37,6 +37,7 @@ protected:
 	void leaveEvent(QEvent *) override;
 	void paintEvent(QPaintEvent *event) override;
 	bool event(QEvent *event) override;
+	bool eventFilter(QObject *watched, QEvent *event) override;
 
 private:
 
@@ -0,0 +1,519 @@
+#include "canvasviewportcache.h"
+
+#include "appcontroller.h"
+#include "document.h"
+#include "layerscene.h"
+#include "layerrenderer.h"
+#include "selection.h"
+#include "tool.h"
+#include "memoryaccountant.h"
+
+#include <QPainter>
+#include <algorithm>
+#include <cstring>
+
+using namespace Malachite;
+
+namespace PaintField {
+
+namespace {
+
+class CanvasRenderer : public LayerRenderer
+{
+public:
+	CanvasRenderer(Tool *tool) : mTool(tool) {}
+
+protected:
+
+	void drawLayer(Malachite::SurfacePainter *painter, const LayerConstRef &layer) override
+	{
+		if (mTool && mTool->layerDelegations().contains(layer))
+			mTool->drawLayer(painter, layer);
+		else
+			LayerRenderer::drawLayer(painter, layer);
+	}
+
+	void renderChildren(Malachite::SurfacePainter *painter, const LayerConstRef &parent) override
+	{
+		if (!mTool || mTool->layerInsertions().isEmpty()) {
+			LayerRenderer::renderChildren(painter, parent);
+		} else {
+			auto originalLayers = parent->children();
+			auto layers = originalLayers;
+
+			for (auto insertion : mTool->layerInsertions()) {
+				if (insertion.parent == parent) {
+					int index = insertion.index;
+					auto layer = insertion.layer;
+					if (index == originalLayers.size()) {
+						layers << layer;
+					} else {
+						auto layerAt = originalLayers.at(index);
+						int trueIndex = layers.indexOf(layerAt);
+						layers.insert(trueIndex, layer);
+					}
+				}
+			}
+			renderLayers(painter, layers);
+		}
+	}
+
+private:
+
+	Tool *mTool = 0;
+};
+
+QHash<Document *, WP<CanvasViewportCache>> &cacheRegistry()
+{
+	static QHash<Document *, WP<CanvasViewportCache>> registry;
+	return registry;
+}
+
+/**
+ * The image of a viewport whose tool draws layers differently (stroke previews, transform previews).
+ * It starts as a copy of the shared mipmap (the tiles are implicitly shared),
+ * and only the tiles composited with the tool diverge from it.
+ */
+struct ToolLayer
+{
+	CanvasViewportMipmap mMipmap;
+
+	// tiles composited with the tool
+	QPointSet mKeys;
+
+	// dirty regions relative to each tile
+	QHash<QPoint, QRect> mDirtyRects;
+};
+
+} // anonymous namespace
+
+struct CanvasViewportCache::Data
+{
+	Document *mDocument = 0;
+	QSize mDocumentSize;
+
+	// the document without any tool
+	CanvasViewportMipmap mMipmap;
+	SelectionMipmap mSelectionMipmap;
+
+	// dirty regions relative to each tile
+	QHash<QPoint, QRect> mDirtyRects;
+
+	// the tool layers of the viewports with tool previews
+	QHash<const void *, ToolLayer> mToolLayers;
+
+	// the mipmap level each viewport displays
+	QHash<const void *, int> mLevels;
+
+	bool mCacheAvailable = false;
+	QRect mCacheRect;
+	ImageU8 mCacheImage;
+
+	// tiles showing the preview of a document being loaded
+	QPointSet mPreviewKeys;
+
+	int displayedUpperLevelCount() const
+	{
+		QSet<int> levels;
+		for (int level : mLevels) {
+			if (level > 0)
+				levels << level;
+		}
+		return levels.size();
+	}
+
+	/// draws the preview, stretched to the document size and blended onto white, into a region of a tile
+	void drawPreview(ImageU8 &tile, const QPoint &key, const QRect &relativeRect, const QImage &preview)
+	{
+		QImage image(relativeRect.size(), QImage::Format_ARGB32_Premultiplied);
+		image.fill(Qt::white);
+		{
+			QPainter painter(&image);
+			painter.setRenderHint(QPainter::SmoothPixmapTransform);
+			painter.translate(-(relativeRect.topLeft() + key * Surface::tileWidth()));
+			painter.scale(double(mDocumentSize.width()) / preview.width(), double(mDocumentSize.height()) / preview.height());
+			painter.drawImage(0, 0, preview);
+		}
+
+		for (int y = 0; y < relativeRect.height(); ++y) {
+			auto dst = tile.pixelPointer(relativeRect.left(), relativeRect.top() + y);
+			std::memcpy(dst, image.constScanLine(y), relativeRect.width() * sizeof(BgraPremultU8));
+		}
+	}
+
+	/// composites the dirty regions of tiles and writes them into "mipmap", blended onto white
+	QRect composite(CanvasViewportMipmap &mipmap, const QHash<QPoint, QRect> &dirtyRects, Tool *tool)
+	{
+		CanvasRenderer renderer(tool);
+		auto surface = renderer.renderToSurface({mDocument->layerScene()->rootLayer()}, QPointSet(), dirtyRects);
+
+		auto documentRect = QRect(QPoint(), mDocumentSize);
+		const Pixel whitePixel(1.f);
+		QRect updatedRect;
+
+		// blends the rendered tile onto white and writes it straight into the mipmap in one pass
+		for (auto iter = dirtyRects.begin(); iter != dirtyRects.end(); ++iter) {
+			auto key = iter.key();
+			auto relativeDocumentRect = documentRect.translated(-key * Surface::tileWidth());
+			auto relativeRect = iter.value() & relativeDocumentRect;
+			if (relativeRect.isEmpty())
+				continue;
+
+			bool rendered = surface.contains(key);
+			auto srcTile = surface.tile(key);
+
+			mipmap.modify(key, relativeRect, [&](ImageU8 &dstTile) {
+				for (int y = relativeRect.top(); y <= relativeRect.bottom(); ++y) {
+					auto dst = dstTile.pixelPointer(relativeRect.left(), y);
+					if (rendered) {
+						auto src = srcTile.constPixelPointer(relativeRect.left(), y);
+						blendOnBackgroundToU8(relativeRect.width(), (BgraPremultU8 *)dst, (const Pixel *)src, whitePixel);
+					} else {
+						std::fill(dst, dst + relativeRect.width(), BgraPremultU8(255, 255, 255, 255));
+					}
+				}
+			});
+
+			updatedRect |= relativeRect.translated(key * Surface::tileWidth());
+		}
+
+		return updatedRect;
+	}
+
+	/// takes the dirty regions of the tiles of "rects" out of "dirtyRects"
+	static QHash<QPoint, QRect> takeDirtyRects(QHash<QPoint, QRect> &dirtyRects, const QHash<QPoint, QRect> &rects)
+	{
+		QHash<QPoint, QRect> result;
+		for (auto iter = rects.begin(); iter != rects.end(); ++iter) {
+			auto dirty = dirtyRects.find(iter.key());
+			if (dirty == dirtyRects.end())
+				continue;
+			result.insert(dirty.key(), dirty.value());
+			dirtyRects.erase(dirty);
+		}
+		return result;
+	}
+
+	static QRect keysToRect(const QPointSet &keys)
+	{
+		QRect rect;
+		for (const QPoint &key : keys)
+			rect |= Surface::keyToRect(key);
+		return rect;
+	}
+};
+
+SP<CanvasViewportCache> CanvasViewportCache::forDocument(Document *document)
+{
+	auto &registry = cacheRegistry();
+
+	auto cache = registry.value(document).lock();
+	if (!cache) {
+		cache = SP<CanvasViewportCache>(new CanvasViewportCache(document));
+		registry[document] = cache;
+	}
+	return cache;
+}
+
+CanvasViewportCache::CanvasViewportCache(Document *document) :
+	d(new Data)
+{
+	using namespace std::placeholders;
+
+	d->mDocument = document;
+
+	connect(document, &Document::sizeChanged, this, std::bind(&CanvasViewportCache::setDocumentSize, this, _1));
+	setDocumentSize(document->size());
+
+	connect(document->selection(), &Selection::surfaceChanged, this, std::bind(&CanvasViewportCache::updateSelectionTiles, this, _1, _2));
+	updateSelectionTiles(document->selection()->surface(), document->tileKeys());
+
+	markDirty(document->tileKeys());
+
+	// the tiles that showed the preview are composited once the layer data is loaded
+	connect(document, &Document::loadingChanged, this, [this](bool loading) {
+		if (loading || d->mPreviewKeys.isEmpty())
+			return;
+		auto keys = d->mPreviewKeys;
+		d->mPreviewKeys.clear();
+		markDirty(keys);
+		emit tilesInvalidated(keys);
+	});
+
+	if (appController()) {
+		auto accountant = appController()->memoryAccountant();
+		accountant->addSource(this, MemoryAccountant::CategoryViewportMipmap, document,
+			std::bind(&CanvasViewportCache::countMipmapMemory, this, _1),
+			std::bind(&CanvasViewportCache::releaseMipmapMemory, this));
+		accountant->addSource(this, MemoryAccountant::CategorySelectionMipmap, document,
+			std::bind(&CanvasViewportCache::countSelectionMipmapMemory, this, _1),
+			[this] { d->mSelectionMipmap.releaseUnusedLevels(d->displayedUpperLevelCount()); });
+	}
+}
+
+CanvasViewportCache::~CanvasViewportCache()
+{
+	auto &registry = cacheRegistry();
+	if (registry.value(d->mDocument).expired())
+		registry.remove(d->mDocument);
+
+	if (appController())
+		appController()->memoryAccountant()->removeSources(this);
+}
+
+Document *CanvasViewportCache::document() const
+{
+	return d->mDocument;
+}
+
+QSize CanvasViewportCache::documentSize() const
+{
+	return d->mDocumentSize;
+}
+
+void CanvasViewportCache::markDirty(const QPointSet &keys)
+{
+	for (const QPoint &key : keys) {
+		d->mDirtyRects[key] = QRect(QPoint(), Surface::tileSize());
+		for (auto &toolLayer : d->mToolLayers)
+			toolLayer.mDirtyRects[key] = QRect(QPoint(), Surface::tileSize());
+	}
+}
+
+void CanvasViewportCache::markDirty(const QHash<QPoint, QRect> &rects)
+{
+	for (auto iter = rects.begin(); iter != rects.end(); ++iter) {
+		d->mDirtyRects[iter.key()] |= iter.value();
+		for (auto &toolLayer : d->mToolLayers)
+			toolLayer.mDirtyRects[iter.key()] |= iter.value();
+	}
+}
+
+QRect CanvasViewportCache::render(const void *viewport, const QHash<QPoint, QRect> &rects, Tool *tool)
+{
+	bool hasToolPreview = tool && (!tool->layerDelegations().isEmpty() || !tool->layerInsertions().isEmpty());
+
+	if (!hasToolPreview) {
+		// the tiles the tool drew are shown from the shared mipmap again
+		auto toolKeys = removeToolLayer(viewport);
+		auto rectsToRender = rects;
+		for (const QPoint &key : toolKeys)
+			rectsToRender[key] = QRect(QPoint(), Surface::tileSize());
+		return Data::keysToRect(toolKeys) | renderShared(rectsToRender);
+	}
+
+	QRect updatedRect;
+
+	// the document without the tool is only composited here when other viewports show it
+	if (d->mLevels.size() > 1)
+		updatedRect |= renderShared(rects);
+
+	if (!d->mToolLayers.contains(viewport)) {
+		ToolLayer toolLayer;
+		toolLayer.mMipmap = d->mMipmap;
+		toolLayer.mDirtyRects = d->mDirtyRects;
+		d->mToolLayers.insert(viewport, toolLayer);
+	}
+	auto &toolLayer = d->mToolLayers[viewport];
+
+	auto dirtyRects = Data::takeDirtyRects(toolLayer.mDirtyRects, rects);
+	if (dirtyRects.isEmpty())
+		return updatedRect;
+
+	updatedRect |= d->composite(toolLayer.mMipmap, dirtyRects, tool);
+	for (auto iter = dirtyRects.begin(); iter != dirtyRects.end(); ++iter)
+		toolLayer.mKeys << iter.key();
+
+	return updatedRect;
+}
+
+QRect CanvasViewportCache::renderShared(const QHash<QPoint, QRect> &rects)
+{
+	// tiles already composited for another viewport are skipped
+	auto dirtyRects = Data::takeDirtyRects(d->mDirtyRects, rects);
+
+	if (dirtyRects.isEmpty())
+		return QRect();
+
+	// until the layer data is loaded, the preview embedded in the file is shown instead
+	auto preview = d->mDocument->isLoading() ? d->mDocument->preview() : QImage();
+
+	QRect updatedRect;
+
+	if (preview.isNull()) {
+		updatedRect = d->composite(d->mMipmap, dirtyRects, 0);
+	} else {
+		auto documentRect = QRect(QPoint(), d->mDocumentSize);
+
+		for (auto iter = dirtyRects.begin(); iter != dirtyRects.end(); ++iter) {
+			auto key = iter.key();
+			auto relativeRect = iter.value() & documentRect.translated(-key * Surface::tileWidth());
+			if (relativeRect.isEmpty())
+				continue;
+
+			d->mMipmap.modify(key, relativeRect, [&](ImageU8 &dstTile) {
+				d->drawPreview(dstTile, key, relativeRect, preview);
+			});
+			d->mPreviewKeys << key;
+			updatedRect |= relativeRect.translated(key * Surface::tileWidth());
+		}
+	}
+
+	// the tool layers take the new tiles, except the ones their tools draw
+	QPointSet keys;
+	for (auto iter = dirtyRects.begin(); iter != dirtyRects.end(); ++iter)
+		keys << iter.key();
+
+	for (auto &toolLayer : d->mToolLayers) {
+		QPointSet keysToCopy;
+		for (const QPoint &key : keys) {
+			if (!toolLayer.mKeys.contains(key)) {
+				keysToCopy << key;
+				toolLayer.mDirtyRects.remove(key);
+			}
+		}
+		if (!keysToCopy.isEmpty())
+			toolLayer.mMipmap.replace(d->mMipmap.baseSurface(), keysToCopy);
+	}
+
+	// while stroking only one tile is updated at a time, so keep its crop for the next repaint
+	if (dirtyRects.size() == 1 && !updatedRect.isEmpty()) {
+		d->mCacheAvailable = true;
+		d->mCacheRect = updatedRect;
+		d->mCacheImage = d->mMipmap.baseSurface().crop(updatedRect);
+	} else {
+		d->mCacheAvailable = false;
+	}
+
+	if (!updatedRect.isEmpty())
+		emit tilesUpdated(updatedRect);
+
+	return updatedRect;
+}
+
+void CanvasViewportCache::clearToolLayer(const void *viewport)
+{
+	auto keys = removeToolLayer(viewport);
+
+	// tiles left dirty while the tool layer was shown
+	QPointSet dirtyKeys;
+	for (const QPoint &key : keys) {
+		if (d->mDirtyRects.contains(key))
+			dirtyKeys << key;
+	}
+	if (!dirtyKeys.isEmpty())
+		emit tilesInvalidated(dirtyKeys);
+}
+
+QPointSet CanvasViewportCache::removeToolLayer(const void *viewport)
+{
+	auto iter = d->mToolLayers.find(viewport);
+	if (iter == d->mToolLayers.end())
+		return QPointSet();
+
+	auto keys = iter->mKeys;
+	d->mToolLayers.erase(iter);
+	return keys;
+}
+
+void CanvasViewportCache::setLevel(const void *viewport, int level)
+{
+	d->mLevels[viewport] = level;
+	d->mMipmap.setCurrentLevel(level);
+	d->mSelectionMipmap.setCurrentLevel(level);
+	releaseUnusedLevels();
+}
+
+void CanvasViewportCache::removeLevel(const void *viewport)
+{
+	d->mLevels.remove(viewport);
+	clearToolLayer(viewport);
+	releaseUnusedLevels();
+}
+
+CanvasViewportSurface CanvasViewportCache::mergedSurface() const
+{
+	return d->mMipmap.baseSurface();
+}
+
+CanvasViewportSurface CanvasViewportCache::surface(const void *viewport, int level, const QRect &sceneRect)
+{
+	auto toolLayer = d->mToolLayers.find(viewport);
+	if (toolLayer != d->mToolLayers.end())
+		return toolLayer->mMipmap.surface(level, sceneRect);
+	return d->mMipmap.surface(level, sceneRect);
+}
+
+SelectionSurface CanvasViewportCache::selectionSurface(int level, const QRect &sceneRect)
+{
+	return d->mSelectionMipmap.surface(level, sceneRect);
+}
+
+ImageU8 CanvasViewportCache::crop(const void *viewport, int level, const QRect &rect) const
+{
+	auto toolLayer = d->mToolLayers.find(viewport);
+	if (toolLayer != d->mToolLayers.end())
+		return toolLayer->mMipmap.levelSurface(level).crop(rect);
+	if (level == 0 && d->mCacheAvailable && d->mCacheRect == rect)
+		return d->mCacheImage;
+	return d->mMipmap.levelSurface(level).crop(rect);
+}
+
+void CanvasViewportCache::setDocumentSize(const QSize &size)
+{
+	d->mDocumentSize = size;
+	d->mMipmap.setSceneSize(size);
+	d->mSelectionMipmap.setSceneSize(size);
+	for (auto &toolLayer : d->mToolLayers)
+		toolLayer.mMipmap.setSceneSize(size);
+	d->mCacheAvailable = false;
+}
+
+void CanvasViewportCache::updateSelectionTiles(const SelectionSurface &surface, const QPointSet &keys)
+{
+	d->mSelectionMipmap.replace(surface, keys);
+	auto sceneRect = keys++.foldLeft(QRect(), [](const QRect &memo, const QPoint &key) {
+		return memo | QRect(key * SelectionSurface::tileWidth(), SelectionSurface::tileSize());
+	});
+	emit tilesUpdated(sceneRect);
+}
+
+void CanvasViewportCache::releaseUnusedLevels()
+{
+	// the displayed levels are the most recently used ones, and one more is kept for zooming back
+	auto keepCount = d->displayedUpperLevelCount() + 1;
+	d->mMipmap.releaseUnusedLevels(keepCount);
+	d->mSelectionMipmap.releaseUnusedLevels(keepCount);
+	for (auto &toolLayer : d->mToolLayers)
+		toolLayer.mMipmap.releaseUnusedLevels(keepCount);
+}
+
+void CanvasViewportCache::countMipmapMemory(MemoryCounter &counter) const
+{
+	for (int level = 0; level < d->mMipmap.levelCount(); ++level)
+		counter.addSurface(d->mMipmap.levelSurface(level));
+	counter.addImage(d->mCacheImage);
+
+	// tiles shared with the mipmap above are not counted again
+	for (const auto &toolLayer : d->mToolLayers) {
+		for (int level = 0; level < toolLayer.mMipmap.levelCount(); ++level)
+			counter.addSurface(toolLayer.mMipmap.levelSurface(level));
+	}
+}
+
+void CanvasViewportCache::countSelectionMipmapMemory(MemoryCounter &counter) const
+{
+	for (int level = 0; level < d->mSelectionMipmap.levelCount(); ++level)
+		counter.addSurface(d->mSelectionMipmap.levelSurface(level));
+}
+
+void CanvasViewportCache::releaseMipmapMemory()
+{
+	d->mMipmap.releaseUnusedLevels(d->displayedUpperLevelCount());
+	for (auto &toolLayer : d->mToolLayers)
+		toolLayer.mMipmap.releaseUnusedLevels(d->displayedUpperLevelCount());
+	d->mCacheAvailable = false;
+	d->mCacheImage = ImageU8();
+}
+
+} // namespace PaintField
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <QObject>
+#include "global.h"
+#include "selectionsurface.h"
+#include "canvasviewportmipmap.h"
+
+namespace PaintField {
+
+class Document;
+class Tool;
+class MemoryCounter;
+
+/**
+ * The CanvasViewportCache holds the composited image of a document and its mipmap, shared by every viewport of the document.
+ *
+ * Dirty tiles are composited once by whichever viewport renders them first;
+ * the other viewports are notified through tilesUpdated and only resample the mipmap with their own transforms.
+ * The shared mipmap never contains what a tool draws instead of layers (stroke and transform previews).
+ * While its tool has such previews, a viewport gets its own tool layer,
+ * a copy of the mipmap in which only the tiles the tool draws are composited again with the tool.
+ * Mipmap levels are computed lazily, only for the tiles the viewports display.
+ * While a document is being loaded, the tiles show the preview embedded in its file.
+ */
+class CanvasViewportCache : public QObject
+{
+	Q_OBJECT
+public:
+
+	/**
+	 * @return The cache of "document", created when no viewport of the document holds one
+	 */
+	static SP<CanvasViewportCache> forDocument(Document *document);
+
+	~CanvasViewportCache();
+
+	Document *document() const;
+	QSize documentSize() const;
+
+	/**
+	 * Marks tiles to be composited again.
+	 */
+	void markDirty(const QPointSet &keys);
+
+	/**
+	 * Marks regions of tiles to be composited again.
+	 * @param rects Dirty regions relative to each tile
+	 */
+	void markDirty(const QHash<QPoint, QRect> &rects);
+
+	/**
+	 * Composites the tiles of "rects" that are still dirty for "viewport" and emits tilesUpdated for the shared tiles.
+	 * The whole dirty region of each tile is composited, so "rects" only selects the tiles.
+	 * @param viewport Any pointer that identifies the viewport
+	 * @param tool The tool of the viewport, whose layer delegations and insertions are drawn into its tool layer (may be 0)
+	 * @return The scene rect updated for "viewport"
+	 */
+	QRect render(const void *viewport, const QHash<QPoint, QRect> &rects, Tool *tool);
+
+	/**
+	 * Removes the tool layer of a viewport (when its tool changes).
+	 */
+	void clearToolLayer(const void *viewport);
+
+	/**
+	 * Sets the mipmap level a viewport displays.
+	 * Levels no viewport displays are released, except the last one used.
+	 * @param viewport Any pointer that identifies the viewport
+	 */
+	void setLevel(const void *viewport, int level);
+	void removeLevel(const void *viewport);
+
+	CanvasViewportSurface mergedSurface() const;
+
+	/**
+	 * Computes the mipmap tiles of "level" that cover "sceneRect" if they are out of date.
+	 * @return The mipmap surface of "level" displayed in "viewport"
+	 */
+	CanvasViewportSurface surface(const void *viewport, int level, const QRect &sceneRect);
+	SelectionSurface selectionSurface(int level, const QRect &sceneRect);
+
+	/**
+	 * Crops "rect" from the mipmap surface of "level", reusing the crop of the last single tile update when possible.
+	 * The tiles must have been brought up to date with surface().
+	 */
+	Malachite::ImageU8 crop(const void *viewport, int level, const QRect &rect) const;
+
+signals:
+
+	/**
+	 * Emitted when the composited image or the selection changed.
+	 */
+	void tilesUpdated(const QRect &sceneRect);
+
+	/**
+	 * Emitted when tiles have to be composited again though the document did not change
+	 * (the tiles that showed the preview of a document being loaded).
+	 */
+	void tilesInvalidated(const QPointSet &keys);
+
+private:
+
+	explicit CanvasViewportCache(Document *document);
+
+	QRect renderShared(const QHash<QPoint, QRect> &rects);
+	QPointSet removeToolLayer(const void *viewport);
+
+	void setDocumentSize(const QSize &size);
+	void updateSelectionTiles(const SelectionSurface &surface, const QPointSet &keys);
+	void releaseUnusedLevels();
+
+	void countMipmapMemory(MemoryCounter &counter) const;
+	void countSelectionMipmapMemory(MemoryCounter &counter) const;
+	void releaseMipmapMemory();
+
+	struct Data;
+	QScopedPointer<Data> d;
+};
+
+} // namespace PaintField
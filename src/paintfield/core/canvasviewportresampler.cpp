@@ -0,0 +1,178 @@
+#include <QtConcurrent>
+#include <emmintrin.h>
+#include <climits>
+#include <cmath>
+
+#include "canvasviewportresampler.h"
+
+namespace PaintField {
+
+namespace {
+
+constexpr int tileWidth = CanvasViewportSurface::tileWidth();
+
+inline int floorDiv(int x, int divisor)
+{
+	return x >= 0 ? x / divisor : -((-x - 1) / divisor) - 1;
+}
+
+/**
+ * Remembers the last tile looked up, so that neighbouring samples do not hit the hash.
+ */
+class TileCache
+{
+public:
+
+	TileCache(const CanvasViewportSurface &surface) :
+		mSurface(surface)
+	{}
+
+	const uint32_t *tileBits(int keyX, int keyY)
+	{
+		if (keyX != mKeyX || keyY != mKeyY) {
+			mKeyX = keyX;
+			mKeyY = keyY;
+			mTile = mSurface.tile(keyX, keyY);
+			mBits = reinterpret_cast<const uint32_t *>((const Malachite::BgraPremultU8 *)mTile.cbegin());
+		}
+		return mBits;
+	}
+
+	uint32_t pixel(int x, int y)
+	{
+		int keyX = floorDiv(x, tileWidth);
+		int keyY = floorDiv(y, tileWidth);
+		return tileBits(keyX, keyY)[(y - keyY * tileWidth) * tileWidth + (x - keyX * tileWidth)];
+	}
+
+	/**
+	 * Fetches the 2x2 pixels whose top left is (x, y).
+	 */
+	void quad(int x, int y, uint32_t &p00, uint32_t &p10, uint32_t &p01, uint32_t &p11)
+	{
+		int keyX = floorDiv(x, tileWidth);
+		int keyY = floorDiv(y, tileWidth);
+		int relX = x - keyX * tileWidth;
+		int relY = y - keyY * tileWidth;
+
+		if (relX < tileWidth - 1 && relY < tileWidth - 1) {
+			auto p = tileBits(keyX, keyY) + relY * tileWidth + relX;
+			p00 = p[0];
+			p10 = p[1];
+			p01 = p[tileWidth];
+			p11 = p[tileWidth + 1];
+		} else {
+			p00 = pixel(x, y);
+			p10 = pixel(x + 1, y);
+			p01 = pixel(x, y + 1);
+			p11 = pixel(x + 1, y + 1);
+		}
+	}
+
+private:
+
+	const CanvasViewportSurface &mSurface;
+	int mKeyX = INT_MIN, mKeyY = INT_MIN;
+	Malachite::ImageU8 mTile;
+	const uint32_t *mBits = nullptr;
+};
+
+/**
+ * Interpolates 4 premultiplied BGRA pixels, all channels at once.
+ * @param fx The horizontal weight of the right pixels (0 - 256)
+ * @param fy The vertical weight of the bottom pixels (0 - 256)
+ */
+inline uint32_t bilinear(uint32_t p00, uint32_t p10, uint32_t p01, uint32_t p11, int fx, int fy)
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	// lanes 0-3: left pixel, lanes 4-7: right pixel (16bit each)
+	__m128i top = _mm_unpacklo_epi8(_mm_set_epi32(0, 0, p10, p00), zero);
+	__m128i bottom = _mm_unpacklo_epi8(_mm_set_epi32(0, 0, p11, p01), zero);
+
+	// 255 * 256 fits in unsigned 16bit
+	__m128i vertical = _mm_add_epi16(_mm_mullo_epi16(top, _mm_set1_epi16(256 - fy)), _mm_mullo_epi16(bottom, _mm_set1_epi16(fy)));
+	vertical = _mm_srli_epi16(vertical, 8);
+
+	__m128i weightsX = _mm_set_epi16(fx, fx, fx, fx, 256 - fx, 256 - fx, 256 - fx, 256 - fx);
+	__m128i horizontal = _mm_mullo_epi16(vertical, weightsX);
+	horizontal = _mm_add_epi16(horizontal, _mm_srli_si128(horizontal, 8));
+	horizontal = _mm_srli_epi16(horizontal, 8);
+
+	return uint32_t(_mm_cvtsi128_si32(_mm_packus_epi16(horizontal, horizontal)));
+}
+
+} // anonymous namespace
+
+void CanvasViewportResampler::resample(QImage *dst, const QRect &dstRect, Filter filter) const
+{
+	Q_ASSERT(dst->format() == QImage::Format_ARGB32_Premultiplied);
+
+	auto rect = dstRect & dst->rect();
+	if (rect.isEmpty())
+		return;
+
+	// detach once here so that the workers only touch raw scanlines
+	auto bits = dst->bits();
+	auto bytesPerLine = dst->bytesPerLine();
+
+	constexpr int bandHeight = 32;
+
+	if (rect.height() < bandHeight * 2 || rect.width() * rect.height() < 256 * 256) {
+		resampleRows(bits, bytesPerLine, rect, filter);
+		return;
+	}
+
+	QVector<QRect> bands;
+	for (int top = rect.top(); top <= rect.bottom(); top += bandHeight)
+		bands << (rect & QRect(rect.left(), top, rect.width(), bandHeight));
+
+	QtConcurrent::blockingMap(bands, [&](const QRect &band) {
+		resampleRows(bits, bytesPerLine, band, filter);
+	});
+}
+
+void CanvasViewportResampler::resampleRows(uchar *bits, int bytesPerLine, const QRect &dstRect, Filter filter) const
+{
+	TileCache cache(mSurface);
+
+	const double stepX = mViewToSurface.m11();
+	const double stepY = mViewToSurface.m12();
+
+	for (int y = dstRect.top(); y <= dstRect.bottom(); ++y) {
+
+		auto dstLine = reinterpret_cast<uint32_t *>(bits + y * bytesPerLine) + dstRect.left();
+
+		// the surface position of the center of the first pixel
+		auto start = mViewToSurface.map(QPointF(dstRect.left() + 0.5, y + 0.5));
+		double sx = start.x();
+		double sy = start.y();
+
+		if (filter == FilterNearest) {
+			for (int x = 0; x < dstRect.width(); ++x) {
+				dstLine[x] = cache.pixel(int(std::floor(sx)), int(std::floor(sy)));
+				sx += stepX;
+				sy += stepY;
+			}
+		} else {
+			// sample between the 4 nearest pixel centers
+			sx -= 0.5;
+			sy -= 0.5;
+			for (int x = 0; x < dstRect.width(); ++x) {
+				double floorX = std::floor(sx);
+				double floorY = std::floor(sy);
+				int fx = int((sx - floorX) * 256.0);
+				int fy = int((sy - floorY) * 256.0);
+
+				uint32_t p00, p10, p01, p11;
+				cache.quad(int(floorX), int(floorY), p00, p10, p01, p11);
+				dstLine[x] = bilinear(p00, p10, p01, p11, fx, fy);
+
+				sx += stepX;
+				sy += stepY;
+			}
+		}
+	}
+}
+
+} // namespace PaintField
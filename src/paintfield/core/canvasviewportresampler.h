@@ -0,0 +1,49 @@
+#pragma once
+
+#include <QTransform>
+#include <QImage>
+#include "canvasviewportsurface.h"
+
+namespace PaintField {
+
+/**
+ * The CanvasViewportResampler draws a CanvasViewportSurface into a view image with an affine transform.
+ * It reads the surface tiles directly (no cropping) and filters with a SSE2 bilinear kernel.
+ */
+class CanvasViewportResampler
+{
+public:
+
+	enum Filter
+	{
+		FilterNearest,
+		FilterBilinear
+	};
+
+	/**
+	 * @param surface The source surface
+	 * @param viewToSurface The transform from the view to the surface coordinates
+	 */
+	CanvasViewportResampler(const CanvasViewportSurface &surface, const QTransform &viewToSurface) :
+		mSurface(surface),
+		mViewToSurface(viewToSurface)
+	{}
+
+	/**
+	 * Resamples into "dst".
+	 * Large rects are split into bands of rows resampled in parallel.
+	 * @param dst A ARGB32 premultiplied image in view coordinates
+	 * @param dstRect The rect to fill
+	 * @param filter The filter
+	 */
+	void resample(QImage *dst, const QRect &dstRect, Filter filter) const;
+
+private:
+
+	void resampleRows(uchar *bits, int bytesPerLine, const QRect &dstRect, Filter filter) const;
+
+	CanvasViewportSurface mSurface;
+	QTransform mViewToSurface;
+};
+
+} // namespace PaintField
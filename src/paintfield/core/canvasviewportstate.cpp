@@ -1,62 +1,15 @@
 #include "canvasviewportstate.h"
 
-#include "layerrenderer.h"
-#include "canvas.h"
-#include "document.h"
-#include "layerscene.h"
-#include "tool.h"
+#include "canvasviewportresampler.h"
+#include "memoryaccountant.h"
 #include <QImage>
 #include <QPainter>
+#include <cstring>
 
 namespace PaintField {
 
 namespace {
 
-class CanvasRenderer : public LayerRenderer
-{
-public:
-	CanvasRenderer(Tool *tool) : mTool(tool) {}
-
-protected:
-
-	void drawLayer(Malachite::SurfacePainter *painter, const LayerConstRef &layer) override
-	{
-		if (mTool && mTool->layerDelegations().contains(layer))
-			mTool->drawLayer(painter, layer);
-		else
-			LayerRenderer::drawLayer(painter, layer);
-	}
-
-	void renderChildren(Malachite::SurfacePainter *painter, const LayerConstRef &parent) override
-	{
-		if (!mTool || mTool->layerInsertions().isEmpty()) {
-			LayerRenderer::renderChildren(painter, parent);
-		} else {
-			auto originalLayers = parent->children();
-			auto layers = originalLayers;
-
-			for (auto insertion : mTool->layerInsertions()) {
-				if (insertion.parent == parent) {
-					int index = insertion.index;
-					auto layer = insertion.layer;
-					if (index == originalLayers.size()) {
-						layers << layer;
-					} else {
-						auto layerAt = originalLayers.at(index);
-						int trueIndex = layers.indexOf(layerAt);
-						layers.insert(trueIndex, layer);
-					}
-				}
-			}
-			renderLayers(painter, layers);
-		}
-	}
-
-private:
-
-	Tool *mTool = 0;
-};
-
 template <typename TFunction>
 void drawDivided(const QRect &viewRect, const TFunction &drawFunc)
 {
@@ -89,49 +42,76 @@ void drawDivided(const QRect &viewRect, const TFunction &drawFunc)
 
 } // anonymous namespace
 
+CanvasViewportState::~CanvasViewportState()
+{
+	if (this->mCache)
+		this->mCache->removeLevel(this);
+}
+
+void CanvasViewportState::setCache(const SP<CanvasViewportCache> &cache)
+{
+	if (this->mCache)
+		this->mCache->removeLevel(this);
+	this->mCache = cache;
+	if (this->mCache && this->mTransforms)
+		this->mCache->setLevel(this, this->mTransforms->mipmapLevel);
+	invalidateBackingStore();
+}
+
+void CanvasViewportState::setTool(Tool *tool)
+{
+	this->mTool = tool;
+
+	// the previews of the previous tool are not shown any more
+	if (this->mCache) {
+		this->mCache->clearToolLayer(this);
+		invalidateBackingStore();
+	}
+}
+
 void CanvasViewportState::render(QPainter *painter, const QRect &windowRepaintRect)
 {
-	bool retinaMode = this->mRetinaMode;
-
-	auto fromWindowRect = [&](const QRect &rect) -> QRect {
-		if (retinaMode)
-			return QRect(rect.left() * 2, rect.top() * 2, rect.width() * 2, rect.height() * 2);
-		else
-			return rect;
-	};
-
-	auto toWindowRect = [&](const QRect &rect) -> QRect {
-		if (retinaMode)
-			return QRect(rect.left() / 2, rect.top() / 2, rect.width() / 2, rect.height() / 2);
-		else
-			return rect;
-	};
-
-	auto repaintRect = fromWindowRect(windowRepaintRect);
+	auto repaintRect = fromWindowRect(windowRepaintRect) & this->mBackingStore.rect();
+	if (repaintRect.isEmpty())
+		return;
+
+	// only regions invalidated by tile updates or exposed by scrolling are drawn from the mipmap
+	auto regionToRedraw = this->mBackingStoreDirtyRegion & repaintRect;
+	if (!regionToRedraw.isEmpty()) {
+		for (const QRect &rect : regionToRedraw.rects())
+			renderToBackingStore(rect);
+		this->mBackingStoreDirtyRegion -= regionToRedraw;
+	}
+
+	painter->setCompositionMode(QPainter::CompositionMode_Source);
+	painter->drawImage(toWindowRect(repaintRect), this->mBackingStore, repaintRect);
+}
+
+void CanvasViewportState::renderToBackingStore(const QRect &repaintRect)
+{
 	auto sceneRepaintRect = this->mTransforms->viewToScene.mapRect(QRectF(repaintRect)).toAlignedRect();
-	auto surface = this->mMipmap.surface();
-	auto selectionSurface = this->mSelectionMipmap.surface();
+	auto level = this->mTransforms->mipmapLevel;
+	// only the mipmap tiles around the repainted rect are computed (with a margin for the bilinear filter)
+	auto margin = 2 << level;
+	auto sceneRectToUpdate = sceneRepaintRect.adjusted(-margin, -margin, margin, margin);
+	auto surface = this->mCache->surface(this, level, sceneRectToUpdate);
+	auto selectionSurface = this->mCache->selectionSurface(level, sceneRectToUpdate);
 	auto hasSelection = selectionSurface.hasTileInRect(sceneRepaintRect);
 	auto selectionRgb = qRgba(0 ,0 ,100, 100);
 
-	painter->setCompositionMode(QPainter::CompositionMode_Source);
-
-	// get rid of unnecessary state change for performance
-	if (!(windowRepaintRect & QRect(QPoint(), this->mDocumentSize)).isEmpty()) {
-		painter->setPen(Qt::NoPen);
-		painter->setBrush(QColor(128, 128, 128));
+	// transformed views are resampled straight from the mipmap tiles, before any QPainter is opened on the store
+	if (!this->mTranslationOnly) {
+		auto filter = this->mTransforms->scale < 2.0 ? CanvasViewportResampler::FilterBilinear : CanvasViewportResampler::FilterNearest;
+		CanvasViewportResampler(surface, this->mTransforms->viewToMipmap).resample(&this->mBackingStore, repaintRect, filter);
 	}
 
-	auto cropSurface = [&](const QRect &rect)
-	{
-		//PAINTFIELD_DEBUG << state->cacheRect << rect;
-		if (this->mCacheAvailable && this->mCacheRect == rect) {
-			//PAINTFIELD_DEBUG << "cached";
-			return this->mCacheImage;
-		} else {
-			return surface.crop(rect);
-		}
-	};
+	QPainter backingStorePainter(&this->mBackingStore);
+	auto painter = &backingStorePainter;
+
+	painter->setCompositionMode(QPainter::CompositionMode_Source);
+
+	painter->setPen(Qt::NoPen);
+	painter->setBrush(QColor(128, 128, 128));
 
 	if (this->mTranslationOnly) // easy, view is only translated
 	{
@@ -144,12 +124,11 @@ void CanvasViewportState::render(QPainter *painter, const QRect &windowRepaintRe
 		auto drawInViewRect = [&](const QRect &viewRect)
 		{
 			auto sceneRect = viewRectToSceneRect(viewRect);
-			auto windowRect = toWindowRect(viewRect);
 
 			if ((sceneRect & QRect(QPoint(), this->mDocumentSize)).isEmpty()) {
-				painter->drawRect(windowRect);
+				painter->drawRect(viewRect);
 			} else {
-				painter->drawImage(windowRect, Malachite::wrapInQImage(cropSurface(sceneRect)));
+				painter->drawImage(viewRect, Malachite::wrapInQImage(this->mCache->crop(this, level, sceneRect)));
 			}
 		};
 
@@ -157,8 +136,7 @@ void CanvasViewportState::render(QPainter *painter, const QRect &windowRepaintRe
 			auto sceneRect = viewRectToSceneRect(viewRect);
 			if (!selectionSurface.hasTileInRect(sceneRect))
 				return;
-			auto windowRect = toWindowRect(viewRect);
-			painter->drawImage(windowRect, selectionSurface.crop(sceneRect).toQImageARGBPremult(selectionRgb));
+			painter->drawImage(viewRect, selectionSurface.crop(sceneRect).toQImageARGBPremult(selectionRgb));
 		};
 
 		drawDivided(repaintRect, drawInViewRect);
@@ -175,29 +153,6 @@ void CanvasViewportState::render(QPainter *painter, const QRect &windowRepaintRe
 			return this->mTransforms->viewToMipmap.mapRect(QRectF(rect)).toAlignedRect();
 		};
 
-		auto drawInViewRect = [&](const QRect &viewRect) {
-
-			auto sceneRect = viewRectToSceneRect(viewRect);
-			auto croppedImage = cropSurface(sceneRect);
-
-			QImage image(viewRect.size(), QImage::Format_ARGB32_Premultiplied);
-			{
-				QPainter imagePainter(&image);
-				imagePainter.setCompositionMode(QPainter::CompositionMode_Source);
-
-				if (this->mTransforms->scale < 2.0)
-					imagePainter.setRenderHint(QPainter::SmoothPixmapTransform);
-
-				imagePainter.setTransform( this->mTransforms->mipmapToView * QTransform::fromTranslate(-viewRect.left(), -viewRect.top()) );
-				imagePainter.drawImage(sceneRect.topLeft(), wrapInQImage(croppedImage));
-			}
-
-			if ((sceneRect & QRect(QPoint(), this->mDocumentSize)).isEmpty())
-				painter->drawRect(toWindowRect(viewRect));
-			else
-				painter->drawImage(toWindowRect(viewRect), image);
-		};
-
 		auto drawSelectionInViewRect = [&](const QRect &viewRect) {
 
 			auto sceneRect = viewRectToSceneRect(viewRect);
@@ -213,11 +168,9 @@ void CanvasViewportState::render(QPainter *painter, const QRect &windowRepaintRe
 				imagePainter.drawImage(sceneRect.topLeft(), croppedImage.qimage());
 			}
 
-			painter->drawImage(toWindowRect(viewRect), image.toQImageARGBPremult(selectionRgb));
+			painter->drawImage(viewRect, image.toQImageARGBPremult(selectionRgb));
 		};
 
-		drawDivided(repaintRect, drawInViewRect);
-
 		if (hasSelection) {
 			painter->setCompositionMode(QPainter::CompositionMode_SourceOver);
 			drawDivided(repaintRect, drawSelectionInViewRect);
@@ -227,89 +180,111 @@ void CanvasViewportState::render(QPainter *painter, const QRect &windowRepaintRe
 
 void CanvasViewportState::setTransforms(const SP<const CanvasTransforms> &transforms)
 {
-	this->mMipmap.setCurrentLevel(transforms->mipmapLevel);
-	this->mSelectionMipmap.setCurrentLevel(transforms->mipmapLevel);
+	if (this->mCache)
+		this->mCache->setLevel(this, transforms->mipmapLevel);
 	this->mTransforms = transforms;
 	this->mTranslationOnly = (transforms->mipmapScale == 1.0 && transforms->rotation == 0.0 && !transforms->mirrored);
 	this->mTranslationToScene = QPointF(transforms->viewToMipmap.dx(), transforms->viewToMipmap.dy()).toPoint();
+
+	// "transforms" is shared and modified in place, so compare against a copy
+	auto &last = this->mBackingStoreTransforms;
+	bool onlyTranslated = !this->mBackingStore.isNull()
+		&& last.viewSize == transforms->viewSize
+		&& last.sceneSize == transforms->sceneSize
+		&& last.scale == transforms->scale
+		&& last.rotation == transforms->rotation
+		&& last.mirrored == transforms->mirrored
+		&& last.retinaMode == transforms->retinaMode
+		&& last.mipmapLevel == transforms->mipmapLevel;
+
+	if (onlyTranslated) {
+		scrollBackingStore(transforms->translation - last.translation);
+	} else {
+		if (this->mBackingStore.size() != transforms->viewSize)
+			this->mBackingStore = QImage(transforms->viewSize, QImage::Format_ARGB32_Premultiplied);
+		invalidateBackingStore();
+	}
+
+	last = *transforms;
 }
 
 void CanvasViewportState::setDocumentSize(const QSize &size)
 {
 	this->mDocumentSize = size;
-	this->mMipmap.setSceneSize(size);
-	this->mSelectionMipmap.setSceneSize(size);
+	invalidateBackingStore();
 }
 
-QRect CanvasViewportState::updateTiles(const boost::variant<QPointSet, QHash<QPoint, QRect>> &keysOrRectForKeys)
+void CanvasViewportState::countBackingStoreMemory(MemoryCounter &counter) const
 {
-	int rectCount;
-
-	QPointSet keys;
-	QHash<QPoint, QRect> rectsForKeys;
-
-	if (keysOrRectForKeys.which() == 0) {
-		keys = boost::get<QPointSet>(keysOrRectForKeys);
-		rectCount = keys.size();
-	} else {
-		rectsForKeys = boost::get<QHash<QPoint, QRect>>(keysOrRectForKeys);
-		rectCount = rectsForKeys.size();
-	}
-
-	QRect rectToBeRepainted;
-	QVector<QRect> rects;
-	rects.reserve(rectCount);
+	counter.addImage(this->mBackingStore);
+}
 
-	// render layers
-	Malachite::Surface surface;
-	{
-		CanvasRenderer renderer(this->mTool);
-		surface = renderer.renderToSurface({mCanvas->document()->layerScene()->rootLayer()}, keys, rectsForKeys);
-	}
+void CanvasViewportState::invalidateBackingStore()
+{
+	this->mBackingStoreDirtyRegion = this->mBackingStore.rect();
+}
 
-	auto documentRect = QRect(QPoint(), this->mDocumentSize);
+void CanvasViewportState::scrollBackingStore(const QPoint &delta)
+{
+	if (delta == QPoint())
+		return;
 
-	const Malachite::Pixel whitePixel(1.f);
-	auto blendOp = Malachite::BlendMode(Malachite::BlendMode::DestinationOver).op();
+	auto rect = this->mBackingStore.rect();
+	auto srcRect = rect & rect.translated(-delta);
+	auto dstRect = srcRect.translated(delta);
 
-	auto updateTile = [&](const QPoint &key, const QRect &unclippedRelativeRect) {
+	if (!srcRect.isEmpty()) {
+		constexpr int bytesPerPixel = 4;
+		auto rowBytes = srcRect.width() * bytesPerPixel;
 
-		auto relativeDocumentRect = documentRect.translated(-key * Malachite::Surface::tileWidth());
-		auto relativeRect = unclippedRelativeRect & relativeDocumentRect;
-		if (relativeRect.isEmpty())
-			return;
+		auto moveRow = [&](int srcY) {
+			auto dst = this->mBackingStore.scanLine(srcY + delta.y()) + dstRect.left() * bytesPerPixel;
+			auto src = this->mBackingStore.constScanLine(srcY) + srcRect.left() * bytesPerPixel;
+			std::memmove(dst, src, rowBytes);
+		};
 
-		auto absoluteRect = relativeRect.translated(key * Malachite::Surface::tileWidth());
+		// do not overwrite rows that are not moved yet
+		if (delta.y() > 0) {
+			for (int y = srcRect.bottom(); y >= srcRect.top(); --y)
+				moveRow(y);
+		} else {
+			for (int y = srcRect.top(); y <= srcRect.bottom(); ++y)
+				moveRow(y);
+		}
+	}
 
-		auto image = surface.crop(absoluteRect);
-		blendOp->blend(image.area(), image.begin(), whitePixel);
+	// newly exposed strips and moved dirty regions have to be drawn again
+	this->mBackingStoreDirtyRegion = (this->mBackingStoreDirtyRegion.translated(delta) & rect) | (QRegion(rect) - QRegion(dstRect));
+}
 
-		auto imageU8 = image.toImageU8();
-		this->mMipmap.replace(imageU8, key, relativeRect.topLeft());
+QRect CanvasViewportState::fromWindowRect(const QRect &rect) const
+{
+	if (this->mRetinaMode)
+		return QRect(rect.left() * 2, rect.top() * 2, rect.width() * 2, rect.height() * 2);
+	else
+		return rect;
+}
 
-		rectToBeRepainted |= absoluteRect;
-		rects << absoluteRect;
+QRect CanvasViewportState::toWindowRect(const QRect &rect) const
+{
+	if (this->mRetinaMode)
+		return QRect(rect.left() / 2, rect.top() / 2, rect.width() / 2, rect.height() / 2);
+	else
+		return rect;
+}
 
-		if (rectCount == 1) {
-			this->mCacheAvailable = true;
-			this->mCacheRect = absoluteRect;
-			this->mCacheImage = imageU8;
-		} else {
-			this->mCacheAvailable = false;
-		}
-	};
+QRect CanvasViewportState::updateTiles(const QHash<QPoint, QRect> &rectsForKeys)
+{
+	return invalidateSceneRect(this->mCache->render(this, rectsForKeys, this->mTool));
+}
 
-	if (keysOrRectForKeys.which() == 1) {
-		for (auto iter = rectsForKeys.begin(); iter != rectsForKeys.end(); ++iter)
-			updateTile(iter.key(), iter.value());
-	} else {
-		for (const QPoint &key : keys) {
-			const auto rect = QRect(QPoint(), Malachite::Surface::tileSize());
-			updateTile(key, rect);
-		}
-	}
+QRect CanvasViewportState::invalidateSceneRect(const QRect &sceneRect)
+{
+	if (sceneRect.isEmpty() || !this->mTransforms)
+		return QRect();
 
-	auto viewRect = this->mTransforms->sceneToView.mapRect(rectToBeRepainted);
+	auto viewRect = this->mTransforms->sceneToView.mapRect(sceneRect);
+	this->mBackingStoreDirtyRegion |= viewRect;
 
 	if (this->mRetinaMode)
 		viewRect = QRectF(viewRect.left() * 0.5, viewRect.top() * 0.5, viewRect.width() * 0.5, viewRect.height() * 0.5).toAlignedRect();
@@ -317,13 +292,5 @@ QRect CanvasViewportState::updateTiles(const boost::variant<QPointSet, QHash<QPo
 	return viewRect;
 }
 
-QRect CanvasViewportState::updateSelectionTiles(const SelectionSurface &surface, const QPointSet &keys)
-{
-	this->mSelectionMipmap.replace(surface, keys);
-	return keys++.foldLeft(QRect(), [](const QRect &memo, const QPoint &key) {
-		return memo | QRect(key * SelectionSurface::tileWidth(), SelectionSurface::tileSize());
-	});
-}
-
 } // namespace PaintField
 
@@ -1,55 +1,79 @@
 #pragma once
 
-#include "selectionsurface.h"
-#include "canvasviewportmipmap.h"
+#include "canvasviewportcache.h"
 #include "canvastransforms.h"
 #include <QRect>
-#include <boost/variant.hpp>
+#include <QRegion>
+#include <QImage>
 
 namespace PaintField
 {
 
-class Canvas;
 class Tool;
+class MemoryCounter;
 
+/**
+ * The CanvasViewportState draws the document into a viewport.
+ * The composited image comes from the CanvasViewportCache shared by the viewports of the document.
+ */
 class CanvasViewportState
 {
 public:
 
+	~CanvasViewportState();
+
 	void render(QPainter *painter, const QRect &windowRepaintRect);
 
-	void setCanvas(Canvas *canvas) { this->mCanvas = canvas; }
-	void setTool(Tool *tool) { this->mTool = tool; }
+	void setCache(const SP<CanvasViewportCache> &cache);
+	SP<CanvasViewportCache> cache() const { return this->mCache; }
+
+	void setTool(Tool *tool);
 
 	void setTransforms(const SP<const CanvasTransforms> &transforms);
 	void setRetinaMode(bool mode) { this->mRetinaMode = mode; }
 	void setDocumentSize(const QSize &size);
 
-	QRect updateTiles(const boost::variant<QPointSet, QHash<QPoint, QRect>> &keysOrRectForKeys);
-	QRect updateSelectionTiles(const SelectionSurface &surface, const QPointSet &keys);
+	/**
+	 * Composites the given tiles if no other viewport did yet.
+	 * @return The window rect to be repainted
+	 */
+	QRect updateTiles(const QHash<QPoint, QRect> &rectsForKeys);
+
+	/**
+	 * Marks a scene rect updated in the shared cache to be redrawn.
+	 * @return The window rect to be repainted
+	 */
+	QRect invalidateSceneRect(const QRect &sceneRect);
 
-	CanvasViewportSurface mergedSurface() const { return this->mMipmap.baseSurface(); }
+	CanvasViewportSurface mergedSurface() const { return this->mCache->mergedSurface(); }
+
+	void countBackingStoreMemory(MemoryCounter &counter) const;
 
 private:
 
-	Canvas *mCanvas = 0;
+	void renderToBackingStore(const QRect &repaintRect);
+	void invalidateBackingStore();
+	void scrollBackingStore(const QPoint &delta);
+
+	QRect fromWindowRect(const QRect &rect) const;
+	QRect toWindowRect(const QRect &rect) const;
+
+	SP<CanvasViewportCache> mCache;
 	Tool *mTool = 0;
 
 	QSize mDocumentSize;
 	
-	CanvasViewportMipmap mMipmap;
-	SelectionMipmap mSelectionMipmap;
-	
 	SP<const CanvasTransforms> mTransforms;
 	
 	bool mTranslationOnly = false;
 	QPoint mTranslationToScene;
 	
 	bool mRetinaMode = false;
-	
-	bool mCacheAvailable = false;
-	QRect mCacheRect;
-	Malachite::ImageU8 mCacheImage;
+
+	// view-sized copy of what is on screen, scrolled instead of redrawn when only the translation changes
+	QImage mBackingStore;
+	QRegion mBackingStoreDirtyRegion;
+	CanvasTransforms mBackingStoreTransforms;
 };
 
 }
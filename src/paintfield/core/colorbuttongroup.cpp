@@ -63,6 +63,11 @@ Malachite::Color ColorButtonGroup::currentColor() const
 		return Malachite::Color();
 }
 
+ColorButton *ColorButtonGroup::currentButton() const
+{
+	return d->current;
+}
+
 void ColorButtonGroup::setCurrentColor(const Malachite::Color &color)
 {
 	if (d->current)
@@ -25,6 +25,7 @@ public:
 	void add(ColorButton *button);
 	
 	Malachite::Color currentColor() const;
+	ColorButton *currentButton() const;
 	
 	bool eventFilter(QObject *object, QEvent *event);
 	
@@ -45,6 +45,7 @@ HEADERS += \
     signalconverter.h \
     callbackanimation.h \
     librarymodel.h \
+    libraryindexer.h \
     keytracker.h \
     dialogs/filedialog.h \
     canvastabwidget.h \
@@ -68,6 +69,7 @@ HEADERS += \
     shapelayer.h \
     layerfactorymanager.h \
     documentcontroller.h \
+    documentloader.h \
     documentreferencemanager.h \
     rectlayer.h \
     layerscene.h \
@@ -82,6 +84,7 @@ HEADERS += \
     canvasviewportmipmap.h \
     canvasviewportsurface.h \
     canvasviewportstate.h \
+    canvasviewportcache.h \
     blendmodetexts.h \
     formatsupport.h \
     singlelayerformatsupport.h \
@@ -96,8 +99,15 @@ HEADERS += \
     canvastooleventfilter.h \
     canvasnavigatoreventfilter.h \
     canvasview.h \
-    canvasupdatemanager.h \
+    canvasupdatescheduler.h \
+    canvasviewportresampler.h \
+    tiledirtymap.h \
     selectionsurface.h \
+    softselection.h \
+    floodfill.h \
+    memoryaccountant.h \
+    startupprofiler.h \
+    dialogs/memoryusagedialog.h \
     closureundocommand.h \
     canvastransforms.h \
     canvascursorevent.h
@@ -135,6 +145,7 @@ SOURCES += \
     signalconverter.cpp \
     callbackanimation.cpp \
     librarymodel.cpp \
+    libraryindexer.cpp \
     keytracker.cpp \
     dialogs/filedialog.cpp \
     canvastabwidget.cpp \
@@ -156,6 +167,7 @@ SOURCES += \
     shapelayer.cpp \
     layerfactorymanager.cpp \
     documentcontroller.cpp \
+    documentloader.cpp \
     documentreferencemanager.cpp \
     rectlayer.cpp \
     layerscene.cpp \
@@ -181,9 +193,17 @@ SOURCES += \
     canvasnavigatoreventfilter.cpp \
     canvastooleventfilter.cpp \
     canvasview.cpp \
-    canvasupdatemanager.cpp \
+    canvasupdatescheduler.cpp \
+    canvasviewportresampler.cpp \
+    tiledirtymap.cpp \
     selectionsurface.cpp \
-    canvasviewportstate.cpp
+    softselection.cpp \
+    floodfill.cpp \
+    memoryaccountant.cpp \
+    startupprofiler.cpp \
+    dialogs/memoryusagedialog.cpp \
+    canvasviewportstate.cpp \
+    canvasviewportcache.cpp
 
 RESOURCES += \
     resources/resource-paintfield-core.qrc
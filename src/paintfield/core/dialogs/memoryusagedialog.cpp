@@ -0,0 +1,113 @@
+#include <QVBoxLayout>
+#include <QTreeWidget>
+#include <QHeaderView>
+#include <QLabel>
+#include <QDialogButtonBox>
+#include <QPushButton>
+
+#include "../document.h"
+#include "../memoryaccountant.h"
+
+#include "memoryusagedialog.h"
+
+namespace PaintField
+{
+
+namespace
+{
+
+QString bytesText(qint64 bytes)
+{
+	return QString::number(bytes / (1024.0 * 1024.0), 'f', 1) + " MB";
+}
+
+}
+
+struct MemoryUsageDialog::Data
+{
+	MemoryAccountant *accountant = 0;
+	QLabel *totalLabel = 0;
+	QTreeWidget *tree = 0;
+};
+
+MemoryUsageDialog::MemoryUsageDialog(MemoryAccountant *accountant, QWidget *parent) :
+	QDialog(parent),
+	d(new Data)
+{
+	d->accountant = accountant;
+	
+	resize(400, 400);
+	setWindowTitle(tr("Memory Usage"));
+	
+	auto layout = new QVBoxLayout();
+	
+	d->totalLabel = new QLabel();
+	layout->addWidget(d->totalLabel);
+	
+	d->tree = new QTreeWidget();
+	d->tree->setColumnCount(2);
+	d->tree->setHeaderLabels({ tr("Name"), tr("Size") });
+	d->tree->header()->setSectionResizeMode(0, QHeaderView::Stretch);
+	layout->addWidget(d->tree);
+	
+	auto buttons = new QDialogButtonBox(QDialogButtonBox::Close);
+	auto refreshButton = buttons->addButton(tr("Refresh"), QDialogButtonBox::ActionRole);
+	connect(refreshButton, SIGNAL(clicked()), accountant, SLOT(refresh()));
+	connect(buttons, SIGNAL(rejected()), this, SLOT(reject()));
+	layout->addWidget(buttons);
+	
+	setLayout(layout);
+	
+	connect(accountant, SIGNAL(usageChanged()), this, SLOT(updateItems()));
+	updateItems();
+}
+
+MemoryUsageDialog::~MemoryUsageDialog()
+{
+	delete d;
+}
+
+void MemoryUsageDialog::updateItems()
+{
+	auto accountant = d->accountant;
+	
+	auto budget = accountant->budget();
+	auto totalText = tr("Total: %1").arg(bytesText(accountant->totalUsage()));
+	if (budget > 0)
+		totalText += " / " + bytesText(budget);
+	d->totalLabel->setText(totalText);
+	
+	d->tree->clear();
+	
+	auto addCategoryItems = [accountant](QTreeWidgetItem *parent, Document *document) {
+		for (int i = 0; i < MemoryAccountant::CategoryCount; ++i)
+		{
+			auto category = MemoryAccountant::Category(i);
+			auto bytes = accountant->usage(document, category);
+			if (bytes)
+				new QTreeWidgetItem(parent, { MemoryAccountant::categoryName(category), bytesText(bytes) });
+		}
+	};
+	
+	for (auto document : accountant->documents())
+	{
+		auto item = new QTreeWidgetItem(d->tree, { document->fileName(), bytesText(accountant->usage(document)) });
+		addCategoryItems(item, document);
+		
+		auto layersItem = new QTreeWidgetItem(item, { tr("Layer Tiles"), QString() });
+		for (const auto &usage : MemoryAccountant::layerUsages(document))
+			new QTreeWidgetItem(layersItem, { usage.first->name(), bytesText(usage.second) });
+		
+		item->setExpanded(true);
+	}
+	
+	// memory not owned by any document
+	auto otherBytes = accountant->usage(static_cast<Document *>(0));
+	if (otherBytes)
+	{
+		auto item = new QTreeWidgetItem(d->tree, { tr("Other"), bytesText(otherBytes) });
+		addCategoryItems(item, 0);
+	}
+}
+
+}
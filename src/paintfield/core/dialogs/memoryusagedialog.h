@@ -0,0 +1,31 @@
+#pragma once
+
+#include <QDialog>
+
+namespace PaintField
+{
+
+class MemoryAccountant;
+
+/**
+ * The MemoryUsageDialog shows the memory usage of each document by category and by layer.
+ */
+class MemoryUsageDialog : public QDialog
+{
+	Q_OBJECT
+	
+public:
+	explicit MemoryUsageDialog(MemoryAccountant *accountant, QWidget *parent = 0);
+	~MemoryUsageDialog();
+	
+private slots:
+	
+	void updateItems();
+	
+private:
+	
+	struct Data;
+	Data *d;
+};
+
+}
@@ -19,6 +19,8 @@ struct Document::Data
 	QString filePath;
 	QString tempName;	// like "untitled"
 	bool modified = false;
+	bool loading = false;
+	QImage preview;
 	QUndoStack *undoStack = 0;
 	
 	LayerScene *layerScene = 0;
@@ -73,6 +75,10 @@ LayerScene *Document::layerScene() { return d->layerScene; }
 
 Selection *Document::selection() { return d->selection; }
 
+bool Document::isLoading() const { return d->loading; }
+
+QImage Document::preview() const { return d->preview; }
+
 void Document::setModified(bool modified)
 {
 	if (d->modified == modified)
@@ -96,6 +102,19 @@ void Document::setFilePath(const QString &filePath)
 	emit fileNameChanged(fileName());
 }
 
+void Document::setLoading(bool loading)
+{
+	if (d->loading == loading)
+		return;
+	d->loading = loading;
+	emit loadingChanged(loading);
+}
+
+void Document::setPreview(const QImage &preview)
+{
+	d->preview = preview;
+}
+
 void Document::onUndoneOrRedone()
 {
 	emit modified();
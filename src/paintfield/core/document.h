@@ -2,6 +2,7 @@
 
 #include "layer.h"
 #include <QUndoStack>
+#include <QImage>
 
 namespace PaintField {
 
@@ -15,6 +16,7 @@ class Document : public QObject
 	Q_PROPERTY(bool modified READ isModified WRITE setModified NOTIFY modifiedChanged)
 	Q_PROPERTY(QString filePath READ filePath WRITE setFilePath NOTIFY filePathChanged)
 	Q_PROPERTY(QString fileName READ fileName NOTIFY fileNameChanged)
+	Q_PROPERTY(bool loading READ isLoading WRITE setLoading NOTIFY loadingChanged)
 
 public:
 
@@ -79,8 +81,20 @@ public:
 	
 	Selection *selection();
 	
+	/**
+	 * @return Whether layer data is still being loaded in the background (the document cannot be edited or saved until then)
+	 */
+	bool isLoading() const;
+	
+	/**
+	 * @return The flattened preview embedded in the document file, shown until the layer data is loaded (null if there is none)
+	 */
+	QImage preview() const;
+	
 	void setModified(bool modified);
 	void setFilePath(const QString &filePath);
+	void setLoading(bool loading);
+	void setPreview(const QImage &preview);
 	
 signals:
 	
@@ -89,6 +103,7 @@ signals:
 	void filePathChanged(const QString &filePath);
 	void fileNameChanged(const QString &fileName);
 	void sizeChanged(const QSize &size);
+	void loadingChanged(bool loading);
 	
 public slots:
 	
@@ -10,6 +10,7 @@
 #include "formatsupport.h"
 #include "formatsupportmanager.h"
 #include "document.h"
+#include "documentloader.h"
 #include "dialogs/newdocumentdialog.h"
 #include "dialogs/filedialog.h"
 #include "dialogs/messagebox.h"
@@ -83,23 +84,23 @@ Document *DocumentController::createFromSavedFile(const QString &path)
 {
 	PAINTFIELD_DEBUG << path;
 	
-	QList<LayerRef> layers;
-	QSize size;
-	QString name;
-	
-	bool result = FormatSupport::importFromFile(
-			path,
-			{appController()->formatSupportManager()->paintFieldFormatSupport()},
-			&layers,
-			&size,
-			&name
-	);
+	// the canvas is shown while the layer data is still loading
+	DocumentLoader *loader;
+	auto document = DocumentLoader::open(path, &loader);
 	
-	if (!result)
+	if (!document)
+	{
+		MessageBox::show(QMessageBox::Warning, tr("Failed to read file."), QString());
 		return nullptr;
+	}
 	
-	auto document = new Document(name, size, layers, 0);
-	document->setFilePath(path);
+	if (loader)
+	{
+		connect(loader, &DocumentLoader::finished, [](bool succeeded) {
+			if (!succeeded)
+				MessageBox::show(QMessageBox::Warning, tr("Some layers could not be read."), QString());
+		});
+	}
 	
 	return document;
 }
@@ -149,8 +150,20 @@ bool DocumentController::confirmClose(Document *document)
 	}
 }
 
+bool DocumentController::confirmLoaded(Document *document)
+{
+	if (!document->isLoading())
+		return true;
+	
+	MessageBox::show(QMessageBox::Information, tr("The document is still loading."), tr("Try again when it has finished loading."));
+	return false;
+}
+
 bool DocumentController::saveAs(Document *document)
 {
+	if (!confirmLoaded(document))
+		return false;
+	
 	return FormatSupport::exportToFileDialog(
 			0,
 			tr("Save As"),
@@ -166,6 +179,9 @@ bool DocumentController::save(Document *document)
 	if (!document->isModified())
 		return true;
 	
+	if (!confirmLoaded(document))
+		return false;
+	
 	if (document->filePath().isEmpty())	// first save
 		return saveAs(document);
 	
@@ -189,6 +205,9 @@ bool DocumentController::save(Document *document)
 
 bool DocumentController::exportToImage(Document *document, QWidget *dialogParent)
 {
+	if (!confirmLoaded(document))
+		return false;
+	
 	return FormatSupport::exportToFileDialog(
 			dialogParent,
 			tr("Export"),
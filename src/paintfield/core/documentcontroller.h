@@ -86,6 +86,11 @@ public slots:
 	
 private:
 	
+	/**
+	 * Shows a message and returns false if the document is still loading.
+	 */
+	static bool confirmLoaded(Document *document);
+	
 	Document *_document = 0;
 	QPointer<QWidget> _dialogParent;
 };
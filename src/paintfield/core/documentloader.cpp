@@ -0,0 +1,177 @@
+#include <QFile>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QtConcurrent>
+
+#include "document.h"
+#include "layerscene.h"
+#include "rasterlayer.h"
+#include "thumbnail.h"
+
+#include "documentloader.h"
+
+using namespace Malachite;
+
+namespace PaintField {
+
+namespace {
+
+// the longer side of the preview shown on the canvas while loading
+constexpr int previewSize = 1024;
+
+struct LoadResult
+{
+	Surface surface;
+	bool succeeded = false;
+};
+
+/**
+ * Decodes the data of a raster layer (called from worker threads).
+ * The layers of the document are not touched; the data is read into a new layer.
+ */
+LoadResult loadSurface(const QString &path, const QString &source)
+{
+	LoadResult result;
+	
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		PAINTFIELD_WARNING << "cannot open" << path;
+		return result;
+	}
+	
+	auto layer = makeSP<RasterLayer>();
+	result.succeeded = PaintFieldFormatSupport::readLayerData(&file, layer, source);
+	result.surface = layer->surface();
+	return result;
+}
+
+} // anonymous namespace
+
+struct DocumentLoader::Data
+{
+	Document *document = 0;
+	QString path;
+	QList<PaintFieldFormatSupport::LayerSource> sources;
+	
+	int loadedCount = 0;
+	bool succeeded = true;
+};
+
+DocumentLoader::DocumentLoader(Document *document, const QString &path, const QList<PaintFieldFormatSupport::LayerSource> &sources) :
+	QObject(document),
+	d(new Data)
+{
+	d->document = document;
+	d->path = path;
+	d->sources = sources;
+}
+
+DocumentLoader::~DocumentLoader()
+{
+}
+
+Document *DocumentLoader::open(const QString &path, DocumentLoader **loader)
+{
+	if (loader)
+		*loader = 0;
+	
+	QList<LayerRef> layers;
+	QSize size;
+	QList<PaintFieldFormatSupport::LayerSource> sources;
+	QImage preview;
+	
+	{
+		QFile file(path);
+		if (!file.open(QIODevice::ReadOnly))
+		{
+			PAINTFIELD_WARNING << "cannot open" << path;
+			return 0;
+		}
+		
+		if (!PaintFieldFormatSupport::readStructure(&file, &layers, &size, &sources))
+			return 0;
+		
+		if (!sources.isEmpty() && file.seek(0))
+			preview = PaintFieldFormatSupport::readPreview(&file, previewSize);
+	}
+	
+	auto document = new Document(QFileInfo(path).baseName(), size, layers, 0);
+	document->setFilePath(path);
+	
+	if (!sources.isEmpty())
+	{
+		document->setPreview(preview);
+		
+		// the embedded thumbnails are shown instead of the empty layers until the data is loaded
+		for (const auto &source : sources)
+		{
+			if (source.thumbnail.isNull())
+				continue;
+			source.layer->setThumbnail(Thumbnail::createThumbnail(QPixmap::fromImage(source.thumbnail)));
+			source.layer->setThumbnailDirty(false);
+		}
+		
+		auto documentLoader = new DocumentLoader(document, path, sources);
+		documentLoader->start();
+		if (loader)
+			*loader = documentLoader;
+	}
+	
+	return document;
+}
+
+Document *DocumentLoader::document() const
+{
+	return d->document;
+}
+
+int DocumentLoader::loadedCount() const
+{
+	return d->loadedCount;
+}
+
+int DocumentLoader::totalCount() const
+{
+	return d->sources.size();
+}
+
+void DocumentLoader::start()
+{
+	d->document->setLoading(true);
+	
+	for (const auto &source : d->sources)
+	{
+		auto layer = source.layer;
+		auto watcher = new QFutureWatcher<LoadResult>(this);
+		
+		connect(watcher, &QFutureWatcher<LoadResult>::finished, this, [this, watcher, layer] {
+			auto result = watcher->result();
+			watcher->deleteLater();
+			onLayerLoaded(layer, result.surface, result.succeeded);
+		});
+		
+		watcher->setFuture(QtConcurrent::run(loadSurface, d->path, source.source));
+	}
+}
+
+void DocumentLoader::onLayerLoaded(const LayerRef &layer, const Surface &surface, bool succeeded)
+{
+	if (succeeded)
+		d->document->layerScene()->setLoadedSurface(layer, surface);
+	else
+		d->succeeded = false;
+	
+	++d->loadedCount;
+	emit progressChanged(d->loadedCount, totalCount());
+	
+	if (d->loadedCount == totalCount())
+	{
+		d->document->setLoading(false);
+		d->document->setPreview(QImage());
+		emit finished(d->succeeded);
+		deleteLater();
+	}
+}
+
+} // namespace PaintField
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <QObject>
+#include "paintfieldformatsupport.h"
+
+namespace PaintField {
+
+class Document;
+
+/**
+ * The DocumentLoader opens PaintField documents without waiting for the layer data.
+ *
+ * The header and the layer tree are read first and the document can be shown at once.
+ * The raster layer data is decoded on worker threads (each with its own archive reader)
+ * and set to the layers as each of them finishes.
+ * Until then, the canvas shows the flattened preview and the layers show the thumbnails embedded in the file.
+ */
+class DocumentLoader : public QObject
+{
+	Q_OBJECT
+public:
+	
+	~DocumentLoader();
+	
+	/**
+	 * Opens a .pfield document.
+	 * The document stays in the loading state (Document::isLoading) until all layer data is loaded.
+	 * @param loader Set to the loader of the document (0 if there is no layer data to load)
+	 * @return The document (0 if the file cannot be read)
+	 */
+	static Document *open(const QString &path, DocumentLoader **loader = 0);
+	
+	Document *document() const;
+	
+	int loadedCount() const;
+	int totalCount() const;
+	
+signals:
+	
+	void progressChanged(int loaded, int total);
+	
+	/**
+	 * Emitted when all layer data is loaded. The loader is deleted afterwards.
+	 * @param succeeded Whether the data of every layer could be read
+	 */
+	void finished(bool succeeded);
+	
+private:
+	
+	DocumentLoader(Document *document, const QString &path, const QList<PaintFieldFormatSupport::LayerSource> &sources);
+	
+	void start();
+	void onLayerLoaded(const LayerRef &layer, const Malachite::Surface &surface, bool succeeded);
+	
+	struct Data;
+	QScopedPointer<Data> d;
+};
+
+} // namespace PaintField
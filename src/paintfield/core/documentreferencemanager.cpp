@@ -1,9 +1,13 @@
 
 #include <QHash>
+#include <QUndoStack>
 
 #include "canvas.h"
 #include "document.h"
 #include "documentcontroller.h"
+#include "layerscene.h"
+#include "appcontroller.h"
+#include "memoryaccountant.h"
 
 #include "documentreferencemanager.h"
 
@@ -13,8 +17,34 @@ struct DocumentReferenceManager::Data
 {
 	QHash<Document *, QSet<Canvas *> > documentsToCanvasLists;
 	
+	void addDocumentMemorySources(Document *document)
+	{
+		auto accountant = appController()->memoryAccountant();
+		
+		accountant->addSource(document, MemoryAccountant::CategoryLayers, document, [document](MemoryCounter &counter) {
+			counter.addLayer(document->layerScene()->rootLayer());
+		});
+		accountant->addSource(document, MemoryAccountant::CategoryUndo, document, [document](MemoryCounter &counter) {
+			document->layerScene()->countUndoMemory(counter);
+		});
+		accountant->addSource(document, MemoryAccountant::CategoryThumbnails, document, [document](MemoryCounter &counter) {
+			std::function<void (const LayerConstRef &)> addThumbnails = [&](const LayerConstRef &layer) {
+				counter.addPixmap(layer->thumbnail());
+				for (const auto &child : layer->children())
+					addThumbnails(child);
+			};
+			addThumbnails(document->layerScene()->rootLayer());
+		});
+		
+		// the budget is checked after edits and once the layer data is loaded
+		QObject::connect(document->undoStack(), &QUndoStack::indexChanged, accountant, &MemoryAccountant::scheduleRefresh);
+		QObject::connect(document, &Document::loadingChanged, accountant, &MemoryAccountant::scheduleRefresh);
+		accountant->scheduleRefresh();
+	}
+	
 	void removeDocument(Document *document)
 	{
+		appController()->memoryAccountant()->removeSources(document);
 		document->deleteLater();
 		documentsToCanvasLists.remove(document);
 	}
@@ -34,6 +64,10 @@ void DocumentReferenceManager::addCanvas(Canvas *canvas)
 {
 	auto document = canvas->document();
 	document->setParent(this);
+	
+	if (!d->documentsToCanvasLists.contains(document))
+		d->addDocumentMemorySources(document);
+	
 	d->documentsToCanvasLists[document] << canvas;
 }
 
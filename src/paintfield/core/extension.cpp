@@ -9,6 +9,7 @@ struct Extension::Data
 {
 	QActionList actions;
 	QHash<QString, QWidget *> sideBars;
+	QHash<QString, std::function<QWidget *()>> sideBarFactories;
 };
 
 Extension::Extension(QObject *parent) :
@@ -42,9 +43,20 @@ QHash<QString, QWidget *> Extension::sideBars() { return d->sideBars; }
 
 QWidget *Extension::sideBar(const QString &id)
 {
+	if (d->sideBarFactories.contains(id))
+	{
+		auto createSideBar = d->sideBarFactories.take(id);
+		addSideBar(id, createSideBar());
+	}
+	
 	return d->sideBars.value(id, 0);
 }
 
+bool Extension::hasSideBar(const QString &id)
+{
+	return d->sideBars.contains(id) || d->sideBarFactories.contains(id);
+}
+
 void Extension::addSideBar(const QString &id, QWidget *sideBar)
 {
 	Q_CHECK_PTR(sideBar);
@@ -58,6 +70,14 @@ void Extension::addSideBar(const QString &id, QWidget *sideBar)
 	d->sideBars.insert(id, sideBar);
 }
 
+void Extension::addSideBar(const QString &id, const std::function<QWidget *()> &createSideBar)
+{
+	if (hasSideBar(id))
+		return;
+	
+	d->sideBarFactories.insert(id, createSideBar);
+}
+
 Tool *Extension::createTool(const QString &, Canvas *)
 {
 	return 0;
@@ -115,34 +135,27 @@ Tool *createTool(const AppExtensionList &appModules, const WorkspaceExtensionLis
 	return 0;
 }
 
-QWidget *sideBarForWorkspace(const AppExtensionList &appExtensions, const WorkspaceExtensionList &workspaceExtensions, const QString &name)
+Extension *sideBarExtensionForWorkspace(const AppExtensionList &appExtensions, const WorkspaceExtensionList &workspaceExtensions, const QString &name)
 {
-	QWidget *sidebar;
-	
 	for (Extension *module : appExtensions)
 	{
-		sidebar = module->sideBar(name);
-		if (sidebar)
-			return sidebar;
+		if (module->hasSideBar(name))
+			return module;
 	}
 	for (Extension *module : workspaceExtensions)
 	{
-		sidebar = module->sideBar(name);
-		if (sidebar)
-			return sidebar;
+		if (module->hasSideBar(name))
+			return module;
 	}
 	return 0;
 }
 
-QWidget *sideBarForCanvas(const CanvasExtensionList &canvasExtensions, const QString &name)
+Extension *sideBarExtensionForCanvas(const CanvasExtensionList &canvasExtensions, const QString &name)
 {
-	QWidget *sidebar;
-	
 	for (Extension *module : canvasExtensions)
 	{
-		sidebar = module->sideBar(name);
-		if (sidebar)
-			return sidebar;
+		if (module->hasSideBar(name))
+			return module;
 	}
 	return 0;
 }
@@ -4,6 +4,7 @@
 #include <QIcon>
 #include <QKeySequence>
 #include <QHash>
+#include <functional>
 
 class QAction;
 class QToolBar;
@@ -64,6 +65,18 @@ public:
 	QWidget *sideBar(const QString &id);
 	void addSideBar(const QString &id, QWidget *sideBar);
 	
+	/**
+	 * Adds a side bar which is created when it is first requested with sideBar() (when it is first shown).
+	 * Extensions use this to defer their initialization until the side bar is used.
+	 * @param createSideBar A function that creates the side bar
+	 */
+	void addSideBar(const QString &id, const std::function<QWidget *()> &createSideBar);
+	
+	/**
+	 * @return Whether the extension has the side bar, created or not
+	 */
+	bool hasSideBar(const QString &id);
+	
 private:
 	
 	struct Data;
@@ -118,8 +131,8 @@ namespace ExtensionUtil
 {
 
 Tool *createTool(const AppExtensionList &appExtensions, const WorkspaceExtensionList &workspaceExtensions, const CanvasExtensionList &canvasModules, const QString &name, Canvas *canvas);
-QWidget *sideBarForWorkspace(const AppExtensionList &appExtensions, const WorkspaceExtensionList &workspaceExtensions, const QString &name);
-QWidget *sideBarForCanvas(const CanvasExtensionList &canvasExtensions, const QString &name);
+Extension *sideBarExtensionForWorkspace(const AppExtensionList &appExtensions, const WorkspaceExtensionList &workspaceExtensions, const QString &name);
+Extension *sideBarExtensionForCanvas(const CanvasExtensionList &canvasExtensions, const QString &name);
 void updateToolBar(const AppExtensionList &appExtensions, const WorkspaceExtensionList &workspaceExtensions, const CanvasExtensionList &canvasExtensions, QToolBar *toolBar, const QString &name);
 
 }
@@ -2,6 +2,7 @@
 
 #include "appcontroller.h"
 #include "extension.h"
+#include "startupprofiler.h"
 
 #include "extensionmanager.h"
 
@@ -25,7 +26,10 @@ void ExtensionManager::addExtensionFactory(ExtensionFactory *factory)
 void ExtensionManager::initialize(AppController *app)
 {
 	for (auto factory : _factories)
+	{
+		StartupProfiler::Scope scope(app->startupProfiler(), factory->metaObject()->className());
 		factory->initialize(app);
+	}
 }
 
 QList<AppExtension *> ExtensionManager::createAppExtensions(AppController *app, QObject *parent)
@@ -33,7 +37,10 @@ QList<AppExtension *> ExtensionManager::createAppExtensions(AppController *app,
 	QList<AppExtension *> modules;
 	
 	for (ExtensionFactory *factory : _factories)
+	{
+		StartupProfiler::Scope scope(app->startupProfiler(), factory->metaObject()->className());
 		modules += factory->createAppExtensions(app, parent);
+	}
 	
 	return modules;
 }
@@ -42,9 +49,16 @@ QList<WorkspaceExtension  *> ExtensionManager::createWorkspaceExtensions(Workspa
 {
 	QList<WorkspaceExtension *> modules;
 	
+	// only timed while starting up, as workspaces are created later as well
+	auto profiler = appController()->startupProfiler();
+	if (profiler->isReady())
+		profiler = 0;
+	
 	for (ExtensionFactory *factory : _factories)
+	{
+		StartupProfiler::Scope scope(profiler, factory->metaObject()->className());
 		modules += factory->createWorkspaceExtensions(workspace, parent);
-	
+	}
 	
 	return modules;
 }
@@ -0,0 +1,400 @@
+#include <Malachite/Division>
+#include <QQueue>
+#include <functional>
+#include <emmintrin.h>
+
+#include "floodfill.h"
+
+using namespace Malachite;
+
+namespace PaintField {
+
+namespace {
+
+constexpr int tileWidth = Surface::tileWidth();
+
+inline bool testBit(const uchar *row, int x)
+{
+	return row[x >> 3] & (0x80 >> (x & 7));
+}
+
+inline void setBit(uchar *row, int x)
+{
+	row[x >> 3] |= 0x80 >> (x & 7);
+}
+
+class ColorMatcher
+{
+public:
+
+	ColorMatcher(const Pixel &seed, float tolerance) :
+		mSeed(seed.v()),
+		mTolerance(tolerance)
+	{}
+
+	bool matches(const Pixel &pixel) const
+	{
+		auto v = pixel.v();
+		auto diff = PixelVec::maximum(v - mSeed, mSeed - v);
+		return _mm_movemask_ps(_mm_cmple_ps(diff, mTolerance)) == 0xF;
+	}
+
+private:
+
+	PixelVec mSeed, mTolerance;
+};
+
+/**
+ * A horizontal run of seed pixels in tile coordinates.
+ */
+struct Span
+{
+	int y, left, right;
+};
+
+struct TileState
+{
+	enum Type
+	{
+		Rejected,
+		Uniform,
+		Mixed
+	};
+
+	Type type = Rejected;
+	QRect rect;	// the rect inside the bounds (in tile coordinates)
+	bool isFull = false;	// uniform tiles are filled at once
+	SelectionImage matches, filled;	// mixed tiles only
+};
+
+class Filler
+{
+public:
+
+	Filler(const std::function<Image (const QPoint &)> &tileSource, const Pixel &defaultPixel, const QRect &bounds, const ColorMatcher &matcher) :
+		mTileSource(tileSource),
+		mDefaultPixel(defaultPixel),
+		mBounds(bounds),
+		mMatcher(matcher)
+	{}
+
+	void addSeed(const QPoint &key, const Span &span)
+	{
+		auto iter = mStates.find(key);
+		if (iter != mStates.end() && (iter->type == TileState::Rejected || iter->isFull))
+			return;
+
+		auto rect = localBounds(key);
+		if (span.y < rect.top() || rect.bottom() < span.y)
+			return;
+
+		Span clipped { span.y, std::max(span.left, rect.left()), std::min(span.right, rect.right()) };
+		if (clipped.left > clipped.right)
+			return;
+
+		auto pending = mPendingSpans.find(key);
+		if (pending == mPendingSpans.end()) {
+			mQueue.enqueue(key);
+			pending = mPendingSpans.insert(key, {});
+		}
+		*pending << clipped;
+	}
+
+	void run()
+	{
+		while (!mQueue.isEmpty()) {
+			auto key = mQueue.dequeue();
+			processTile(key, mPendingSpans.take(key));
+		}
+	}
+
+	SelectionSurface result() const
+	{
+		SelectionSurface surface;
+
+		for (auto iter = mStates.begin(); iter != mStates.end(); ++iter) {
+			const auto &state = iter.value();
+
+			if (state.type == TileState::Uniform && state.isFull) {
+				SelectionImage tile(SelectionSurface::tileSize());
+				if (state.rect == QRect(0, 0, tileWidth, tileWidth)) {
+					tile.fill(true);
+				} else {
+					tile.fill(false);
+					for (int y = state.rect.top(); y <= state.rect.bottom(); ++y) {
+						auto row = tile.qimage().scanLine(y);
+						for (int x = state.rect.left(); x <= state.rect.right(); ++x)
+							setBit(row, x);
+					}
+				}
+				surface.setTile(iter.key(), tile);
+			} else if (state.type == TileState::Mixed && !state.filled.isBlank()) {
+				surface.setTile(iter.key(), state.filled);
+			}
+		}
+
+		return surface;
+	}
+
+private:
+
+	QRect localBounds(const QPoint &key) const
+	{
+		return (mBounds & Surface::keyToRect(key)).translated(key * -tileWidth);
+	}
+
+	/**
+	 * Reads the tile once and records which pixels match.
+	 */
+	void prepare(const QPoint &key, TileState &state)
+	{
+		state.rect = localBounds(key);
+
+		auto tile = mTileSource(key);
+		if (!tile.isValid()) {
+			state.type = mMatcher.matches(mDefaultPixel) ? TileState::Uniform : TileState::Rejected;
+			return;
+		}
+
+		SelectionImage matches(SelectionSurface::tileSize());
+		matches.fill(false);
+		bool any = false, all = true;
+
+		for (int y = state.rect.top(); y <= state.rect.bottom(); ++y) {
+			auto src = (const Pixel *)tile.constPixelPointer(0, y);
+			auto row = matches.qimage().scanLine(y);
+			for (int x = state.rect.left(); x <= state.rect.right(); ++x) {
+				if (mMatcher.matches(src[x])) {
+					setBit(row, x);
+					any = true;
+				} else {
+					all = false;
+				}
+			}
+		}
+
+		if (!any) {
+			state.type = TileState::Rejected;
+		} else if (all) {
+			state.type = TileState::Uniform;
+		} else {
+			state.type = TileState::Mixed;
+			state.matches = matches;
+			state.filled = SelectionImage(SelectionSurface::tileSize());
+			state.filled.fill(false);
+		}
+	}
+
+	void processTile(const QPoint &key, const QVector<Span> &spans)
+	{
+		auto iter = mStates.find(key);
+		if (iter == mStates.end()) {
+			iter = mStates.insert(key, TileState());
+			prepare(key, *iter);
+		}
+		auto &state = *iter;
+
+		switch (state.type) {
+		case TileState::Rejected:
+			return;
+		case TileState::Uniform:
+			if (!state.isFull)
+				fillUniform(key, state);
+			return;
+		case TileState::Mixed:
+			fillMixed(key, state, spans);
+			return;
+		}
+	}
+
+	void fillUniform(const QPoint &key, TileState &state)
+	{
+		state.isFull = true;
+		const auto &rect = state.rect;
+
+		if (rect.left() == 0) {
+			for (int y = rect.top(); y <= rect.bottom(); ++y)
+				addSeed(key + QPoint(-1, 0), Span { y, tileWidth - 1, tileWidth - 1 });
+		}
+		if (rect.right() == tileWidth - 1) {
+			for (int y = rect.top(); y <= rect.bottom(); ++y)
+				addSeed(key + QPoint(1, 0), Span { y, 0, 0 });
+		}
+		if (rect.top() == 0)
+			addSeed(key + QPoint(0, -1), Span { tileWidth - 1, rect.left(), rect.right() });
+		if (rect.bottom() == tileWidth - 1)
+			addSeed(key + QPoint(0, 1), Span { 0, rect.left(), rect.right() });
+	}
+
+	void fillMixed(const QPoint &key, TileState &state, const QVector<Span> &spans)
+	{
+		auto &matches = state.matches.qimage();
+		auto &filled = state.filled.qimage();
+
+		QVector<QPoint> stack;
+
+		// pushes the first pixel of each fillable run in the span
+		auto pushRuns = [&](int y, int left, int right) {
+			auto m = matches.constScanLine(y);
+			auto f = filled.constScanLine(y);
+			bool inRun = false;
+			for (int x = left; x <= right; ++x) {
+				bool fillable = testBit(m, x) && !testBit(f, x);
+				if (fillable && !inRun)
+					stack << QPoint(x, y);
+				inRun = fillable;
+			}
+		};
+
+		for (const Span &span : spans)
+			pushRuns(span.y, span.left, span.right);
+
+		while (!stack.isEmpty()) {
+			auto p = stack.takeLast();
+			int y = p.y();
+			auto m = matches.constScanLine(y);
+			auto f = filled.scanLine(y);
+
+			if (testBit(f, p.x()))
+				continue;
+
+			int left = p.x(), right = p.x();
+			while (left > 0 && testBit(m, left - 1) && !testBit(f, left - 1))
+				--left;
+			while (right < tileWidth - 1 && testBit(m, right + 1) && !testBit(f, right + 1))
+				++right;
+
+			for (int x = left; x <= right; ++x)
+				setBit(f, x);
+
+			if (left == 0)
+				addSeed(key + QPoint(-1, 0), Span { y, tileWidth - 1, tileWidth - 1 });
+			if (right == tileWidth - 1)
+				addSeed(key + QPoint(1, 0), Span { y, 0, 0 });
+
+			if (y > 0)
+				pushRuns(y - 1, left, right);
+			else
+				addSeed(key + QPoint(0, -1), Span { tileWidth - 1, left, right });
+
+			if (y < tileWidth - 1)
+				pushRuns(y + 1, left, right);
+			else
+				addSeed(key + QPoint(0, 1), Span { 0, left, right });
+		}
+	}
+
+	std::function<Image (const QPoint &)> mTileSource;
+	Pixel mDefaultPixel;
+	QRect mBounds;
+	ColorMatcher mMatcher;
+
+	QHash<QPoint, TileState> mStates;
+	QHash<QPoint, QVector<Span>> mPendingSpans;
+	QQueue<QPoint> mQueue;
+};
+
+} // anonymous namespace
+
+struct FloodFill::Data
+{
+	// returns an invalid image for tiles missing from the surface
+	std::function<Image (const QPoint &)> mTileSource;
+	Pixel mDefaultPixel;
+	QRect mBounds;
+	float mTolerance = 0;
+};
+
+FloodFill::FloodFill(const Surface &surface, const QRect &bounds) :
+	d(new Data)
+{
+	d->mTileSource = [surface](const QPoint &key) {
+		return surface.tile(key, Image());
+	};
+	d->mDefaultPixel = Surface::defaultPixel();
+	d->mBounds = bounds;
+}
+
+FloodFill::FloodFill(const CanvasViewportSurface &surface, const QRect &bounds) :
+	d(new Data)
+{
+	d->mTileSource = [surface](const QPoint &key) -> Image {
+		if (!surface.contains(key))
+			return Image();
+		return surface.tile(key).convert<Pixel>();
+	};
+	d->mDefaultPixel = Pixel(CanvasViewportSurface::defaultPixel());
+	d->mBounds = bounds;
+}
+
+FloodFill::~FloodFill()
+{
+}
+
+void FloodFill::setTolerance(float tolerance)
+{
+	d->mTolerance = tolerance;
+}
+
+float FloodFill::tolerance() const
+{
+	return d->mTolerance;
+}
+
+SelectionSurface FloodFill::fill(const QPoint &seed)
+{
+	if (!d->mBounds.contains(seed))
+		return SelectionSurface();
+
+	QPoint seedKey, seedPos;
+	IntDivision::dividePoint(seed, tileWidth, &seedKey, &seedPos);
+
+	auto seedTile = d->mTileSource(seedKey);
+	auto seedPixel = seedTile.isValid() ? *seedTile.constPixelPointer(seedPos) : d->mDefaultPixel;
+
+	Filler filler(d->mTileSource, d->mDefaultPixel, d->mBounds, ColorMatcher(seedPixel, d->mTolerance));
+	filler.addSeed(seedKey, Span { seedPos.y(), seedPos.x(), seedPos.x() });
+	filler.run();
+	return filler.result();
+}
+
+Surface fillSelection(const Surface &surface, const SelectionSurface &selection, const Pixel &pixel, const CoverageSurface &coverage)
+{
+	auto op = BlendMode(BlendMode::SourceOver).op();
+	auto result = surface;
+
+	for (auto iter = selection.begin(); iter != selection.end(); ++iter) {
+		CoverageImage mask;
+		if (!coverage.isEmpty()) {
+			mask = coverage.tile(iter.key(), CoverageImage());
+			if (!mask.isValid())
+				continue;
+		}
+
+		const auto &bits = iter.value().qimage();
+		auto bitmap = result.tileRef(iter.key()).bitmap();
+
+		for (int y = 0; y < tileWidth; ++y) {
+			auto row = bits.constScanLine(y);
+
+			// blend each run of selected pixels
+			for (int x = 0; x < tileWidth;) {
+				if (!testBit(row, x)) {
+					++x;
+					continue;
+				}
+				int start = x;
+				while (x < tileWidth && testBit(row, x))
+					++x;
+				if (mask.isValid())
+					op->blend(x - start, bitmap.pixelPointer(start, y), pixel, (const uint8_t *)mask.constPixelPointer(start, y), 1.f);
+				else
+					op->blend(x - start, bitmap.pixelPointer(start, y), pixel);
+			}
+		}
+	}
+
+	return result;
+}
+
+} // namespace PaintField
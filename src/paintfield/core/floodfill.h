@@ -0,0 +1,60 @@
+#pragma once
+
+#include <Malachite/Surface>
+#include <Malachite/Coverage>
+#include "canvasviewportsurface.h"
+#include "selectionsurface.h"
+
+namespace PaintField {
+
+/**
+ * The FloodFill finds the pixels connected to a seed pixel whose colors are similar to the seed color.
+ *
+ * It works directly on the tiles of the sampled surface.
+ * Tiles are taken from a work queue and each tile is read at most once,
+ * so the cost is bounded by the filled area.
+ * Tiles missing from the surface are accepted or rejected as a whole without reading any pixels.
+ */
+class FloodFill
+{
+public:
+
+	/**
+	 * Samples a layer surface.
+	 * @param bounds The rect the fill is limited to (usually the document rect)
+	 */
+	FloodFill(const Malachite::Surface &surface, const QRect &bounds);
+
+	/**
+	 * Samples the merged image of a viewport.
+	 * @param bounds The rect the fill is limited to (usually the document rect)
+	 */
+	FloodFill(const CanvasViewportSurface &surface, const QRect &bounds);
+
+	~FloodFill();
+
+	/**
+	 * @param tolerance The maximum difference of each premultiplied channel (0 - 1)
+	 */
+	void setTolerance(float tolerance);
+	float tolerance() const;
+
+	/**
+	 * @return The 4-connected pixels around "seed" whose colors are within the tolerance from the seed color
+	 */
+	SelectionSurface fill(const QPoint &seed);
+
+private:
+
+	struct Data;
+	QScopedPointer<Data> d;
+};
+
+/**
+ * Fills the selected pixels of a surface with "pixel" (source-over).
+ * @param coverage If not empty, the fill is scaled by it (0 - 255) and limited to its tiles (eg a soft selection)
+ * @return The filled surface (only the tiles of "selection" are changed)
+ */
+Malachite::Surface fillSelection(const Malachite::Surface &surface, const SelectionSurface &selection, const Malachite::Pixel &pixel, const Malachite::CoverageSurface &coverage = Malachite::CoverageSurface());
+
+} // namespace PaintField
@@ -90,34 +90,83 @@ void FormatSupport::setLongDescription(const QString &text)
 	d->longDescription = text;
 }
 
-bool FormatSupport::importFromFile(const QString &filepath, const QList<FormatSupport *> &formatSupports, QList<LayerRef> *layers, QSize *size, QString *name)
+FormatSupport *FormatSupport::formatForPath(const QString &filepath, const QList<FormatSupport *> &formatSupports)
 {
-	FormatSupport *importingFormat = nullptr;
+	auto suffix = QFileInfo(filepath).suffix();
+	FormatSupport *result = nullptr;
 	
+	for (auto format : formatSupports)
 	{
-		QFileInfo fileInfo(filepath);
-		
-		auto suffix = fileInfo.suffix();
-		
-		if (name)
-			*name = fileInfo.baseName();
-		
-		for (auto format : formatSupports)
-		{
-			if (format->suffixes().contains(suffix))
-				importingFormat = format;
-		}
-		
-		if (!importingFormat)
-		{
-			PAINTFIELD_WARNING << "unknown importing format";
-			return false;
-		}
+		if (format->suffixes().contains(suffix))
+			result = format;
+	}
+	
+	return result;
+}
+
+bool FormatSupport::readFromFile(const QString &filepath, const QList<FormatSupport *> &formatSupports, QList<LayerRef> *layers, QSize *size, QString *errorString)
+{
+	auto format = formatForPath(filepath, formatSupports);
+	
+	if (!format)
+	{
+		if (errorString)
+			*errorString = tr("Unknown file format.");
+		return false;
 	}
 	
 	QFile file(filepath);
 	
-	if (!file.open(QIODevice::ReadOnly) || !importingFormat->read(&file, layers, size))
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		if (errorString)
+			*errorString = file.errorString();
+		return false;
+	}
+	
+	if (!format->read(&file, layers, size))
+	{
+		if (errorString)
+			*errorString = tr("Failed to read file.");
+		return false;
+	}
+	
+	return true;
+}
+
+bool FormatSupport::writeToFile(const QString &filepath, FormatSupport *format, const QList<LayerConstRef> &layers, const QSize &size, const QVariant &option, QString *errorString)
+{
+	QFile file(filepath);
+	
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		if (errorString)
+			*errorString = file.errorString();
+		return false;
+	}
+	
+	if (!format->write(&file, layers, size, option))
+	{
+		if (errorString)
+			*errorString = tr("Failed to write file.");
+		return false;
+	}
+	
+	return true;
+}
+
+bool FormatSupport::importFromFile(const QString &filepath, const QList<FormatSupport *> &formatSupports, QList<LayerRef> *layers, QSize *size, QString *name)
+{
+	if (name)
+		*name = QFileInfo(filepath).baseName();
+	
+	if (!formatForPath(filepath, formatSupports))
+	{
+		PAINTFIELD_WARNING << "unknown importing format";
+		return false;
+	}
+	
+	if (!readFromFile(filepath, formatSupports, layers, size))
 	{
 		MessageBox::show(QMessageBox::Warning, tr("Failed to read file."), QString());
 		return false;
@@ -168,9 +217,7 @@ bool FormatSupport::exportToFile(const QString &filepath, FormatSupport *format,
 		}
 	}
 	
-	QFile file(filepath);
-	
-	if (!file.open(QIODevice::WriteOnly) || !format->write(&file, layers, size, option))
+	if (!writeToFile(filepath, format, layers, size, option))
 	{
 		MessageBox::show(QMessageBox::Warning, tr("Failed to write file."), QString());
 		return false;
@@ -21,6 +21,23 @@ public:
 	};
 	Q_DECLARE_FLAGS(Capabilities, Capability)
 	
+	/**
+	 * @return The format that handles the suffix of "filepath" (or null)
+	 */
+	static FormatSupport *formatForPath(const QString &filepath, const QList<FormatSupport *> &formatSupports);
+	
+	/**
+	 * Reads a file without showing any dialogs (safe to call from worker threads).
+	 * @param errorString Set to the reason on failure
+	 */
+	static bool readFromFile(const QString &filepath, const QList<FormatSupport *> &formatSupports, QList<LayerRef> *layers, QSize *size, QString *errorString = 0);
+	
+	/**
+	 * Writes a file without showing any dialogs (safe to call from worker threads).
+	 * @param errorString Set to the reason on failure
+	 */
+	static bool writeToFile(const QString &filepath, FormatSupport *formatSupport, const QList<LayerConstRef> &layers, const QSize &size, const QVariant &option = QVariant(), QString *errorString = 0);
+	
 	static bool importFromFile(const QString &filepath, const QList<FormatSupport *> &formatSupports, QList<LayerRef> *layers, QSize *size, QString *name = 0);
 	static bool importFromFileDialog(QWidget *parent, const QString &dialogTitle, const QString &anyNameFilterText, const QList<FormatSupport *> &formatSupports, QList<LayerRef> *layers, QSize *size, QString *name = 0, QString *path = 0);
 	static bool exportToFile(const QString &filepath, FormatSupport *formatSupport, const QList<LayerConstRef> &layers, const QSize &size, const QVariant &option = QVariant());
@@ -1,5 +1,7 @@
 #include "formatsupport.h"
 #include "paintfieldformatsupport.h"
+#include "appcontroller.h"
+#include "startupprofiler.h"
 
 #include "formatsupportmanager.h"
 
@@ -9,6 +11,7 @@ struct FormatSupportManager::Data
 {
 	QList<FormatSupport *> formatSupports;
 	FormatSupport *paintFieldFormatSupport = 0;
+	QList<std::function<QList<FormatSupport *>()>> providers;
 };
 
 FormatSupportManager::FormatSupportManager(QObject *parent) :
@@ -30,8 +33,32 @@ void FormatSupportManager::addFormatSupport(FormatSupport *support)
 	d->formatSupports << support;
 }
 
+void FormatSupportManager::addFormatSupportProvider(const std::function<QList<FormatSupport *>()> &provider)
+{
+	d->providers << provider;
+}
+
+void FormatSupportManager::createProvidedFormatSupports()
+{
+	if (d->providers.isEmpty())
+		return;
+	
+	StartupProfiler::Scope scope(appController() ? appController()->startupProfiler() : 0, "create format supports");
+	
+	auto providers = d->providers;
+	d->providers.clear();
+	
+	for (const auto &provider : providers)
+	{
+		for (auto support : provider())
+			addFormatSupport(support);
+	}
+}
+
 FormatSupport *FormatSupportManager::formatSupport(const QString &name)
 {
+	createProvidedFormatSupports();
+	
 	for (auto support : d->formatSupports)
 	{
 		if (support->name() == name)
@@ -42,6 +69,7 @@ FormatSupport *FormatSupportManager::formatSupport(const QString &name)
 
 QList<FormatSupport *> FormatSupportManager::formatSupports()
 {
+	createProvidedFormatSupports();
 	return d->formatSupports;
 }
 
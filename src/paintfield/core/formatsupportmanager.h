@@ -1,6 +1,7 @@
 #pragma once
 
 #include <QObject>
+#include <functional>
 
 namespace PaintField {
 
@@ -16,6 +17,12 @@ public:
 	
 	void addFormatSupport(FormatSupport *support);
 	
+	/**
+	 * Adds a function that creates format supports.
+	 * It is called the first time the format supports are requested, so that they are not created at startup.
+	 */
+	void addFormatSupportProvider(const std::function<QList<FormatSupport *>()> &provider);
+	
 	FormatSupport *formatSupport(const QString &name);
 	QList<FormatSupport *> formatSupports();
 	
@@ -27,6 +34,8 @@ public slots:
 	
 private:
 	
+	void createProvidedFormatSupports();
+	
 	struct Data;
 	Data *d;
 };
@@ -1,7 +1,9 @@
+#include <QtConcurrent>
 #include <Malachite/SurfacePainter>
 
 #include "layer.h"
 #include "rasterlayer.h"
+#include "memoryaccountant.h"
 
 #include "layeredit.h"
 
@@ -81,36 +83,115 @@ void LayerSurfaceEdit::undo(const LayerRef &layer)
 	_surface = surface;
 }
 
-void LayerMoveEdit::redo(const LayerRef &layer)
+LayerTileEdit::LayerTileEdit(const Surface &surface, const QPointSet &tileKeys) :
+	LayerEdit()
+{
+	for (const QPoint &key : tileKeys)
+		_tiles.insert(key, surface.tile(key, Image()));
+	
+	setModifiedKeys(tileKeys);
+}
+
+void LayerSurfaceEdit::countMemory(MemoryCounter &counter) const
+{
+	counter.addSurface(_surface);
+}
+
+void LayerTileEdit::redo(const LayerRef &layer)
+{
+	swapTiles(layer);
+}
+
+void LayerTileEdit::undo(const LayerRef &layer)
+{
+	swapTiles(layer);
+}
+
+void LayerTileEdit::swapTiles(const LayerRef &layer)
 {
 	auto rasterLayer = dynamicSPCast<RasterLayer>(layer);
 	Q_ASSERT(rasterLayer);
-	Surface surface;
 	
+	Surface surface = rasterLayer->surface();
+	
+	for (auto iter = _tiles.begin(); iter != _tiles.end(); ++iter)
 	{
-		Painter painter(&surface);
-		painter.drawPreTransformedSurface(_offset, rasterLayer->surface());
+		Image old = surface.tile(iter.key(), Image());
+		
+		if (iter.value().isValid())
+			surface.setTile(iter.key(), iter.value());
+		else
+			surface.remove(iter.key());
+		
+		iter.value() = old;
 	}
 	
-	surface.squeeze();
-	
 	rasterLayer->setSurface(surface);
 }
 
-void LayerMoveEdit::undo(const LayerRef &layer)
+void LayerTileEdit::countMemory(MemoryCounter &counter) const
+{
+	for (const auto &tile : _tiles)
+		counter.addImage(tile);
+}
+
+/**
+ * Copies the tiles of "view" into a surface, assembling the tiles in parallel if they are shifted within tiles.
+ */
+static Surface surfaceFromOffsetView(const SurfaceOffsetView &view)
+{
+	if (view.isTileAligned())
+		return view.toSurface();
+	
+	struct TileJob
+	{
+		QPoint key;
+		Image tile;
+	};
+	
+	QVector<TileJob> jobs;
+	for (const QPoint &key : view.keys())
+		jobs << TileJob { key, Image() };
+	
+	QtConcurrent::blockingMap(jobs, [&](TileJob &job) {
+		job.tile = view.tile(job.key);
+	});
+	
+	Surface surface;
+	for (const auto &job : jobs)
+	{
+		if (!job.tile.isBlank())
+			surface.setTile(job.key, job.tile);
+	}
+	return surface;
+}
+
+void LayerMoveEdit::redo(const LayerRef &layer)
 {
 	auto rasterLayer = dynamicSPCast<RasterLayer>(layer);
 	Q_ASSERT(rasterLayer);
-	Surface surface;
 	
+	if (!_moved)
 	{
-		Painter painter(&surface);
-		painter.drawPreTransformedSurface(-_offset, rasterLayer->surface());
+		_originalSurface = rasterLayer->surface();
+		_movedSurface = surfaceFromOffsetView(SurfaceOffsetView(_originalSurface, _offset));
+		_moved = true;
 	}
 	
-	surface.squeeze();
-	
-	rasterLayer->setSurface(surface);
+	rasterLayer->setSurface(_movedSurface);
+}
+
+void LayerMoveEdit::undo(const LayerRef &layer)
+{
+	auto rasterLayer = dynamicSPCast<RasterLayer>(layer);
+	Q_ASSERT(rasterLayer);
+	rasterLayer->setSurface(_originalSurface);
+}
+
+void LayerMoveEdit::countMemory(MemoryCounter &counter) const
+{
+	counter.addSurface(_originalSurface);
+	counter.addSurface(_movedSurface);
 }
 
 }
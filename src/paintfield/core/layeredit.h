@@ -5,6 +5,8 @@
 
 namespace PaintField {
 
+class MemoryCounter;
+
 class LayerEdit
 {
 public:
@@ -26,6 +28,11 @@ public:
 	*/
 	QPointSet modifiedKeys() const { return _modifiedKeys; }
 	
+	/**
+	  Adds the memory kept by this edit for undo/redo.
+	*/
+	virtual void countMemory(MemoryCounter &counter) const { Q_UNUSED(counter) }
+	
 private:
 	QString _name;
 	QPointSet _modifiedKeys;
@@ -52,11 +59,39 @@ public:
 	LayerSurfaceEdit(const Malachite::Surface &surface, const QPointSet &tileKeys);
 	void redo(const LayerRef &layer);
 	void undo(const LayerRef &layer);
+	void countMemory(MemoryCounter &counter) const;
 	
 private:
 	Malachite::Surface _surface;
 };
 
+/**
+ * Replaces only the given tiles of a raster layer.
+ * Keeps just the changed tiles (and their previous contents for undo), not whole surfaces.
+ */
+class LayerTileEdit : public LayerEdit
+{
+public:
+	/**
+	 * @param surface The source of the new tiles
+	 * @param tileKeys The keys of the tiles to replace (tiles missing in "surface" are removed)
+	 */
+	LayerTileEdit(const Malachite::Surface &surface, const QPointSet &tileKeys);
+	void redo(const LayerRef &layer);
+	void undo(const LayerRef &layer);
+	void countMemory(MemoryCounter &counter) const;
+	
+private:
+	void swapTiles(const LayerRef &layer);
+	
+	QHash<QPoint, Malachite::Image> _tiles;
+};
+
+/**
+ * The LayerMoveEdit moves a raster layer by an integer offset.
+ * The tiles are rearranged once on the first redo (when the move is committed, as the drag is previewed through a SurfaceOffsetView),
+ * in parallel unless the offset is tile-aligned; after that, undo and redo only swap the kept surfaces.
+ */
 class LayerMoveEdit : public LayerEdit
 {
 public:
@@ -67,9 +102,12 @@ public:
 	
 	void redo(const LayerRef &layer);
 	void undo(const LayerRef &layer);
+	void countMemory(MemoryCounter &counter) const;
 	
 private:
 	QPoint _offset;
+	Malachite::Surface _originalSurface, _movedSurface;
+	bool _moved = false;
 };
 
 }
@@ -1,5 +1,6 @@
 #include "layerrenderer.h"
 
+#include <QtConcurrent>
 #include <amulet/range_extension.hh>
 #include <Malachite/Container>
 
@@ -25,6 +26,60 @@ Surface LayerRenderer::renderToSurface(const QList<LayerConstRef> &layers, const
 	return surface;
 }
 
+Surface LayerRenderer::renderToSurfaceParallel(const QList<LayerConstRef> &layers, const QPointSet &keys, const std::function<void (int, int)> &onProgress)
+{
+	struct TileJob
+	{
+		QPoint key;
+		Image tile;
+	};
+	
+	QVector<TileJob> jobs;
+	
+	if (keys.isEmpty())
+	{
+		QPointSet layerKeys;
+		for (const auto &layer : layers)
+			layerKeys |= layer->tileKeysRecursive();
+		for (const QPoint &key : layerKeys)
+			jobs << TileJob { key, Image() };
+	}
+	else
+	{
+		for (const QPoint &key : keys)
+			jobs << TileJob { key, Image() };
+	}
+	
+	auto renderJob = [&](TileJob &job) {
+		auto surface = renderToSurface(layers, { job.key });
+		job.tile = surface.tile(job.key, Image());
+	};
+	
+	// render in batches so that the progress can be reported between them
+	int total = jobs.size();
+	int batchSize = onProgress ? std::max(QThread::idealThreadCount() * 4, total / 100) : total;
+	
+	for (int done = 0; done < total;)
+	{
+		int count = std::min(batchSize, total - done);
+		QtConcurrent::blockingMap(jobs.begin() + done, jobs.begin() + done + count, renderJob);
+		done += count;
+		
+		if (onProgress)
+			onProgress(done, total);
+	}
+	
+	Surface result;
+	
+	for (const auto &job : jobs)
+	{
+		if (job.tile.isValid() && !job.tile.isBlank())
+			result.setTile(job.key, job.tile);
+	}
+	
+	return result;
+}
+
 void LayerRenderer::renderLayer(SurfacePainter *painter, const LayerConstRef &layer)
 {
 	if (!layer->isVisible() || !layer->opacity())
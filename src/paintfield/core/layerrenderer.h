@@ -2,6 +2,7 @@
 
 #include "layer.h"
 #include <Malachite/SurfacePainter>
+#include <functional>
 
 namespace PaintField {
 
@@ -61,6 +62,15 @@ public:
 		return renderToSurface(layers, keyClip, QHash<QPoint, QRect>());
 	}
 	
+	/**
+	 * Renders layers to a surface, rendering each tile in parallel.
+	 * The renderer must be safe to use from several threads at once (LayerRenderer itself is).
+	 * @param keys Tiles to render (the tiles of "layers" if empty)
+	 * @param onProgress Called on the calling thread with the number of rendered tiles and the total count
+	 * @return
+	 */
+	Malachite::Surface renderToSurfaceParallel(const QList<LayerConstRef> &layers, const QPointSet &keys = QPointSet(), const std::function<void (int, int)> &onProgress = std::function<void (int, int)>());
+	
 protected:
 	
 	/**
@@ -1,8 +1,11 @@
 #include <functional>
 #include <tuple>
 #include <QUndoCommand>
+#include <QUndoStack>
 #include <QTimer>
 #include <QItemSelectionModel>
+#include <QFutureWatcher>
+#include <QtConcurrent>
 
 #include "document.h"
 #include "rasterlayer.h"
@@ -10,6 +13,7 @@
 #include "layeredit.h"
 #include "layerrenderer.h"
 #include "layeritemmodel.h"
+#include "memoryaccountant.h"
 
 #include "layerscene.h"
 
@@ -42,6 +46,11 @@ public:
 		_scene(scene)
 	{}
 	
+	/**
+	 * Adds the memory kept by this command for undo/redo.
+	 */
+	virtual void countMemory(MemoryCounter &counter) const { Q_UNUSED(counter) }
+	
 	void insertLayer(const LayerRef &parent, int index, const LayerRef &layer)
 	{
 		PAINTFIELD_DEBUG << parent << index << layer;
@@ -130,6 +139,11 @@ public:
 		redoUndo(false);
 	}
 	
+	void countMemory(MemoryCounter &counter) const override
+	{
+		_edit->countMemory(counter);
+	}
+	
 private:
 	
 	void redoUndo(bool redo)
@@ -253,6 +267,11 @@ public:
 		_layer = takeLayer(parent, _index);
 	}
 	
+	void countMemory(MemoryCounter &counter) const override
+	{
+		counter.addLayer(_layer);
+	}
+	
 private:
 	
 	LayerRef _layer;
@@ -288,6 +307,12 @@ public:
 		insertLayer(layerForPath(_parentPath), _index, _layer);
 	}
 	
+	void countMemory(MemoryCounter &counter) const override
+	{
+		if (_layer)
+			counter.addLayer(_layer);
+	}
+	
 private:
 	
 	LayerConstRef _ref;
@@ -508,38 +533,63 @@ public:
 		_parentPath = pathForLayer(parentRef);
 	}
 	
+	/**
+	 * Sets the merged surface rendered in advance, so that redo does not render it.
+	 */
+	void setMergedSurface(const Surface &surface)
+	{
+		auto newLayer = makeSP<RasterLayer>(_newName);
+		newLayer->setSurface(surface);
+		newLayer->updateThumbnail(scene()->document()->size());
+		_merged = newLayer;
+	}
+	
 	void redo()
 	{
 		auto parent = layerForPath(_parentPath);
 		
+		// the merged layer is rendered only once and reused after undo
+		if (!_merged)
+		{
+			QList<LayerConstRef> layers;
+			for (int i = 0; i < _count; ++i)
+				layers << parent->child(_index + i);
+			
+			setMergedSurface(LayerRenderer().renderToSurfaceParallel(layers));
+		}
+		
+		// the original layers are kept as they are; their tiles are shared, not copied
 		for (int i = 0; i < _count; ++i)
 			_layers << takeLayer(parent, _index);
 		
-		LayerRenderer renderer;
-		
-		auto newLayer = makeSP<RasterLayer>(_newName);
-		newLayer->setSurface(renderer.renderToSurface(Malachite::constList(_layers)));
-		newLayer->updateThumbnail(scene()->document()->size());
-		
-		insertLayer(parent, _index, newLayer);
+		insertLayer(parent, _index, _merged);
 	}
 	
 	void undo()
 	{
 		auto parent = layerForPath(_parentPath);
 		
-		takeLayer(parent, _index);
+		_merged = takeLayer(parent, _index);
 		
 		for (int i = 0; i < _count; ++i)
 			insertLayer(parent, _index + i, _layers.takeFirst());
 	}
 	
+	void countMemory(MemoryCounter &counter) const override
+	{
+		if (_merged)
+			counter.addLayer(_merged);
+		for (const auto &layer : _layers)
+			counter.addLayer(layer);
+	}
+	
 private:
 	
 	Path _parentPath;
 	int _index, _count;
 	QString _newName;
 	
+	LayerRef _merged;
 	QList<LayerRef> _layers;
 };
 
@@ -557,6 +607,12 @@ struct LayerScene::Data
 	
 	LayerConstRef current;
 	
+	// the merge rendered in the background and its command, pushed when rendering finishes
+	QFutureWatcher<Surface> *mergeWatcher = 0;
+	QUndoCommand *mergeCommand = 0;
+	// set when the undo stack moves while merging, which makes the rendered result out of date
+	bool mergeOutdated = false;
+	
 	/**
 	 * Checks if this scene contains the layer.
 	 * @param layer
@@ -595,13 +651,9 @@ LayerScene::LayerScene(const QList<LayerRef> &layers, Document *document) :
 	
 	d->document = document;
 	connect(d->document, SIGNAL(modified()), this, SLOT(update()));
-	
-	{
-		auto root = makeSP<GroupLayer>();
-		root->insert(0, layers);
-		root->updateThumbnailRecursive(document->size());
-		d->rootLayer = root;
-	}
+	connect(d->document->undoStack(), &QUndoStack::indexChanged, this, [this] {
+		d->mergeOutdated = true;
+	});
 	
 	{
 		auto t = new QTimer(this);
@@ -611,6 +663,22 @@ LayerScene::LayerScene(const QList<LayerRef> &layers, Document *document) :
 		d->thumbnailUpdateTimer = t;
 	}
 	
+	{
+		auto root = makeSP<GroupLayer>();
+		root->insert(0, layers);
+		d->rootLayer = root;
+		
+		// thumbnails are made after the first paint
+		std::function<void (const LayerRef &)> setThumbnailDirty = [&](const LayerRef &layer) {
+			layer->setThumbnailDirty(true);
+			for (const auto &child : layer->children())
+				setThumbnailDirty(child);
+		};
+		setThumbnailDirty(root);
+		d->thumbnailDirtyKeys = root->tileKeysRecursive();
+		d->thumbnailUpdateTimer->start();
+	}
+	
 	{
 		auto im = new LayerItemModel( this, this );
 		auto sm = new QItemSelectionModel(im, this );
@@ -627,6 +695,11 @@ LayerScene::LayerScene(const QList<LayerRef> &layers, Document *document) :
 
 LayerScene::~LayerScene()
 {
+	// the render reads the layers and reports progress through this scene
+	if (d->mergeWatcher)
+		d->mergeWatcher->waitForFinished();
+	delete d->mergeCommand;
+	
 	delete d;
 }
 
@@ -723,6 +796,12 @@ void LayerScene::moveLayers(const QList<LayerConstRef> &layers, const LayerConst
 
 void LayerScene::copyLayers(const QList<LayerConstRef> &layers, const LayerConstRef &parent, int index)
 {
+	if (d->document->isLoading())
+	{
+		PAINTFIELD_WARNING << "layers are still loading";
+		return;
+	}
+	
 	if (!d->checkLayers(layers) || !d->checkParentLayer(parent))
 	{
 		PAINTFIELD_WARNING << "invalid parent";
@@ -744,28 +823,136 @@ void LayerScene::copyLayers(const QList<LayerConstRef> &layers, const LayerConst
 	pushCommand(command);
 }
 
+static QString mergedLayerName(const LayerConstRef &parent, int index, int count)
+{
+	QString mergedName;
+	
+	for (int i = index; i < index + count; ++i)
+	{
+		mergedName += parent->child(i)->name();
+		if (i != index + count - 1)
+			mergedName += " + ";
+	}
+	
+	return mergedName;
+}
+
 void LayerScene::mergeLayers(const LayerConstRef &parent, int index, int count)
 {
+	if (d->document->isLoading())
+	{
+		PAINTFIELD_WARNING << "layers are still loading";
+		return;
+	}
+	
 	if (!d->checkParentLayer(parent))
 	{
 		PAINTFIELD_WARNING << "invalid parent";
 		return;
 	}
 	
-	QString mergedName;
+	auto command = new LayerSceneMergeCommand(parent, index, count, mergedLayerName(parent, index, count), this, 0);
+	command->setText(tr("Merge Layers"));
+	pushCommand(command);
+}
+
+void LayerScene::startMergeLayers(const LayerConstRef &parent, int index, int count)
+{
+	if (!d->checkParentLayer(parent))
+	{
+		PAINTFIELD_WARNING << "invalid parent";
+		return;
+	}
 	
-	for (int i = index; i < index + count; ++i)
+	startMerge(parent, index, count, mergedLayerName(parent, index, count), tr("Merge Layers"));
+}
+
+void LayerScene::flatten()
+{
+	if (d->document->isLoading())
 	{
-		mergedName += parent->child(i)->name();
-		if (i != index + count - 1)
-			mergedName += " + ";
+		PAINTFIELD_WARNING << "layers are still loading";
+		return;
 	}
 	
-	auto command = new LayerSceneMergeCommand(parent, index, count, mergedName, this, 0);
-	command->setText(tr("Merge Layers"));
+	int count = d->rootLayer->count();
+	if (count == 0)
+		return;
+	
+	auto command = new LayerSceneMergeCommand(d->rootLayer, 0, count, tr("Background"), this, 0);
+	command->setText(tr("Flatten Image"));
 	pushCommand(command);
 }
 
+void LayerScene::startFlatten()
+{
+	startMerge(d->rootLayer, 0, d->rootLayer->count(), tr("Background"), tr("Flatten Image"));
+}
+
+bool LayerScene::isMerging() const
+{
+	return d->mergeWatcher;
+}
+
+void LayerScene::startMerge(const LayerConstRef &parent, int index, int count, const QString &newName, const QString &description)
+{
+	if (d->document->isLoading())
+	{
+		PAINTFIELD_WARNING << "layers are still loading";
+		return;
+	}
+	
+	if (d->mergeWatcher)
+	{
+		PAINTFIELD_WARNING << "already merging";
+		return;
+	}
+	
+	if (count == 0)
+		return;
+	
+	QList<LayerConstRef> layers;
+	for (int i = 0; i < count; ++i)
+		layers << parent->child(index + i);
+	
+	auto command = new LayerSceneMergeCommand(parent, index, count, newName, this, 0);
+	command->setText(description);
+	d->mergeCommand = command;
+	d->mergeOutdated = false;
+	
+	auto watcher = new QFutureWatcher<Surface>(this);
+	d->mergeWatcher = watcher;
+	
+	connect(watcher, &QFutureWatcher<Surface>::finished, this, [this, watcher, command] {
+		auto surface = watcher->result();
+		watcher->deleteLater();
+		d->mergeWatcher = 0;
+		d->mergeCommand = 0;
+		
+		if (d->mergeOutdated)
+		{
+			PAINTFIELD_WARNING << "layers changed while merging";
+			delete command;
+			emit mergeFinished(false);
+			return;
+		}
+		
+		command->setMergedSurface(surface);
+		pushCommand(command);
+		emit mergeFinished(true);
+	});
+	
+	// progress is emitted from the worker thread and delivered queued to the receivers
+	auto render = [this, layers] {
+		auto onProgress = [this](int rendered, int total) {
+			emit mergeProgressChanged(rendered, total);
+		};
+		return LayerRenderer().renderToSurfaceParallel(layers, QPointSet(), onProgress);
+	};
+	
+	watcher->setFuture(QtConcurrent::run(render));
+}
+
 void LayerScene::editLayer(const LayerConstRef &layer, LayerEdit *edit, const QString &description)
 {
 	PAINTFIELD_DEBUG << d->rootLayer->children();
@@ -786,6 +973,27 @@ void LayerScene::editLayer(const LayerConstRef &layer, LayerEdit *edit, const QS
 	pushCommand(command);
 }
 
+void LayerScene::setLoadedSurface(const LayerConstRef &layer, const Malachite::Surface &surface)
+{
+	auto rasterLayer = dynamicSPCast<RasterLayer>(constSPCast<Layer>(layer));
+	if (!rasterLayer)
+	{
+		PAINTFIELD_WARNING << "not a raster layer";
+		return;
+	}
+	
+	auto keys = rasterLayer->tileKeys() | surface.keys();
+	rasterLayer->setSurface(surface);
+	
+	// the layer may have been removed while loading (it keeps the data for undo)
+	if (!d->checkLayer(layer))
+		return;
+	
+	enqueueTileUpdate(keys);
+	emit layerChanged(layer);
+	update();
+}
+
 void LayerScene::setLayerProperty(const LayerConstRef &layer, const QVariant &data, int role, const QString &description, bool mergeOn)
 {
 	if (!d->checkLayer(layer))
@@ -927,8 +1135,31 @@ LayerRef LayerScene::mutableRootLayer()
 	return d->rootLayer;
 }
 
+void LayerScene::countUndoMemory(MemoryCounter &counter) const
+{
+	std::function<void (const QUndoCommand *)> countCommand = [&](const QUndoCommand *command) {
+		auto layerSceneCommand = dynamic_cast<const LayerSceneCommand *>(command);
+		if (layerSceneCommand)
+			layerSceneCommand->countMemory(counter);
+		for (int i = 0; i < command->childCount(); ++i)
+			countCommand(command->child(i));
+	};
+	
+	auto undoStack = d->document->undoStack();
+	for (int i = 0; i < undoStack->count(); ++i)
+		countCommand(undoStack->command(i));
+}
+
 void LayerScene::pushCommand(QUndoCommand *command)
 {
+	// the merge renders from the layers on a worker thread, so they must not change meanwhile
+	if (d->mergeWatcher)
+	{
+		PAINTFIELD_WARNING << "layers cannot be edited while merging";
+		delete command;
+		return;
+	}
+	
 	PAINTFIELD_DEBUG << "pushing command" << command->text();
 	d->document->undoStack()->push(command);
 }
@@ -12,6 +12,7 @@ namespace PaintField {
 class LayerEdit;
 class Document;
 class LayerItemModel;
+class MemoryCounter;
 
 class LayerScene : public QObject
 {
@@ -23,10 +24,40 @@ public:
 	void addLayers(const QList<LayerRef> &layers, const LayerConstRef &parent, int index, const QString &description);
 	void removeLayers(const QList<LayerConstRef> &layers, const QString &description = QString());
 	void moveLayers(const QList<LayerConstRef> &layers, const LayerConstRef &parent, int index);
+	/**
+	 * Copies layers, and merges or flattens them into new layers.
+	 * These do nothing while the document is loading, as the new layers would not receive the loaded data.
+	 */
 	void copyLayers(const QList<LayerConstRef> &layers, const LayerConstRef &parent, int index);
 	void mergeLayers(const LayerConstRef &parent, int index, int count);
 	
+	/**
+	 * Merges all layers into one raster layer.
+	 */
+	void flatten();
+	
+	/**
+	 * Starts merging layers in the background.
+	 * The layers are rendered on a worker thread while mergeProgressChanged is emitted,
+	 * and the merge command is pushed when rendering finishes, followed by mergeFinished.
+	 * No command can be pushed while merging, and the merge is dropped if the undo stack moves meanwhile.
+	 */
+	void startMergeLayers(const LayerConstRef &parent, int index, int count);
+	
+	/**
+	 * Starts flattening the image in the background, in the same way as startMergeLayers.
+	 */
+	void startFlatten();
+	
+	bool isMerging() const;
+	
 	void editLayer(const LayerConstRef &layer, LayerEdit *edit, const QString &description);
+	
+	/**
+	 * Sets the surface of a raster layer whose data was loaded in the background.
+	 * No undo command is pushed and the document is not marked modified.
+	 */
+	void setLoadedSurface(const LayerConstRef &layer, const Malachite::Surface &surface);
 	void setLayerProperty(const LayerConstRef &layer, const QVariant &data, int role, const QString &description = QString(), bool mergeOn = true);
 	
 	QList<LayerConstRef> topLevelLayers() const { return rootLayer()->children(); }
@@ -44,6 +75,11 @@ public:
 	
 	static QList<int> pathForLayer(const LayerConstRef &layer);
 	
+	/**
+	 * Adds the memory kept by the layer commands in the undo stack.
+	 */
+	void countUndoMemory(MemoryCounter &counter) const;
+	
 public slots:
 	
 	void abortThumbnailUpdate();
@@ -63,6 +99,19 @@ signals:
 	void layerChanged(const LayerConstRef &layer);
 	
 	void tilesUpdated(const QPointSet &tileKeys);
+	
+	/**
+	 * Emitted while merging layers.
+	 * @param rendered The number of rendered tiles
+	 * @param total The number of tiles to render
+	 */
+	void mergeProgressChanged(int rendered, int total);
+	
+	/**
+	 * Emitted when a merge started by startMergeLayers or startFlatten ends.
+	 * @param merged Whether the merge command was pushed
+	 */
+	void mergeFinished(bool merged);
 	void thumbnailsUpdated(const QPointSet &updatedKeys);
 	
 	void currentChanged(const LayerConstRef &now, const LayerConstRef &old);
@@ -76,6 +125,7 @@ protected:
 	LayerRef mutableRootLayer();
 	
 	void pushCommand(QUndoCommand *command);
+	void startMerge(const LayerConstRef &parent, int index, int count, const QString &newName, const QString &description);
 	
 private slots:
 	
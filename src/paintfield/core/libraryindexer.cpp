@@ -0,0 +1,308 @@
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFileSystemWatcher>
+#include <QFutureWatcher>
+#include <QImageReader>
+#include <QStandardPaths>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+#include "paintfieldformatsupport.h"
+
+#include "libraryindexer.h"
+
+namespace PaintField {
+
+namespace {
+
+/**
+ * Lists a directory (called from worker threads).
+ */
+QList<LibraryEntry> listDir(const QString &dirPath)
+{
+	QList<LibraryEntry> entries;
+
+	for (const QFileInfo &fileInfo : QDir(dirPath).entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot))
+	{
+		if (!fileInfo.isDir() && !fileInfo.isFile())
+			continue;
+
+		LibraryEntry entry;
+		entry.name = fileInfo.fileName();
+		entry.isDir = fileInfo.isDir();
+		entry.size = fileInfo.size();
+		entry.lastModified = fileInfo.lastModified();
+		entries << entry;
+	}
+
+	return entries;
+}
+
+QImage makeThumbnail(const QString &filePath)
+{
+	QImage image;
+
+	if (QFileInfo(filePath).suffix() == "pfield")
+	{
+		QFile file(filePath);
+		if (file.open(QIODevice::ReadOnly))
+			image = PaintFieldFormatSupport::readPreview(&file, LibraryIndexer::ThumbnailSize);
+	}
+	else
+	{
+		QImageReader reader(filePath);
+		auto size = reader.size();
+
+		// decoders like JPEG can decode at a reduced size directly
+		if (size.width() > LibraryIndexer::ThumbnailSize || size.height() > LibraryIndexer::ThumbnailSize)
+			reader.setScaledSize(size.scaled(LibraryIndexer::ThumbnailSize, LibraryIndexer::ThumbnailSize, Qt::KeepAspectRatio));
+
+		image = reader.read();
+	}
+
+	if (image.width() > LibraryIndexer::ThumbnailSize || image.height() > LibraryIndexer::ThumbnailSize)
+		image = image.scaled(LibraryIndexer::ThumbnailSize, LibraryIndexer::ThumbnailSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+
+	return image;
+}
+
+/**
+ * Reads the thumbnail of a file from the cache, or makes and caches it (called from worker threads).
+ * Each file has one cache file, named after its path, that records the version of the file it was made from,
+ * so a new version replaces the thumbnail of the old one.
+ */
+QImage loadThumbnail(const QString &cacheDirPath, const QString &filePath, const QDateTime &lastModified, qint64 size)
+{
+	auto hash = QCryptographicHash::hash(filePath.toUtf8(), QCryptographicHash::Sha1).toHex();
+	auto version = QString::number(lastModified.toMSecsSinceEpoch()) + ' ' + QString::number(size);
+
+	QDir cacheDir(cacheDirPath);
+	auto cachePath = cacheDir.filePath(QString::fromLatin1(hash) + ".png");
+
+	QImage image;
+	{
+		QImageReader reader(cachePath, "PNG");
+		if (reader.text("version") == version && reader.read(&image))
+			return image;
+	}
+
+	image = makeThumbnail(filePath);
+
+	if (!image.isNull() && cacheDir.mkpath("."))
+	{
+		image.setText("version", version);
+		if (!image.save(cachePath, "PNG"))
+			PAINTFIELD_WARNING << "cannot cache thumbnail of" << filePath;
+	}
+
+	return image;
+}
+
+/**
+ * Removes cached thumbnails that are too old, then the oldest ones until the cache fits in "maxBytes" (called from worker threads).
+ */
+void pruneThumbnailCache(const QString &cacheDirPath, qint64 maxBytes, int maxDays)
+{
+	auto fileInfos = QDir(cacheDirPath).entryInfoList({"*.png"}, QDir::Files, QDir::Time);
+	auto expiry = QDateTime::currentDateTime().addDays(-maxDays);
+
+	qint64 total = 0;
+
+	// from the newest
+	for (const auto &fileInfo : fileInfos)
+	{
+		total += fileInfo.size();
+		if (total > maxBytes || fileInfo.lastModified() < expiry)
+			QFile::remove(fileInfo.filePath());
+	}
+}
+
+// the limits of the thumbnail cache, applied when the first thumbnail is requested
+constexpr qint64 maxThumbnailCacheBytes = 256 * 1024 * 1024;
+constexpr int maxThumbnailCacheDays = 90;
+
+// requests beyond this are dropped, oldest first (their items have most likely been scrolled away)
+constexpr int maxQueuedThumbnails = 256;
+
+struct ThumbnailRequest
+{
+	QString filePath;
+	QDateTime lastModified;
+	qint64 size;
+};
+
+} // anonymous namespace
+
+struct LibraryIndexer::Data
+{
+	QString thumbnailCacheDir;
+
+	// directories are listed in order on one thread, thumbnails are made on the others
+	QThreadPool scanPool;
+	QThreadPool thumbnailPool;
+
+	QSet<QString> scanningPaths;
+
+	// directories that changed while being scanned, scanned again when the scan finishes
+	QSet<QString> rescanPaths;
+
+	// the requests waiting for a thread, started from the newest
+	QList<ThumbnailRequest> thumbnailQueue;
+	QSet<QString> thumbnailPaths;
+	QSet<QString> runningThumbnailPaths;
+
+	// requests for files whose thumbnails were being made, made again when they finish
+	QHash<QString, ThumbnailRequest> thumbnailRetries;
+
+	bool thumbnailCachePruned = false;
+
+	QFileSystemWatcher *watcher = 0;
+};
+
+LibraryIndexer::LibraryIndexer(QObject *parent) :
+	QObject(parent),
+	d(new Data)
+{
+	d->thumbnailCacheDir = QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).filePath("LibraryThumbnails");
+
+	d->scanPool.setMaxThreadCount(1);
+	d->thumbnailPool.setMaxThreadCount(std::max(1, QThread::idealThreadCount() / 2));
+
+	d->watcher = new QFileSystemWatcher(this);
+	connect(d->watcher, &QFileSystemWatcher::directoryChanged, this, &LibraryIndexer::directoryChanged);
+}
+
+LibraryIndexer::~LibraryIndexer()
+{
+	// do not wait for the queued jobs
+	d->scanPool.clear();
+	d->thumbnailPool.clear();
+}
+
+void LibraryIndexer::setThumbnailCacheDir(const QString &path)
+{
+	d->thumbnailCacheDir = path;
+	d->thumbnailCachePruned = false;
+}
+
+QString LibraryIndexer::thumbnailCacheDir() const
+{
+	return d->thumbnailCacheDir;
+}
+
+bool LibraryIndexer::canMakeThumbnail(const QString &filePath)
+{
+	static const auto suffixes = [] {
+		QSet<QString> suffixes = { "pfield" };
+		for (const auto &format : QImageReader::supportedImageFormats())
+			suffixes << QString::fromLatin1(format).toLower();
+		return suffixes;
+	}();
+
+	return suffixes.contains(QFileInfo(filePath).suffix().toLower());
+}
+
+void LibraryIndexer::scan(const QString &dirPath)
+{
+	// the directory may have been read before the change
+	if (d->scanningPaths.contains(dirPath))
+	{
+		d->rescanPaths << dirPath;
+		return;
+	}
+	d->scanningPaths << dirPath;
+
+	auto watcher = new QFutureWatcher<QList<LibraryEntry>>(this);
+	connect(watcher, &QFutureWatcher<QList<LibraryEntry>>::finished, this, [this, watcher, dirPath] {
+		auto entries = watcher->result();
+		watcher->deleteLater();
+		d->scanningPaths.remove(dirPath);
+		emit scanned(dirPath, entries);
+
+		if (d->rescanPaths.remove(dirPath))
+			scan(dirPath);
+	});
+	watcher->setFuture(QtConcurrent::run(&d->scanPool, listDir, dirPath));
+}
+
+void LibraryIndexer::requestThumbnail(const QString &filePath, const QDateTime &lastModified, qint64 size)
+{
+	ThumbnailRequest request { filePath, lastModified, size };
+
+	// the file may have changed since its thumbnail was started
+	if (d->runningThumbnailPaths.contains(filePath))
+	{
+		d->thumbnailRetries[filePath] = request;
+		return;
+	}
+
+	if (d->thumbnailPaths.contains(filePath))
+	{
+		for (auto &queued : d->thumbnailQueue)
+		{
+			if (queued.filePath == filePath)
+				queued = request;
+		}
+		return;
+	}
+	d->thumbnailPaths << filePath;
+
+	if (!d->thumbnailCachePruned)
+	{
+		d->thumbnailCachePruned = true;
+		QtConcurrent::run(&d->thumbnailPool, pruneThumbnailCache, d->thumbnailCacheDir, maxThumbnailCacheBytes, maxThumbnailCacheDays);
+	}
+
+	d->thumbnailQueue << request;
+
+	while (d->thumbnailQueue.size() > maxQueuedThumbnails)
+	{
+		auto dropped = d->thumbnailQueue.takeFirst().filePath;
+		d->thumbnailPaths.remove(dropped);
+		emit thumbnailDropped(dropped);
+	}
+
+	startThumbnails();
+}
+
+void LibraryIndexer::startThumbnails()
+{
+	while (d->runningThumbnailPaths.size() < d->thumbnailPool.maxThreadCount() && !d->thumbnailQueue.isEmpty())
+	{
+		auto request = d->thumbnailQueue.takeLast();
+		d->runningThumbnailPaths << request.filePath;
+
+		auto watcher = new QFutureWatcher<QImage>(this);
+		connect(watcher, &QFutureWatcher<QImage>::finished, this, [this, watcher, request] {
+			auto thumbnail = watcher->result();
+			watcher->deleteLater();
+			d->runningThumbnailPaths.remove(request.filePath);
+			d->thumbnailPaths.remove(request.filePath);
+			if (!thumbnail.isNull())
+				emit thumbnailReady(request.filePath, thumbnail);
+
+			if (d->thumbnailRetries.contains(request.filePath))
+			{
+				auto retry = d->thumbnailRetries.take(request.filePath);
+				requestThumbnail(retry.filePath, retry.lastModified, retry.size);
+			}
+
+			startThumbnails();
+		});
+		watcher->setFuture(QtConcurrent::run(&d->thumbnailPool, loadThumbnail, d->thumbnailCacheDir, request.filePath, request.lastModified, request.size));
+	}
+}
+
+void LibraryIndexer::watch(const QString &dirPath)
+{
+	if (!d->watcher->directories().contains(dirPath))
+		d->watcher->addPath(dirPath);
+}
+
+void LibraryIndexer::unwatch(const QString &dirPath)
+{
+	d->watcher->removePath(dirPath);
+}
+
+} // namespace PaintField
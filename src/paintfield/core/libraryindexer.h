@@ -0,0 +1,89 @@
+#pragma once
+
+#include <QObject>
+#include <QDateTime>
+#include <QImage>
+#include "global.h"
+
+namespace PaintField {
+
+/**
+ * A file or a directory found by the LibraryIndexer.
+ */
+struct LibraryEntry
+{
+	QString name;
+	bool isDir = false;
+	qint64 size = 0;
+	QDateTime lastModified;
+};
+
+/**
+ * The LibraryIndexer lists directories and makes file thumbnails on worker threads.
+ *
+ * Directories are listed one level at a time, so a large library is only read as far as it is browsed.
+ * Thumbnails are cached on disk, one for each file path, and made again when the modification time or size of the file changes.
+ * The cache is limited in size and age.
+ * Watched directories are reported through directoryChanged when their contents change.
+ */
+class LibraryIndexer : public QObject
+{
+	Q_OBJECT
+public:
+
+	enum
+	{
+		ThumbnailSize = 128
+	};
+
+	explicit LibraryIndexer(QObject *parent = 0);
+	~LibraryIndexer();
+
+	/**
+	 * Sets the directory the thumbnails are cached in (a subdirectory of the cache location by default).
+	 */
+	void setThumbnailCacheDir(const QString &path);
+	QString thumbnailCacheDir() const;
+
+	/**
+	 * @return Whether thumbnails can be made for the file
+	 */
+	static bool canMakeThumbnail(const QString &filePath);
+
+	/**
+	 * Lists "dirPath" and emits scanned.
+	 * Scanning a directory that is already being scanned lists it again when the current scan finishes.
+	 */
+	void scan(const QString &dirPath);
+
+	/**
+	 * Makes (or reads from the cache) the thumbnail of a file and emits thumbnailReady.
+	 * The newest requests are handled first.
+	 * When too many requests are waiting, the oldest ones are dropped and thumbnailDropped is emitted for them.
+	 */
+	void requestThumbnail(const QString &filePath, const QDateTime &lastModified, qint64 size);
+
+	void watch(const QString &dirPath);
+	void unwatch(const QString &dirPath);
+
+signals:
+
+	/**
+	 * @param entries The entries sorted by name
+	 */
+	void scanned(const QString &dirPath, const QList<LibraryEntry> &entries);
+
+	void thumbnailReady(const QString &filePath, const QImage &thumbnail);
+	void thumbnailDropped(const QString &filePath);
+
+	void directoryChanged(const QString &dirPath);
+
+private:
+
+	void startThumbnails();
+
+	struct Data;
+	QScopedPointer<Data> d;
+};
+
+} // namespace PaintField
@@ -1,12 +1,129 @@
 #include <QDebug>
+#include <functional>
+
+#include "libraryindexer.h"
 
 #include "librarymodel.h"
 
 namespace PaintField {
 
+// set on directory items that have been listed
+static constexpr int fetchedRole = Qt::UserRole + 100;
+
+// the path of file items, for requesting thumbnails
+static constexpr int filePathRole = Qt::UserRole + 101;
+
+struct LibraryModel::Data
+{
+	LibraryIndexer *indexer = 0;
+	QSet<QString> watchedPaths;
+	
+	// the listed items by path
+	QHash<QString, QStandardItem *> items;
+	
+	// the files whose thumbnails are requested or made
+	QSet<QString> thumbnailPaths;
+	
+	QStandardItem *createItem(const QDir &dir, const LibraryEntry &entry)
+	{
+		auto item = new LibraryItem(entry.name, entry.isDir ? LibraryItemType::Dir : LibraryItemType::File);
+		auto path = dir.filePath(entry.name);
+		if (!entry.isDir)
+			item->setData(path, filePathRole);
+		setEntry(item, path, entry);
+		items.insert(path, item);
+		return item;
+	}
+	
+	void setEntry(QStandardItem *item, const QString &path, const LibraryEntry &entry)
+	{
+		if (item->data(LastModifiedRole).toDateTime() == entry.lastModified && item->data(SizeRole).toLongLong() == entry.size)
+			return;
+		
+		// the thumbnail is made again when the item is shown
+		thumbnailPaths.remove(path);
+		
+		item->setData(entry.lastModified, LastModifiedRole);
+		item->setData(entry.size, SizeRole);
+	}
+	
+	void requestThumbnail(QStandardItem *item)
+	{
+		if (!item || item->type() != LibraryItemType::File)
+			return;
+		
+		auto path = item->data(filePathRole).toString();
+		if (thumbnailPaths.contains(path) || !LibraryIndexer::canMakeThumbnail(path))
+			return;
+		
+		thumbnailPaths << path;
+		indexer->requestThumbnail(path, item->data(LastModifiedRole).toDateTime(), item->data(SizeRole).toLongLong());
+	}
+	
+	/// forgets a removed file
+	void forgetFile(const QString &filePath)
+	{
+		items.remove(filePath);
+		thumbnailPaths.remove(filePath);
+	}
+	
+	/// forgets a removed directory and its contents, and stops watching them
+	void forgetDir(const QString &dirPath)
+	{
+		auto prefix = dirPath + '/';
+		auto isRemoved = [&](const QString &path) {
+			return path == dirPath || path.startsWith(prefix);
+		};
+		
+		for (const auto &path : watchedPaths.toList())
+		{
+			if (isRemoved(path))
+			{
+				indexer->unwatch(path);
+				watchedPaths.remove(path);
+			}
+		}
+		
+		for (auto iter = items.begin(); iter != items.end();)
+		{
+			if (isRemoved(iter.key()))
+				iter = items.erase(iter);
+			else
+				++iter;
+		}
+		
+		for (const auto &path : thumbnailPaths.toList())
+		{
+			if (isRemoved(path))
+				thumbnailPaths.remove(path);
+		}
+	}
+};
+
 LibraryModel::LibraryModel(QObject *parent) :
-    QStandardItemModel(parent)
+    QStandardItemModel(parent),
+    d(new Data)
+{
+	using namespace std::placeholders;
+	
+	d->indexer = new LibraryIndexer(this);
+	connect(d->indexer, &LibraryIndexer::scanned, this, std::bind(&LibraryModel::onScanned, this, _1, _2));
+	connect(d->indexer, &LibraryIndexer::thumbnailReady, this, std::bind(&LibraryModel::onThumbnailReady, this, _1, _2));
+	connect(d->indexer, &LibraryIndexer::directoryChanged, this, std::bind(&LibraryModel::onDirectoryChanged, this, _1));
+	
+	// dropped requests are made again if the items are shown again
+	connect(d->indexer, &LibraryIndexer::thumbnailDropped, this, [this](const QString &filePath) {
+		d->thumbnailPaths.remove(filePath);
+	});
+}
+
+LibraryModel::~LibraryModel()
+{
+}
+
+LibraryIndexer *LibraryModel::indexer()
 {
+	return d->indexer;
 }
 
 QStandardItem *LibraryModel::itemDir(QStandardItem *item)
@@ -23,7 +140,7 @@ QStandardItem *LibraryModel::itemDir(QStandardItem *item)
 	}
 }
 
-QString LibraryModel::pathFromItem(QStandardItem *item)
+QString LibraryModel::pathFromItem(QStandardItem *item) const
 {
 	if (!item)
 	{
@@ -69,6 +186,11 @@ LibraryItem *LibraryModel::libraryItem(QStandardItem *item)
 	return dynamic_cast<LibraryItem *>(item);
 }
 
+QStandardItem *LibraryModel::itemFromPath(const QString &path)
+{
+	return d->items.value(path, 0);
+}
+
 void LibraryModel::addRootPath(const QString &path, const QString &displayText)
 {
 	auto dir = QDir(path);
@@ -80,9 +202,10 @@ void LibraryModel::addRootPath(const QString &path, const QString &displayText)
 	}
 	
 	auto item = new LibraryRootItem(path, displayText);
-	item->appendRows(createChildItems(dir));
-	
 	invisibleRootItem()->appendRow(item);
+	d->items.insert(path, item);
+	
+	fetchMore(item->index());
 }
 
 void LibraryModel::updateDirItem(QStandardItem *item)
@@ -91,34 +214,120 @@ void LibraryModel::updateDirItem(QStandardItem *item)
 		return;
 	
 	if (item->type() == LibraryItemType::Dir || item->type() == LibraryItemType::Root)
+		d->indexer->scan(pathFromItem(item));
+}
+
+QVariant LibraryModel::data(const QModelIndex &index, int role) const
+{
+	// thumbnails are only made for the items that are shown
+	if (role == Qt::DecorationRole)
+		d->requestThumbnail(itemFromIndex(index));
+	
+	return QStandardItemModel::data(index, role);
+}
+
+bool LibraryModel::hasChildren(const QModelIndex &parent) const
+{
+	// directories can be expanded before they are listed
+	auto item = itemFromIndex(parent);
+	if (item && (item->type() == LibraryItemType::Dir || item->type() == LibraryItemType::Root) && !item->data(fetchedRole).toBool())
+		return true;
+	
+	return QStandardItemModel::hasChildren(parent);
+}
+
+bool LibraryModel::canFetchMore(const QModelIndex &parent) const
+{
+	auto item = itemFromIndex(parent);
+	return item && (item->type() == LibraryItemType::Dir || item->type() == LibraryItemType::Root) && !item->data(fetchedRole).toBool();
+}
+
+void LibraryModel::fetchMore(const QModelIndex &parent)
+{
+	if (canFetchMore(parent))
+		d->indexer->scan(pathFromIndex(parent));
+}
+
+void LibraryModel::onScanned(const QString &dirPath, const QList<LibraryEntry> &entries)
+{
+	auto item = itemFromPath(dirPath);
+	if (!item || !QFileInfo(dirPath).isDir())
+		return;
+	
+	QDir dir(dirPath);
+	
+	item->setData(true, fetchedRole);
+	if (!d->watchedPaths.contains(dirPath))
+	{
+		d->indexer->watch(dirPath);
+		d->watchedPaths << dirPath;
+	}
+	
+	// remove the items of files that are gone
 	{
-		auto dir = QDir(pathFromItem(item));
+		QSet<QPair<QString, bool>> names;
+		for (const auto &entry : entries)
+			names << qMakePair(entry.name, entry.isDir);
 		
-		item->removeRows(0, item->rowCount());
-		item->appendRows(createChildItems(dir));
+		for (int row = item->rowCount() - 1; row >= 0; --row)
+		{
+			auto child = item->child(row);
+			bool isDir = child->type() == LibraryItemType::Dir;
+			if (names.contains(qMakePair(child->text(), isDir)))
+				continue;
+			if (isDir)
+				d->forgetDir(dir.filePath(child->text()));
+			else
+				d->forgetFile(dir.filePath(child->text()));
+			item->removeRow(row);
+		}
 	}
+	
+	// the remaining items are in the order of the entries, so new items are inserted between them in runs
+	int row = 0;
+	while (row < entries.size())
+	{
+		auto child = item->child(row);
+		if (child && child->text() == entries.at(row).name)
+		{
+			d->setEntry(child, dir.filePath(child->text()), entries.at(row));
+			++row;
+			continue;
+		}
+		
+		int insertionRow = row;
+		QList<QStandardItem *> newItems;
+		
+		while (row < entries.size() && !(child && child->text() == entries.at(row).name))
+		{
+			newItems << d->createItem(dir, entries.at(row));
+			++row;
+		}
+		
+		item->insertRows(insertionRow, newItems);
+	}
+	
+	emit directoryLoaded(dirPath);
 }
 
-QStandardItem *LibraryModel::createTreeRecursive(const QDir &dir)
+void LibraryModel::onThumbnailReady(const QString &filePath, const QImage &thumbnail)
 {
-	auto item = new LibraryItem(dir.dirName(), LibraryItemType::Dir);
-	item->appendRows(createChildItems(dir));
-	return item;
+	auto item = d->items.value(filePath);
+	if (item)
+		item->setData(thumbnail, Qt::DecorationRole);
 }
 
-QList<QStandardItem *> LibraryModel::createChildItems(const QDir &dir)
+void LibraryModel::onDirectoryChanged(const QString &dirPath)
 {
-	QList<QStandardItem *> items;
-	
-	for (const QFileInfo &fileInfo : dir.entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot))
+	if (itemFromPath(dirPath))
 	{
-		if (fileInfo.isDir())
-			items.append(createTreeRecursive(QDir(fileInfo.filePath())));
-		else if (fileInfo.isFile())
-			items.append(new LibraryItem(fileInfo.fileName(), LibraryItemType::File));
+		d->indexer->scan(dirPath);
+	}
+	else
+	{
+		d->indexer->unwatch(dirPath);
+		d->watchedPaths.remove(dirPath);
 	}
-	
-	return items;
 }
 
 QModelIndex LibraryModel::findIndex(const QString &text, const QModelIndex &parent) const
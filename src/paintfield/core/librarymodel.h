@@ -51,12 +51,31 @@ private:
 	LibraryItemType _type;
 };
 
+class LibraryIndexer;
+struct LibraryEntry;
+
+/**
+ * The LibraryModel shows the files in library directories.
+ *
+ * Directories are listed on a worker thread by the LibraryIndexer when they are first expanded (fetchMore),
+ * and listed again when their contents change.
+ * Files that can be previewed get thumbnails in the background when their items are first shown (data() with Qt::DecorationRole).
+ */
 class LibraryModel : public QStandardItemModel
 {
 	Q_OBJECT
 public:
 	
+	enum Role
+	{
+		LastModifiedRole = Qt::UserRole + 1,
+		SizeRole
+	};
+	
 	explicit LibraryModel(QObject *parent = 0);
+	~LibraryModel();
+	
+	LibraryIndexer *indexer();
 	
 	/**
 	 * @param item
@@ -73,7 +92,7 @@ public:
 	 * @param item
 	 * @return The path of the item
 	 */
-	QString pathFromItem(QStandardItem *item);
+	QString pathFromItem(QStandardItem *item) const;
 	
 	/**
 	 * @param index
@@ -81,19 +100,48 @@ public:
 	 */
 	QString pathFromIndex(const QModelIndex &index) { return pathFromItem(itemFromIndex(index)); }
 	
+	/**
+	 * @return The item of "path" (0 if it is not listed)
+	 */
+	QStandardItem *itemFromPath(const QString &path);
+	
 	LibraryItem *libraryItem(QStandardItem *item);
 	LibraryItem *libraryItemFromIndex(const QModelIndex &index) { return libraryItem(itemFromIndex(index)); }
 	
+	/**
+	 * Adds a root directory and starts listing it.
+	 */
 	void addRootPath(const QString &path, const QString &displayText);
+	
+	/**
+	 * Lists a directory item again. The items of unchanged files are kept.
+	 */
 	void updateDirItem(QStandardItem *item);
 	void updateDirItem(const QModelIndex &index) { updateDirItem(itemFromIndex(index)); }
 	
-	static QStandardItem *createTreeRecursive(const QDir &dir);
-	static QList<QStandardItem *> createChildItems(const QDir &dir);
-	
 	QModelIndex findIndex(const QString &text, const QModelIndex &parent) const;
 	QModelIndex findIndex(const QStringList &texts, const QModelIndex &parent = QModelIndex()) const;
 	
+	QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+	bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+	bool canFetchMore(const QModelIndex &parent) const override;
+	void fetchMore(const QModelIndex &parent) override;
+	
+signals:
+	
+	/**
+	 * Emitted when the items of a directory are updated.
+	 */
+	void directoryLoaded(const QString &path);
+	
+private:
+	
+	void onScanned(const QString &dirPath, const QList<LibraryEntry> &entries);
+	void onThumbnailReady(const QString &filePath, const QImage &thumbnail);
+	void onDirectoryChanged(const QString &dirPath);
+	
+	struct Data;
+	QScopedPointer<Data> d;
 };
 
 } // namespace PaintField
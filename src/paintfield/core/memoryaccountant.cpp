@@ -0,0 +1,289 @@
+#include <QTimer>
+#include <algorithm>
+#include <QPixmap>
+#include <Malachite/Surface>
+
+#include "document.h"
+#include "layerscene.h"
+#include "rasterlayer.h"
+
+#include "memoryaccountant.h"
+
+using namespace Malachite;
+
+namespace PaintField {
+
+void MemoryCounter::addImage(const QImage &image)
+{
+	if (!image.isNull())
+		addShared(image.cacheKey(), image.byteCount());
+}
+
+void MemoryCounter::addPixmap(const QPixmap &pixmap)
+{
+	if (!pixmap.isNull())
+		addShared(pixmap.cacheKey(), qint64(pixmap.width()) * pixmap.height() * pixmap.depth() / 8);
+}
+
+void MemoryCounter::addLayer(const LayerConstRef &layer)
+{
+	auto rasterLayer = dynamicSPCast<const RasterLayer>(layer);
+	if (rasterLayer)
+		addSurface(rasterLayer->surface());
+	
+	for (const auto &child : layer->children())
+		addLayer(child);
+}
+
+namespace {
+
+// the budget is checked after this idle time following a change
+constexpr int refreshDelay = 2000;
+
+// untranslated names for report()
+const char *const categoryKeys[] = { "layers", "stroke", "undo", "thumbnails", "viewportMipmap", "selectionMipmap" };
+
+struct Source
+{
+	const void *owner;
+	MemoryAccountant::Category category;
+	Document *document;
+	std::function<void (MemoryCounter &)> measure;
+	std::function<void ()> release;
+	qint64 bytes = 0;
+};
+
+} // anonymous namespace
+
+struct MemoryAccountant::Data
+{
+	QList<Source> mSources;
+	qint64 mBudget = 0;
+	bool mExceeded = false;
+	QTimer *mRefreshTimer = 0;
+
+	void measure()
+	{
+		MemoryCounter counter;
+
+		for (int category = 0; category < CategoryCount; ++category) {
+			for (auto &source : mSources) {
+				if (source.category != category)
+					continue;
+				auto before = counter.bytes();
+				source.measure(counter);
+				source.bytes = counter.bytes() - before;
+			}
+		}
+	}
+
+	qint64 total() const
+	{
+		qint64 sum = 0;
+		for (const auto &source : mSources)
+			sum += source.bytes;
+		return sum;
+	}
+
+	/**
+	 * Releases memory from the cheapest categories first until the usage fits in the budget.
+	 */
+	void release()
+	{
+		for (int category = CategoryCount - 1; category >= 0 && total() > mBudget; --category) {
+			bool released = false;
+			for (const auto &source : mSources) {
+				if (source.category == category && source.release) {
+					source.release();
+					released = true;
+				}
+			}
+			if (released)
+				measure();
+		}
+	}
+};
+
+MemoryAccountant::MemoryAccountant(QObject *parent) :
+	QObject(parent),
+	d(new Data)
+{
+	d->mRefreshTimer = new QTimer(this);
+	d->mRefreshTimer->setSingleShot(true);
+	d->mRefreshTimer->setInterval(refreshDelay);
+	connect(d->mRefreshTimer, SIGNAL(timeout()), this, SLOT(refresh()));
+}
+
+MemoryAccountant::~MemoryAccountant()
+{
+}
+
+QString MemoryAccountant::categoryName(Category category)
+{
+	switch (category) {
+	case CategoryLayers:
+		return tr("Layers");
+	case CategoryStroke:
+		return tr("Stroke");
+	case CategoryUndo:
+		return tr("Undo");
+	case CategoryThumbnails:
+		return tr("Thumbnails");
+	case CategoryViewportMipmap:
+		return tr("Canvas Views");
+	case CategorySelectionMipmap:
+		return tr("Selection Views");
+	default:
+		return QString();
+	}
+}
+
+void MemoryAccountant::addSource(const void *owner, Category category, Document *document, const std::function<void (MemoryCounter &)> &measure, const std::function<void ()> &release)
+{
+	Source source;
+	source.owner = owner;
+	source.category = category;
+	source.document = document;
+	source.measure = measure;
+	source.release = release;
+	d->mSources << source;
+}
+
+void MemoryAccountant::removeSources(const void *owner)
+{
+	auto iter = std::remove_if(d->mSources.begin(), d->mSources.end(), [owner](const Source &source) {
+		return source.owner == owner;
+	});
+	d->mSources.erase(iter, d->mSources.end());
+}
+
+void MemoryAccountant::setBudget(qint64 bytes)
+{
+	d->mBudget = bytes;
+	scheduleRefresh();
+}
+
+qint64 MemoryAccountant::budget() const
+{
+	return d->mBudget;
+}
+
+qint64 MemoryAccountant::totalUsage() const
+{
+	return d->total();
+}
+
+qint64 MemoryAccountant::usage(Category category) const
+{
+	qint64 sum = 0;
+	for (const auto &source : d->mSources) {
+		if (source.category == category)
+			sum += source.bytes;
+	}
+	return sum;
+}
+
+qint64 MemoryAccountant::usage(Document *document) const
+{
+	qint64 sum = 0;
+	for (const auto &source : d->mSources) {
+		if (source.document == document)
+			sum += source.bytes;
+	}
+	return sum;
+}
+
+qint64 MemoryAccountant::usage(Document *document, Category category) const
+{
+	qint64 sum = 0;
+	for (const auto &source : d->mSources) {
+		if (source.document == document && source.category == category)
+			sum += source.bytes;
+	}
+	return sum;
+}
+
+QList<Document *> MemoryAccountant::documents() const
+{
+	QList<Document *> documents;
+	for (const auto &source : d->mSources) {
+		if (source.document && !documents.contains(source.document))
+			documents << source.document;
+	}
+	return documents;
+}
+
+QList<QPair<LayerConstRef, qint64>> MemoryAccountant::layerUsages(Document *document)
+{
+	constexpr qint64 tileBytes = Surface::tileWidth() * Surface::tileWidth() * sizeof(Pixel);
+
+	QList<QPair<LayerConstRef, qint64>> usages;
+
+	std::function<void (const LayerConstRef &)> addLayer = [&](const LayerConstRef &layer) {
+		usages << qMakePair(layer, layer->tileKeys().size() * tileBytes);
+		for (const auto &child : layer->children())
+			addLayer(child);
+	};
+
+	for (const auto &layer : document->layerScene()->topLevelLayers())
+		addLayer(layer);
+
+	return usages;
+}
+
+QVariantMap MemoryAccountant::report() const
+{
+	auto categoryMap = [this](Document *document) {
+		QVariantMap map;
+		for (int i = 0; i < CategoryCount; ++i) {
+			auto category = Category(i);
+			map[categoryKeys[i]] = document ? usage(document, category) : usage(category);
+		}
+		return map;
+	};
+
+	QVariantList documents;
+	for (auto document : this->documents()) {
+		QVariantMap map;
+		map["name"] = document->fileName();
+		map["total"] = usage(document);
+		map["categories"] = categoryMap(document);
+		documents << map;
+	}
+
+	QVariantMap result;
+	result["total"] = totalUsage();
+	result["budget"] = budget();
+	result["categories"] = categoryMap(0);
+	result["documents"] = documents;
+	return result;
+}
+
+void MemoryAccountant::scheduleRefresh()
+{
+	if (d->mBudget > 0)
+		d->mRefreshTimer->start();
+}
+
+void MemoryAccountant::refresh()
+{
+	d->mRefreshTimer->stop();
+
+	d->measure();
+
+	bool exceeded = false;
+
+	if (d->mBudget > 0 && d->total() > d->mBudget) {
+		d->release();
+		exceeded = d->total() > d->mBudget;
+	}
+
+	emit usageChanged();
+
+	// warn once each time the budget is exceeded
+	if (exceeded && !d->mExceeded)
+		emit budgetExceeded(d->total(), d->mBudget);
+	d->mExceeded = exceeded;
+}
+
+} // namespace PaintField
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <QObject>
+#include <QSet>
+#include <QVariant>
+#include <functional>
+#include <Malachite/GenericImage>
+#include <Malachite/GenericSurface>
+#include "selectionsurface.h"
+#include "layer.h"
+
+class QPixmap;
+
+namespace PaintField {
+
+class Document;
+
+/**
+ * The MemoryCounter sums up the bytes of images.
+ * Images that share their data are counted only once, even across different memory sources.
+ */
+class MemoryCounter
+{
+public:
+
+	qint64 bytes() const { return mBytes; }
+
+	void addBytes(qint64 bytes) { mBytes += bytes; }
+
+	template <class TPixel>
+	void addImage(const Malachite::GenericImage<TPixel> &image)
+	{
+		if (image.isValid())
+			addShared(image.dataId(), image.byteCount());
+	}
+
+	void addImage(const QImage &image);
+	void addImage(const SelectionImage &image) { addImage(image.qimage()); }
+	void addPixmap(const QPixmap &pixmap);
+
+	template <class TImage, class TTileTraits>
+	void addSurface(const Malachite::GenericSurface<TImage, TTileTraits> &surface)
+	{
+		for (auto iter = surface.begin(); iter != surface.end(); ++iter)
+			addImage(iter.value());
+	}
+
+	/**
+	 * Adds the surfaces of the raster layers in "layer" and its descendants.
+	 */
+	void addLayer(const LayerConstRef &layer);
+
+private:
+
+	void addShared(const void *id, qint64 bytes)
+	{
+		if (mCounted.contains(id))
+			return;
+		mCounted << id;
+		mBytes += bytes;
+	}
+
+	/// for QImage and QPixmap, identified by their cache keys
+	void addShared(qint64 cacheKey, qint64 bytes)
+	{
+		if (mCountedCacheKeys.contains(cacheKey))
+			return;
+		mCountedCacheKeys << cacheKey;
+		mBytes += bytes;
+	}
+
+	qint64 mBytes = 0;
+	QSet<const void *> mCounted;
+	QSet<qint64> mCountedCacheKeys;
+};
+
+/**
+ * The MemoryAccountant keeps track of the memory used by documents, viewports and tools.
+ *
+ * Objects that hold large data register themselves as memory sources.
+ * Measuring walks every source, so it is only done on demand: on refresh(), and when a budget is set,
+ * once the application is idle after scheduleRefresh() was called (when documents are edited).
+ * When the total exceeds the budget, the sources that can free memory (mipmaps, caches) are asked to,
+ * and budgetExceeded is emitted if that was not enough.
+ */
+class MemoryAccountant : public QObject
+{
+	Q_OBJECT
+public:
+
+	/**
+	 * The sources are measured in this order, so shared tiles are counted in the first category that holds them.
+	 */
+	enum Category
+	{
+		CategoryLayers,
+		CategoryStroke,
+		CategoryUndo,
+		CategoryThumbnails,
+		CategoryViewportMipmap,
+		CategorySelectionMipmap,
+		CategoryCount
+	};
+
+	explicit MemoryAccountant(QObject *parent = 0);
+	~MemoryAccountant();
+
+	static QString categoryName(Category category);
+
+	/**
+	 * Registers a memory source.
+	 * @param owner The owner of the source, used to remove it
+	 * @param document The document the memory belongs to (0 if none)
+	 * @param measure A function that adds the memory of the source to the given counter
+	 * @param release A function that frees memory that can be recreated (optional)
+	 */
+	void addSource(const void *owner, Category category, Document *document, const std::function<void (MemoryCounter &)> &measure, const std::function<void ()> &release = std::function<void ()>());
+
+	/**
+	 * Removes all sources registered by "owner".
+	 */
+	void removeSources(const void *owner);
+
+	/**
+	 * @param bytes The budget in bytes (0 for no limit)
+	 */
+	void setBudget(qint64 bytes);
+	qint64 budget() const;
+
+	qint64 totalUsage() const;
+	qint64 usage(Category category) const;
+	qint64 usage(Document *document) const;
+	qint64 usage(Document *document, Category category) const;
+
+	/**
+	 * @return The documents that have registered sources
+	 */
+	QList<Document *> documents() const;
+
+	/**
+	 * Measures the tiles of each layer of a document.
+	 * Tiles shared between layers are counted for each of them.
+	 */
+	static QList<QPair<LayerConstRef, qint64>> layerUsages(Document *document);
+
+	/**
+	 * @return The last measured usage (for logging and instrumentation)
+	 */
+	QVariantMap report() const;
+
+public slots:
+
+	/**
+	 * Measures all sources and frees memory if the budget is exceeded.
+	 */
+	void refresh();
+
+	/**
+	 * Checks the budget with refresh() after a while without further calls (nothing is done if there is no budget).
+	 * Called when the memory use may have changed.
+	 */
+	void scheduleRefresh();
+
+signals:
+
+	void usageChanged();
+
+	/**
+	 * Emitted when the usage exceeds the budget even after the releasable memory was freed.
+	 */
+	void budgetExceeded(qint64 usage, qint64 budget);
+
+private:
+
+	struct Data;
+	QScopedPointer<Data> d;
+};
+
+} // namespace PaintField
@@ -1,13 +1,27 @@
 #include <stdexcept>
+#include <algorithm>
+#include <QPainter>
+#include <functional>
 
+#include "drawutil.h"
 #include "layerfactorymanager.h"
+#include "layerrenderer.h"
+#include "rasterlayer.h"
 #include "zip.h"
 #include "json.h"
 
 #include "paintfieldformatsupport.h"
 
+using namespace Malachite;
+
 namespace PaintField {
 
+// the longer sides of the flattened previews embedded in documents
+static const int previewSizes[] = { 256, 1024, 4096 };
+
+// the longer side of the layer thumbnails embedded in documents
+static constexpr int layerThumbnailSize = 128;
+
 PaintFieldFormatSupport::PaintFieldFormatSupport(QObject *parent) :
 	FormatSupport(parent)
 {
@@ -39,7 +53,37 @@ FormatSupport::Capabilities PaintFieldFormatSupport::capabilities() const
 	return CapabilityAll;
 }
 
-static void readLayers(UnzipArchive *archive, QList<LayerRef> &layers, const QVariantList &propertyMaps)
+static QImage loadImage(UnzipArchive *archive, const QString &path)
+{
+	UnzipFile file(archive, path);
+	if (!file.open())
+	{
+		PAINTFIELD_WARNING << "cannot read image" << path;
+		return QImage();
+	}
+	
+	return QImage::fromData(file.readAll(), "PNG");
+}
+
+static bool loadLayerData(UnzipArchive *archive, const LayerRef &layer, const QString &source)
+{
+	UnzipFile file(archive, source);
+	if (!file.open())
+	{
+		PAINTFIELD_WARNING << "cannot read data from source;";
+		return false;
+	}
+	
+	QDataStream stream(&file);
+	layer->loadDataFile(stream);
+	return true;
+}
+
+/**
+ * Reads the layer tree.
+ * If "deferred" is not null, the data of raster layers is not loaded but appended to it.
+ */
+static void readLayers(UnzipArchive *archive, QList<LayerRef> &layers, const QVariantList &propertyMaps, QList<PaintFieldFormatSupport::LayerSource> *deferred)
 {
 	for (const auto &item : propertyMaps)
 	{
@@ -56,18 +100,22 @@ static void readLayers(UnzipArchive *archive, QList<LayerRef> &layers, const QVa
 		if (layer->hasDataToSave() && map.contains("source"))
 		{
 			QString source = map["source"].toString();
-			UnzipFile file(archive, source);
-			if (!file.open())
-				PAINTFIELD_WARNING << "cannot read data from source;";
 			
-			QDataStream stream(&file);
-			layer->loadDataFile(stream);
+			if (deferred && dynamicSPCast<RasterLayer>(layer))
+			{
+				QImage thumbnail;
+				if (map.contains("thumbnail"))
+					thumbnail = loadImage(archive, map["thumbnail"].toString());
+				*deferred << PaintFieldFormatSupport::LayerSource { layer, source, thumbnail };
+			}
+			else
+				loadLayerData(archive, layer, source);
 		}
 		
 		if (layer->canHaveChildren())
 		{
 			QList<LayerRef> layers;
-			readLayers(archive, layers, map["children"].toList());
+			readLayers(archive, layers, map["children"].toList(), deferred);
 			layer->append(layers);
 		}
 		
@@ -75,7 +123,28 @@ static void readLayers(UnzipArchive *archive, QList<LayerRef> &layers, const QVa
 	}
 }
 
-bool PaintFieldFormatSupport::read(QIODevice *device, QList<LayerRef> *layers, QSize *psize)
+static void readHeader(UnzipArchive *archive, QVariantMap *headerMap, QSize *size)
+{
+	{
+		UnzipFile file(archive, "header.json");
+		
+		if (!file.open())
+			throw std::runtime_error("cannot find header.json");
+		
+		*headerMap = Json::read(file.readAll()).toMap();
+	}
+	
+	if ((*headerMap)["version"].toString() != "1.0")
+		throw std::runtime_error("incompatible file version");
+	
+	size->rwidth() = (*headerMap)["width"].toInt();
+	size->rheight() = (*headerMap)["height"].toInt();
+	
+	if (size->isEmpty())
+		throw std::runtime_error("invalid size");
+}
+
+static bool readDocument(QIODevice *device, QList<LayerRef> *layers, QSize *psize, QList<PaintFieldFormatSupport::LayerSource> *deferred)
 {
 	try
 	{
@@ -84,26 +153,10 @@ bool PaintFieldFormatSupport::read(QIODevice *device, QList<LayerRef> *layers, Q
 			throw std::runtime_error("cannot open zip");
 		
 		QVariantMap headerMap;
-		{
-			UnzipFile file(&archive, "header.json");
-			
-			if (!file.open())
-				throw std::runtime_error("cannot find header.json");
-			
-			headerMap = Json::read(file.readAll()).toMap();
-		}
-		
-		if (headerMap["version"].toString() != "1.0")
-			throw std::runtime_error("incompatible file version");
-		
 		QSize size;
-		size.rwidth() = headerMap["width"].toInt();
-		size.rheight() = headerMap["height"].toInt();
-		
-		if (size.isEmpty())
-			throw std::runtime_error("invalid size");
+		readHeader(&archive, &headerMap, &size);
 		
-		readLayers(&archive, *layers, headerMap["stack"].toList());
+		readLayers(&archive, *layers, headerMap["stack"].toList(), deferred);
 		
 		*psize = size;
 		
@@ -116,7 +169,211 @@ bool PaintFieldFormatSupport::read(QIODevice *device, QList<LayerRef> *layers, Q
 	}
 }
 
-static QVariantList saveLayers(ZipArchive *archive, const QList<LayerConstRef> &layers, int &sourceFileCount)
+bool PaintFieldFormatSupport::read(QIODevice *device, QList<LayerRef> *layers, QSize *psize)
+{
+	return readDocument(device, layers, psize, 0);
+}
+
+bool PaintFieldFormatSupport::readStructure(QIODevice *device, QList<LayerRef> *layers, QSize *size, QList<LayerSource> *sources)
+{
+	return readDocument(device, layers, size, sources);
+}
+
+bool PaintFieldFormatSupport::readLayerData(QIODevice *device, const LayerRef &layer, const QString &source)
+{
+	UnzipArchive archive(device);
+	if (!archive.open())
+	{
+		PAINTFIELD_WARNING << "cannot open zip";
+		return false;
+	}
+	
+	return loadLayerData(&archive, layer, source);
+}
+
+QImage PaintFieldFormatSupport::readPreview(QIODevice *device, int minSize)
+{
+	try
+	{
+		UnzipArchive archive(device);
+		if (!archive.open())
+			throw std::runtime_error("cannot open zip");
+		
+		QVariantMap headerMap;
+		QSize size;
+		readHeader(&archive, &headerMap, &size);
+		
+		// the previews are listed from the smallest
+		QString path;
+		for (const auto &item : headerMap["previews"].toList())
+		{
+			auto map = item.toMap();
+			path = map["source"].toString();
+			if (std::max(map["width"].toInt(), map["height"].toInt()) >= minSize)
+				break;
+		}
+		
+		if (path.isEmpty())
+			return QImage();
+		
+		return loadImage(&archive, path);
+	}
+	catch (const std::runtime_error &error)
+	{
+		PAINTFIELD_WARNING << error.what();
+		return QImage();
+	}
+}
+
+/**
+ * @return The number of times "size" has to be halved so that its longer side is less than twice "maxSide"
+ */
+static int levelForSide(const QSize &size, int maxSide)
+{
+	int level = 0;
+	auto levelSize = size;
+	
+	while (std::max(levelSize.width(), levelSize.height()) >= 2 * maxSide)
+	{
+		levelSize = QSize((levelSize.width() + 1) / 2, (levelSize.height() + 1) / 2);
+		++level;
+	}
+	
+	return level;
+}
+
+/**
+ * Downsamples an image of "size" by 2 to the power of "level" (averaging the pixels) into an 8-bit image.
+ * The image is read one block of tiles at a time, each block making one tile of the result,
+ * so only one block of the full-size image is needed at once.
+ * @param surfaceForKeys A function that returns a surface with the given tiles (which may be rendered on demand)
+ */
+static QImage downsampledImage(const QSize &size, int level, const std::function<Surface (const QPointSet &)> &surfaceForKeys)
+{
+	constexpr int tileWidth = Surface::tileWidth();
+	const int scale = 1 << level;
+	const float factor = 1.f / (scale * scale);
+	
+	QSize levelSize((size.width() - 1) / scale + 1, (size.height() - 1) / scale + 1);
+	QImage image(levelSize, QImage::Format_ARGB32_Premultiplied);
+	image.fill(Qt::transparent);
+	
+	QPainter painter(&image);
+	
+	int tileCountX = (size.width() - 1) / tileWidth + 1;
+	int tileCountY = (size.height() - 1) / tileWidth + 1;
+	int blockCountX = (levelSize.width() - 1) / tileWidth + 1;
+	int blockCountY = (levelSize.height() - 1) / tileWidth + 1;
+	
+	for (int blockY = 0; blockY < blockCountY; ++blockY)
+	{
+		for (int blockX = 0; blockX < blockCountX; ++blockX)
+		{
+			auto blockOrigin = QPoint(blockX, blockY) * scale;
+			
+			QPointSet keys;
+			for (int y = blockOrigin.y(); y < std::min(blockOrigin.y() + scale, tileCountY); ++y)
+			{
+				for (int x = blockOrigin.x(); x < std::min(blockOrigin.x() + scale, tileCountX); ++x)
+					keys << QPoint(x, y);
+			}
+			
+			auto surface = surfaceForKeys(keys);
+			
+			Image block(tileWidth, tileWidth);
+			block.clear();
+			bool isEmpty = true;
+			
+			for (const QPoint &key : keys)
+			{
+				if (!surface.contains(key))
+					continue;
+				isEmpty = false;
+				
+				auto tile = surface.tile(key);
+				auto offset = (key - blockOrigin) * tileWidth;
+				
+				for (int y = 0; y < tileWidth; ++y)
+				{
+					auto src = tile.constPixelPointer(0, y);
+					auto dst = block.pixelPointer(0, (offset.y() + y) / scale);
+					for (int x = 0; x < tileWidth; ++x)
+						dst[(offset.x() + x) / scale].rv() += src[x].v();
+				}
+			}
+			
+			if (isEmpty)
+				continue;
+			
+			for (auto &pixel : block)
+				pixel.rv() *= factor;
+			
+			DrawUtil::drawMLImage(&painter, blockX * tileWidth, blockY * tileWidth, block);
+		}
+	}
+	
+	return image;
+}
+
+static QImage fitImage(const QImage &image, int maxSide)
+{
+	if (std::max(image.width(), image.height()) <= maxSide)
+		return image;
+	return image.scaled(maxSide, maxSide, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+}
+
+static void saveImage(ZipArchive *archive, const QString &path, const QImage &image)
+{
+	ZipFile file(archive, path);
+	if (!file.open())
+		throw std::runtime_error("cannot add image file");
+	
+	if (!image.save(&file, "PNG"))
+		throw std::runtime_error("cannot write image file");
+}
+
+/**
+ * Saves the flattened previews of the document, from the smallest.
+ * Sizes larger than the document are skipped, except the smallest one.
+ * The document is rendered one block of tiles at a time into the largest preview, and the smaller ones are scaled from it.
+ */
+static QVariantList savePreviews(ZipArchive *archive, const QList<LayerConstRef> &layers, const QSize &size)
+{
+	int documentSide = std::max(size.width(), size.height());
+	int previousSide = 0;
+	
+	QList<int> sides;
+	for (int side : previewSizes)
+	{
+		if (previousSide >= documentSide)
+			break;
+		previousSide = side;
+		sides << side;
+	}
+	
+	auto image = downsampledImage(size, levelForSide(size, sides.last()), [&](const QPointSet &keys) {
+		return LayerRenderer().renderToSurface(layers, keys);
+	});
+	
+	QVariantList maps;
+	
+	for (int i = sides.size() - 1; i >= 0; --i)
+	{
+		image = fitImage(image, sides.at(i));
+		QString path = "previews/" + QString::number(sides.at(i)) + ".png";
+		saveImage(archive, path, image);
+		
+		QVariantMap map;
+		map["source"] = path;
+		map["width"] = image.width();
+		map["height"] = image.height();
+		maps.prepend(map);
+	}
+	
+	return maps;
+}
+
+static QVariantList saveLayers(ZipArchive *archive, const QList<LayerConstRef> &layers, const QSize &size, int &sourceFileCount)
 {
 	QVariantList maps;
 	
@@ -129,20 +386,36 @@ static QVariantList saveLayers(ZipArchive *archive, const QList<LayerConstRef> &
 		{
 			QString path = "data/" + QString::number(sourceFileCount) + "." + layer->dataSuffix();
 			sourceFileCount++;
-			ZipFile file(archive, path);
-			if (!file.open())
-				throw std::runtime_error("cannot add source file");
 			
-			QDataStream stream(&file);
-			
-			layer->saveDataFile(stream);
+			{
+				ZipFile file(archive, path);
+				if (!file.open())
+					throw std::runtime_error("cannot add source file");
+				
+				QDataStream stream(&file);
+				
+				layer->saveDataFile(stream);
+			}
 			
 			map["source"] = path;
+			
+			// shown while the layer data is being loaded
+			auto rasterLayer = dynamicSPCast<const RasterLayer>(layer);
+			if (rasterLayer)
+			{
+				QString thumbnailPath = "thumbnails/" + QString::number(sourceFileCount - 1) + ".png";
+				auto surface = rasterLayer->surface();
+				auto thumbnail = downsampledImage(size, levelForSide(size, layerThumbnailSize), [&](const QPointSet &) {
+					return surface;
+				});
+				saveImage(archive, thumbnailPath, fitImage(thumbnail, layerThumbnailSize));
+				map["thumbnail"] = thumbnailPath;
+			}
 		}
 		
 		if (layer->count())
 		{
-			map["children"] = saveLayers(archive, layer->children(), sourceFileCount);
+			map["children"] = saveLayers(archive, layer->children(), size, sourceFileCount);
 		}
 		
 		maps << map;
@@ -168,9 +441,11 @@ bool PaintFieldFormatSupport::write(QIODevice *device, const QList<LayerConstRef
 		
 		{
 			int count = 0;
-			headerMap["stack"] = saveLayers(&archive, layers, count);
+			headerMap["stack"] = saveLayers(&archive, layers, size, count);
 		}
 		
+		headerMap["previews"] = savePreviews(&archive, layers, size);
+		
 		{
 			auto headerData = Json::write(headerMap);
 			ZipFile file(&archive, "header.json");
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <QImage>
 #include "formatsupport.h"
 
 namespace PaintField {
@@ -20,6 +21,36 @@ public:
 	bool read(QIODevice *device, QList<LayerRef> *layers, QSize *size) override;
 	bool write(QIODevice *device, const QList<LayerConstRef> &layers, const QSize &size, const QVariant &option) override;
 	
+	/**
+	 * A layer whose data is not loaded yet.
+	 */
+	struct LayerSource
+	{
+		LayerRef layer;
+		QString source;	// the path of the data file in the archive
+		QImage thumbnail;	// the thumbnail embedded in the document (null if there is none)
+	};
+	
+	/**
+	 * Reads the size and the layer tree of a document without decoding the raster layer data.
+	 * @param sources Set to the layers whose data has to be loaded with readLayerData
+	 */
+	static bool readStructure(QIODevice *device, QList<LayerRef> *layers, QSize *size, QList<LayerSource> *sources);
+	
+	/**
+	 * Loads the data of a layer from a document.
+	 * Each call opens its own archive on "device", so layers can be loaded in parallel from different devices.
+	 */
+	static bool readLayerData(QIODevice *device, const LayerRef &layer, const QString &source);
+	
+	/**
+	 * Reads a flattened preview of a document.
+	 * Documents embed previews of a few sizes, so they can be shown before (or without) loading the layers.
+	 * @param minSize The smallest preview whose longer side is at least "minSize" is read (the largest one if there is none)
+	 * @return A null image if the document has no preview
+	 */
+	static QImage readPreview(QIODevice *device, int minSize);
+	
 signals:
 	
 public slots:
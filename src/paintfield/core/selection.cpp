@@ -2,6 +2,7 @@
 
 #include "document.h"
 #include "closureundocommand.h"
+#include "softselection.h"
 #include <QUndoCommand>
 
 namespace PaintField {
@@ -11,6 +12,19 @@ struct Selection::Data
 	Document *mDocument = 0;
 	SelectionSurface mSurface, mOriginalSurface;
 	QPointSet mModifiedKeys;
+
+	// empty unless the selection has soft edges
+	Malachite::CoverageSurface mCoverage, mOriginalCoverage;
+
+	void setSelection(const SelectionSurface &surface, const Malachite::CoverageSurface &coverage, Selection *selection)
+	{
+		auto keys = mSurface.keys() | surface.keys();
+		mSurface = surface;
+		mOriginalSurface = surface;
+		mCoverage = coverage;
+		mOriginalCoverage = coverage;
+		emit selection->surfaceChanged(mSurface, keys);
+	}
 };
 
 Selection::Selection(Document *document) :
@@ -38,8 +52,18 @@ SelectionSurface Selection::surface() const
 	return d->mSurface;
 }
 
+Malachite::CoverageSurface Selection::coverage() const
+{
+	if (!d->mCoverage.isEmpty())
+		return d->mCoverage;
+	return coverageFromSelection(d->mSurface);
+}
+
 void Selection::updateSurface(const SelectionSurface &surface, const QPointSet &keys)
 {
+	// binary edits drop the soft edges
+	d->mCoverage = Malachite::CoverageSurface();
+
 	for (const auto &key : keys) {
 		d->mSurface[key] = surface[key];
 	}
@@ -52,18 +76,66 @@ void Selection::commitSurface()
 	d->mSurface.squeeze();
 
 	auto before = d->mOriginalSurface;
+	auto coverageBefore = d->mOriginalCoverage;
 	auto after = d->mSurface;
+	auto coverageAfter = d->mCoverage;
 
+	// the coverage is restored too, as the binary edit dropped the soft edges
 	auto command = new ClosureUndoCommand(
 		[=](){
-			d->mSurface = after;
+			d->setSelection(after, coverageAfter, this);
 		},
 		[=](){
-			d->mSurface = before;
+			d->setSelection(before, coverageBefore, this);
 		});
 	d->mDocument->undoStack()->push(command);
 }
 
+void Selection::setSurface(const SelectionSurface &surface)
+{
+	auto surfaceBefore = d->mSurface;
+	auto coverageBefore = d->mCoverage;
+
+	auto command = new ClosureUndoCommand(
+		[=](){
+			d->setSelection(surface, Malachite::CoverageSurface(), this);
+		},
+		[=](){
+			d->setSelection(surfaceBefore, coverageBefore, this);
+		});
+	d->mDocument->undoStack()->push(command);
+}
 
+void Selection::setCoverage(const Malachite::CoverageSurface &coverage)
+{
+	auto surfaceBefore = d->mSurface;
+	auto coverageBefore = d->mCoverage;
+	auto surfaceAfter = selectionFromCoverage(coverage);
+	auto coverageAfter = coverage;
+
+	auto command = new ClosureUndoCommand(
+		[=](){
+			d->setSelection(surfaceAfter, coverageAfter, this);
+		},
+		[=](){
+			d->setSelection(surfaceBefore, coverageBefore, this);
+		});
+	d->mDocument->undoStack()->push(command);
+}
+
+void Selection::feather(double radius)
+{
+	setCoverage(featherCoverage(coverage(), radius));
+}
+
+void Selection::grow(double distance)
+{
+	setCoverage(growCoverage(coverage(), distance));
+}
+
+void Selection::shrink(double distance)
+{
+	setCoverage(shrinkCoverage(coverage(), distance));
+}
 
 } // namespace PaintField
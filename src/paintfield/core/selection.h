@@ -1,6 +1,7 @@
 #pragma once
 
 #include "selectionsurface.h"
+#include <Malachite/Coverage>
 #include <QObject>
 
 namespace PaintField {
@@ -17,11 +18,32 @@ public:
 	~Selection();
 
 	SelectionSurface surface() const;
+
+	/**
+	 * @return The anti-aliased coverage of the selection (0 or 255 if the selection has no soft edges)
+	 */
+	Malachite::CoverageSurface coverage() const;
 	
 public slots:
 
 	void updateSurface(const SelectionSurface &surface, const QPointSet &keys);
 	void commitSurface();
+
+	/**
+	 * Replaces the whole selection (undoable).
+	 */
+	void setSurface(const SelectionSurface &surface);
+
+	/**
+	 * Replaces the selection with anti-aliased coverage (undoable).
+	 * The binary surface is updated to the pixels with coverage >= 50%.
+	 */
+	void setCoverage(const Malachite::CoverageSurface &coverage);
+
+	void feather(double radius);
+	void grow(double distance);
+	void shrink(double distance);
+
 signals:
 
 	void surfaceChanged(const SelectionSurface &surface, const QPointSet &keys);
@@ -1,8 +1,86 @@
 #include "selectionsurface.h"
-#include <boost/range/irange.hpp>
+#include <QtEndian>
+#include <QtAlgorithms>
+#include <emmintrin.h>
+#include <cstring>
+#include <algorithm>
 
 namespace PaintField {
 
+namespace {
+
+/**
+ * Reads "count" (<= 64) bits from "bit" of a MSB-first row, left-aligned in the result.
+ */
+inline quint64 readBits(const uchar *row, int bit, int count)
+{
+	auto p = row + bit / 8;
+	int shift = bit % 8;
+	int byteCount = (shift + count + 7) / 8;
+
+	quint64 value;
+	if (byteCount >= 8) {
+		value = qFromBigEndian<quint64>(p);
+	} else {
+		value = 0;
+		for (int i = 0; i < byteCount; ++i)
+			value |= quint64(p[i]) << (56 - 8 * i);
+	}
+
+	value <<= shift;
+	if (byteCount > 8)
+		value |= quint64(p[8]) >> (8 - shift);
+
+	if (count < 64)
+		value &= ~quint64(0) << (64 - count);
+	return value;
+}
+
+/**
+ * Writes the first "count" (<= 64) bits of "value" (left-aligned) to "bit" of a MSB-first row.
+ */
+inline void writeBits(uchar *row, int bit, int count, quint64 value)
+{
+	auto p = row + bit / 8;
+	int shift = bit % 8;
+	int byteCount = (shift + count + 7) / 8;
+
+	quint64 mask = count < 64 ? ~quint64(0) << (64 - count) : ~quint64(0);
+
+	auto writeByte = [](uchar *byte, uchar bits, uchar bitMask) {
+		*byte = (*byte & ~bitMask) | (bits & bitMask);
+	};
+
+	quint64 high = value >> shift;
+	quint64 highMask = mask >> shift;
+
+	if (byteCount >= 8 && highMask == ~quint64(0)) {
+		qToBigEndian(high, p);
+	} else {
+		for (int i = 0; i < std::min(byteCount, 8); ++i)
+			writeByte(p + i, uchar(high >> (56 - 8 * i)), uchar(highMask >> (56 - 8 * i)));
+	}
+
+	if (byteCount > 8)
+		writeByte(p + 8, uchar(value << (8 - shift)), uchar(mask << (8 - shift)));
+}
+
+/**
+ * @return The mask of the valid bits in the last byte of a row
+ */
+inline uchar lastByteMask(int width)
+{
+	int rem = width % 8;
+	return rem ? uchar(0xFF << (8 - rem)) : 0xFF;
+}
+
+inline bool isContiguous(const QImage &image)
+{
+	return image.bytesPerLine() * 8 == image.width();
+}
+
+}
+
 SelectionImage::SelectionImage(const QSize &size) :
 	mImage(size, QImage::Format_Mono)
 {
@@ -15,41 +93,246 @@ void SelectionImage::fill(bool x)
 
 void SelectionImage::paste(const SelectionImage &other, const QPoint &pos)
 {
-	QPainter painter(&mImage);
-	painter.drawImage(pos, other.mImage);
+	auto rect = QRect(QPoint(), size()) & QRect(pos, other.size());
+	if (rect.isEmpty())
+		return;
+
+	for (int y = rect.top(); y <= rect.bottom(); ++y) {
+		auto dst = mImage.scanLine(y);
+		auto src = other.mImage.constScanLine(y - pos.y());
+
+		for (int x = rect.left(); x <= rect.right(); x += 64) {
+			int count = std::min(64, rect.right() + 1 - x);
+			writeBits(dst, x, count, readBits(src, x - pos.x(), count));
+		}
+	}
+}
+
+void SelectionImage::combine(const SelectionImage &other, Operation op)
+{
+	Q_ASSERT(size() == other.size());
+
+	auto combineBytes = [op](uchar *dst, const uchar *src, int count) {
+		int i = 0;
+
+		for (; i + 16 <= count; i += 16) {
+			auto d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+			auto s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+			switch (op) {
+			default:
+			case OperationUnion:
+				d = _mm_or_si128(d, s);
+				break;
+			case OperationIntersect:
+				d = _mm_and_si128(d, s);
+				break;
+			case OperationSubtract:
+				d = _mm_andnot_si128(s, d);
+				break;
+			case OperationXor:
+				d = _mm_xor_si128(d, s);
+				break;
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), d);
+		}
+
+		for (; i < count; ++i) {
+			switch (op) {
+			default:
+			case OperationUnion:
+				dst[i] |= src[i];
+				break;
+			case OperationIntersect:
+				dst[i] &= src[i];
+				break;
+			case OperationSubtract:
+				dst[i] &= ~src[i];
+				break;
+			case OperationXor:
+				dst[i] ^= src[i];
+				break;
+			}
+		}
+	};
+
+	if (mImage.bytesPerLine() == other.mImage.bytesPerLine()) {
+		// padding bits are combined too, but they are never read
+		combineBytes(mImage.bits(), other.mImage.constBits(), mImage.bytesPerLine() * height());
+	} else {
+		int byteCount = (width() + 7) / 8;
+		for (int y = 0; y < height(); ++y)
+			combineBytes(mImage.scanLine(y), other.mImage.constScanLine(y), byteCount);
+	}
 }
 
 bool SelectionImage::isBlank() const
 {
-	int h = height();
-	int w = width();
-	for (int y : boost::irange(0, h)) {
-		auto i = constScanline(y);
-		for (int x : boost::irange(0, w)) {
-			if (*i++)
-				return false;
+	if (mImage.isNull())
+		return true;
+
+	if (isContiguous(mImage)) {
+		auto bits = mImage.constBits();
+		int byteCount = mImage.bytesPerLine() * height();
+		int i = 0;
+		quint64 accum = 0;
+
+		for (; i + 8 <= byteCount; i += 8) {
+			quint64 word;
+			std::memcpy(&word, bits + i, 8);
+			accum |= word;
 		}
+		for (; i < byteCount; ++i)
+			accum |= bits[i];
+
+		return !accum;
+	}
+
+	int fullByteCount = width() / 8;
+	auto lastMask = lastByteMask(width());
+
+	for (int y = 0; y < height(); ++y) {
+		auto row = mImage.constScanLine(y);
+		uchar accum = 0;
+		for (int i = 0; i < fullByteCount; ++i)
+			accum |= row[i];
+		if (width() % 8)
+			accum |= row[fullByteCount] & lastMask;
+		if (accum)
+			return false;
 	}
 	return true;
 }
 
+int SelectionImage::selectedCount() const
+{
+	if (mImage.isNull())
+		return 0;
+
+	int fullByteCount = width() / 8;
+	auto lastMask = lastByteMask(width());
+	int count = 0;
+
+	for (int y = 0; y < height(); ++y) {
+		auto row = mImage.constScanLine(y);
+		int i = 0;
+		for (; i + 8 <= fullByteCount; i += 8) {
+			quint64 word;
+			std::memcpy(&word, row + i, 8);
+			count += qPopulationCount(word);
+		}
+		for (; i < fullByteCount; ++i)
+			count += qPopulationCount(quint8(row[i]));
+		if (width() % 8)
+			count += qPopulationCount(quint8(row[fullByteCount] & lastMask));
+	}
+
+	return count;
+}
+
 QImage SelectionImage::toQImageARGBPremult(QRgb rgbOne, QRgb rgbZero) const
 {
 	auto size = this->size();
 	QImage image(size, QImage::Format_ARGB32_Premultiplied);
-	std::array<uint32_t, 2> rgbs = {{ rgbZero, rgbOne }};
+
+	auto one = _mm_set1_epi32(rgbOne);
+	auto zero = _mm_set1_epi32(rgbZero);
+
+	// the bits of the pixels 0-3 and 4-7 of a byte (the first pixel is the MSB)
+	auto bitsLow = _mm_set_epi32(0x10, 0x20, 0x40, 0x80);
+	auto bitsHigh = _mm_set_epi32(0x01, 0x02, 0x04, 0x08);
+
+	int fullByteCount = size.width() / 8;
 
 	for (int y = 0; y < size.height(); ++y) {
 		auto dst = reinterpret_cast<uint32_t *>(image.scanLine(y));
-		auto dstEnd = dst + size.width();
-		auto src = this->constScanline(y);
-		while (dst != dstEnd) {
-			*dst++ = rgbs[*src++];
+		auto src = mImage.constScanLine(y);
+
+		for (int i = 0; i < fullByteCount; ++i) {
+			auto d = reinterpret_cast<__m128i *>(dst + 8 * i);
+			uchar byte = src[i];
+
+			if (byte == 0) {
+				_mm_storeu_si128(d, zero);
+				_mm_storeu_si128(d + 1, zero);
+			} else if (byte == 0xFF) {
+				_mm_storeu_si128(d, one);
+				_mm_storeu_si128(d + 1, one);
+			} else {
+				auto b = _mm_set1_epi32(byte);
+				auto maskLow = _mm_cmpeq_epi32(_mm_and_si128(b, bitsLow), bitsLow);
+				auto maskHigh = _mm_cmpeq_epi32(_mm_and_si128(b, bitsHigh), bitsHigh);
+				_mm_storeu_si128(d, _mm_or_si128(_mm_and_si128(maskLow, one), _mm_andnot_si128(maskLow, zero)));
+				_mm_storeu_si128(d + 1, _mm_or_si128(_mm_and_si128(maskHigh, one), _mm_andnot_si128(maskHigh, zero)));
+			}
 		}
+
+		for (int x = fullByteCount * 8; x < size.width(); ++x)
+			dst[x] = (src[x / 8] & (0x80 >> (x % 8))) ? rgbOne : rgbZero;
 	}
 
 	return image;
 }
 
+SelectionSurface combineSelectionSurfaces(const SelectionSurface &a, const SelectionSurface &b, SelectionImage::Operation op)
+{
+	SelectionSurface result;
+
+	if (op == SelectionImage::OperationIntersect) {
+		for (auto iter = a.begin(); iter != a.end(); ++iter) {
+			if (!b.contains(iter.key()))
+				continue;
+			auto tile = iter.value();
+			tile.combine(b.tile(iter.key()), op);
+			if (!tile.isBlank())
+				result.setTile(iter.key(), tile);
+		}
+		return result;
+	}
+
+	result = a;
+	QPointSet combinedKeys;
+
+	for (auto iter = b.begin(); iter != b.end(); ++iter) {
+		if (result.contains(iter.key())) {
+			result.tileRef(iter.key()).combine(iter.value(), op);
+			combinedKeys << iter.key();
+		} else if (op != SelectionImage::OperationSubtract) {
+			result.setTile(iter.key(), iter.value());
+		}
+	}
+
+	result.squeeze(combinedKeys);
+	return result;
+}
+
+void downsampleSelectionRows(uchar *dst, int dstX, int count, const uchar *src0, const uchar *src1, int srcX)
+{
+	const quint64 evenBits = 0xAAAAAAAAAAAAAAAAull;
+	const quint64 oddBits = 0x5555555555555555ull;
+
+	for (int done = 0; done < count; done += 32) {
+		int n = std::min(32, count - done);
+		auto a = readBits(src0, srcX + 2 * done, 2 * n);
+		auto b = readBits(src1, srcX + 2 * done, 2 * n);
+
+		// the 4 bits of each 2x2 block, each in the lower bit of its pair
+		auto x1 = (a & evenBits) >> 1;
+		auto x2 = a & oddBits;
+		auto x3 = (b & evenBits) >> 1;
+		auto x4 = b & oddBits;
+
+		// 2 or more of 4 bits are set
+		auto r = ((x1 | x2) & (x3 | x4)) | (x1 & x2) | (x3 & x4);
+
+		// pack the lower bits of the pairs
+		r = (r | (r >> 1)) & 0x3333333333333333ull;
+		r = (r | (r >> 2)) & 0x0F0F0F0F0F0F0F0Full;
+		r = (r | (r >> 4)) & 0x00FF00FF00FF00FFull;
+		r = (r | (r >> 8)) & 0x0000FFFF0000FFFFull;
+		r = (r | (r >> 16)) & 0x00000000FFFFFFFFull;
+
+		writeBits(dst, dstX + done, n, r << 32);
+	}
+}
 
 } // namespace PaintField
@@ -157,13 +157,35 @@ public:
 	SelectionImage() = default;
 	SelectionImage(const QSize &size);
 
+	enum Operation
+	{
+		OperationUnion,
+		OperationIntersect,
+		OperationSubtract,
+		OperationXor
+	};
+
 	void fill(bool x);
+
+	/**
+	 * Copies the bits of "other" to "pos" (shifted a word at a time).
+	 */
 	void paste(const SelectionImage &other, const QPoint &pos);
 
+	/**
+	 * Combines "other" (which must be the same size) into this image, a word at a time.
+	 */
+	void combine(const SelectionImage &other, Operation op);
+
 	QSize size() const { return mImage.size(); }
 
 	bool isBlank() const;
 
+	/**
+	 * @return The number of selected pixels
+	 */
+	int selectedCount() const;
+
 	iterator scanline(int y)
 	{
 		return iterator(mImage, y);
@@ -188,6 +210,12 @@ private:
 
 using SelectionSurface = Malachite::GenericSurface<SelectionImage, detail::SelectionTileTraits>;
 
+/**
+ * Combines 2 selection surfaces tile by tile.
+ * Tiles present in only one of them are shared, not copied.
+ */
+SelectionSurface combineSelectionSurfaces(const SelectionSurface &a, const SelectionSurface &b, SelectionImage::Operation op);
+
 struct SelectionMipmapPixelTraits
 {
 	static bool average(const std::array<bool, 4> &pixels)
@@ -200,6 +228,36 @@ struct SelectionMipmapPixelTraits
 	}
 };
 
+/**
+ * Downsamples 2 rows of a selection tile into one, 64 bits at a time.
+ * A result bit is set when 2 or more of its 4 source bits are set (same as SelectionMipmapPixelTraits).
+ * @param dst The destination row
+ * @param dstX The first pixel to write in "dst"
+ * @param count The number of pixels to write
+ * @param srcX The pixel in the source rows that is downsampled into dstX
+ */
+void downsampleSelectionRows(uchar *dst, int dstX, int count, const uchar *src0, const uchar *src1, int srcX);
+
 using SelectionMipmap = Malachite::SurfaceMipmap<SelectionSurface, SelectionMipmapPixelTraits>;
 
 } // namespace PaintField
+
+namespace Malachite {
+
+template <>
+struct MipmapTileDownsampler<PaintField::SelectionImage, PaintField::SelectionMipmapPixelTraits>
+{
+	static void downsample(PaintField::SelectionImage &dst, const QPoint &dstTopLeft, const PaintField::SelectionImage &src, const QPoint &srcTopLeft, const QSize &size)
+	{
+		auto &dstImage = dst.qimage();
+		const auto &srcImage = src.qimage();
+
+		for (int y = 0; y < size.height(); ++y) {
+			PaintField::downsampleSelectionRows(
+				dstImage.scanLine(dstTopLeft.y() + y), dstTopLeft.x(), size.width(),
+				srcImage.constScanLine(srcTopLeft.y() + 2 * y), srcImage.constScanLine(srcTopLeft.y() + 2 * y + 1), srcTopLeft.x());
+		}
+	}
+};
+
+} // namespace Malachite
@@ -274,16 +274,55 @@ void ShapeLayer::setCapStyleString(const QString &string)
 
 void ShapeLayer::render(Malachite::Painter *painter) const
 {
+	// the cache is in document coordinates, so transformed painters (eg thumbnails) draw the paths themselves
+	if (!painter->shapeTransform().isIdentity())
+	{
+		drawShape(painter);
+		return;
+	}
+	
+	auto keys = tileKeys();
+	
+	// only the tiles being rendered (eg the updated tiles while a shape is dragged) are rasterized
 	auto surfacePainter = dynamic_cast<SurfacePainter *>(painter);
-	if (surfacePainter)
+	if (surfacePainter && !surfacePainter->keyClip().isEmpty())
+	{
+		keys &= surfacePainter->keyClip();
+		if (keys.isEmpty())
+			return;
+	}
+	
+	painter->drawPreTransformedSurface(QPoint(), rasterizedSurface(keys));
+}
+
+Surface ShapeLayer::rasterizedSurface(const QPointSet &keys) const
+{
+	QMutexLocker locker(&_rasterCacheMutex);
+	
+	auto missingKeys = (keys.isEmpty() ? tileKeys() : keys & tileKeys()) - _rasterizedKeys;
+	
+	if (!missingKeys.isEmpty())
 	{
-		if (!surfacePainter->keyClip().isEmpty())
+		Surface surface;
+		
 		{
-			if ((tileKeys() & surfacePainter->keyClip()).isEmpty())
-				return;
+			SurfacePainter painter(&surface);
+			painter.setKeyClip(missingKeys);
+			drawShape(&painter);
 		}
+		
+		for (const QPoint &key : surface.keys())
+			_rasterCache.setTile(key, surface.tile(key));
+		_rasterizedKeys |= missingKeys;
 	}
 	
+	return _rasterCache;
+}
+
+void ShapeLayer::drawShape(Painter *painter) const
+{
+	painter->pushState();
+	
 	if (_fillEnabled)
 	{
 		painter->setBrush(_fillBrush);
@@ -295,6 +334,15 @@ void ShapeLayer::render(Malachite::Painter *painter) const
 		painter->setBrush(_strokeBrush);
 		painter->drawPath(strokePath());
 	}
+	
+	painter->popState();
+}
+
+void ShapeLayer::invalidateRasterCache()
+{
+	QMutexLocker locker(&_rasterCacheMutex);
+	_rasterCache = Surface();
+	_rasterizedKeys.clear();
 }
 
 void ShapeLayer::updatePaths()
@@ -332,6 +380,7 @@ void ShapeLayer::updatePaths()
 		_unitedPath = _fillPath | _strokePath;
 	
 	setThumbnailDirty(true);
+	invalidateRasterCache();
 }
 
 void ShapeLayer::setFillPath(const QPainterPath &path)
@@ -1,6 +1,8 @@
 #pragma once
 #include <Malachite/Color>
 #include <Malachite/Brush>
+#include <Malachite/Surface>
+#include <QMutex>
 #include "layer.h"
 
 namespace Malachite
@@ -61,16 +63,16 @@ public:
 	void setCapStyleString(const QString &string);
 	
 	bool isFillEnabled() const { return _fillEnabled; }
-	void setFillEnabled(bool enabled) { _fillEnabled = enabled; setThumbnailDirty(true); }
+	void setFillEnabled(bool enabled) { _fillEnabled = enabled; setThumbnailDirty(true); invalidateRasterCache(); }
 	
 	Malachite::Brush fillBrush() const { return _fillBrush; }
-	void setFillBrush(const Malachite::Brush &brush) { _fillBrush = brush; setThumbnailDirty(true); }
+	void setFillBrush(const Malachite::Brush &brush) { _fillBrush = brush; setThumbnailDirty(true); invalidateRasterCache(); }
 	
 	bool isStrokeEnabled() const { return _strokeEnabled; }
-	void setStrokeEnabled(bool enabled) { _strokeEnabled = enabled; setThumbnailDirty(true); }
+	void setStrokeEnabled(bool enabled) { _strokeEnabled = enabled; setThumbnailDirty(true); invalidateRasterCache(); }
 	
 	Malachite::Brush strokeBrush() const { return _strokeBrush; }
-	void setStrokeBrush(const Malachite::Brush &brush) { _strokeBrush = brush; setThumbnailDirty(true); }
+	void setStrokeBrush(const Malachite::Brush &brush) { _strokeBrush = brush; setThumbnailDirty(true); invalidateRasterCache(); }
 	
 	void render(Malachite::Painter *painter) const override;
 	
@@ -80,6 +82,12 @@ public:
 	
 	QRectF boundingRect() const;
 	
+	/**
+	 * @return The fill and the stroke rasterized into a surface (at least in the tiles of "keys", or all tiles if empty).
+	 * Tiles are rasterized when first requested, and cached until the paths or the brushes change.
+	 */
+	Malachite::Surface rasterizedSurface(const QPointSet &keys = QPointSet()) const;
+	
 protected:
 	
 	void setFillPath(const QPainterPath &path);
@@ -87,6 +95,8 @@ protected:
 private:
 	
 	void updatePaths();
+	void invalidateRasterCache();
+	void drawShape(Malachite::Painter *painter) const;
 	
 	StrokePosition _strokePos = StrokePositionCenter;
 	double _strokeWidth = 1.0;
@@ -97,6 +107,11 @@ private:
 	Malachite::Brush _fillBrush, _strokeBrush;
 	
 	QPainterPath _fillPath, _strokePath, _unitedPath;
+	
+	// layers can be rendered from several threads at once
+	mutable QMutex _rasterCacheMutex;
+	mutable Malachite::Surface _rasterCache;
+	mutable QPointSet _rasterizedKeys;
 };
 
 } // namespace PaintField
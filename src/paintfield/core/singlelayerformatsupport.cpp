@@ -28,6 +28,15 @@ bool SingleLayerFormatSupport::read(QIODevice *device, QList<LayerRef> *layers,
 bool SingleLayerFormatSupport::write(QIODevice *device, const QList<LayerConstRef> &layers, const QSize &size, const QVariant &option)
 {
 	LayerRenderer renderer;
+	
+	if (supportsBandedWriting())
+	{
+		auto renderBand = [&](const QRect &rect) {
+			return renderer.renderToSurface(layers, Malachite::Surface::rectToKeys(rect));
+		};
+		return writeSingleLayerBanded(device, renderBand, size, option);
+	}
+	
 	auto surface = renderer.renderToSurface(layers, Malachite::Surface::rectToKeys(QRect(QPoint(), size)));
 	return writeSingleLayer(device, surface, size, option);
 }
@@ -49,4 +58,13 @@ bool SingleLayerFormatSupport::writeSingleLayer(QIODevice *device, const Malachi
 	return false;
 }
 
+bool SingleLayerFormatSupport::writeSingleLayerBanded(QIODevice *device, const std::function<Malachite::Surface (const QRect &)> &renderBand, const QSize &size, const QVariant &option)
+{
+	Q_UNUSED(device);
+	Q_UNUSED(renderBand);
+	Q_UNUSED(size);
+	Q_UNUSED(option);
+	return false;
+}
+
 } // namespace PaintField
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include "formatsupport.h"
 
 namespace PaintField {
@@ -16,6 +17,18 @@ public:
 	virtual bool readSingleLayer(QIODevice *device, Malachite::Surface *surface, QSize *size);
 	virtual bool writeSingleLayer(QIODevice *device, const Malachite::Surface &surface, const QSize &size, const QVariant &option);
 	
+	/**
+	 * Returns whether writeSingleLayerBanded can be used instead of writeSingleLayer.
+	 * Banded writing renders the layers one band at a time, so the whole flattened image never exists in memory.
+	 */
+	virtual bool supportsBandedWriting() const { return false; }
+	
+	/**
+	 * Writes the flattened image band by band from top to bottom.
+	 * @param renderBand Renders the layers in the given rect of the image
+	 */
+	virtual bool writeSingleLayerBanded(QIODevice *device, const std::function<Malachite::Surface (const QRect &)> &renderBand, const QSize &size, const QVariant &option);
+	
 signals:
 	
 public slots:
@@ -0,0 +1,360 @@
+#include <QtConcurrent>
+#include <cmath>
+#include <vector>
+
+#include "softselection.h"
+
+using namespace Malachite;
+
+namespace PaintField {
+
+namespace {
+
+constexpr int tileWidth = CoverageSurface::tileWidth();
+constexpr float infinity = 1e20f;
+
+inline bool isSelected(uint8_t coverage)
+{
+	return coverage >= 128;
+}
+
+inline uint8_t toCoverage(float value)
+{
+	return uint8_t(qBound(0.f, value, 1.f) * 255.f + 0.5f);
+}
+
+QPointSet dilatedKeys(const QPointSet &keys, int margin)
+{
+	QPointSet result;
+	for (const QPoint &key : keys)
+		result |= CoverageSurface::rectToKeys(CoverageSurface::keyToRect(key).adjusted(-margin, -margin, margin, margin));
+	return result;
+}
+
+/**
+ * Computes the tiles of "keys" in parallel.
+ * @param computeTile A function that takes the key and returns the tile (or an invalid image for no tile)
+ */
+template <class TFunction>
+CoverageSurface computeTiles(const QPointSet &keys, TFunction computeTile)
+{
+	struct TileJob
+	{
+		QPoint key;
+		CoverageImage tile;
+	};
+
+	QVector<TileJob> jobs;
+	jobs.reserve(keys.size());
+	for (const QPoint &key : keys)
+		jobs << TileJob { key, CoverageImage() };
+
+	QtConcurrent::blockingMap(jobs, [&](TileJob &job) {
+		job.tile = computeTile(job.key);
+	});
+
+	CoverageSurface result;
+	for (const auto &job : jobs) {
+		if (job.tile.isValid() && !job.tile.isBlank())
+			result.setTile(job.key, job.tile);
+	}
+	return result;
+}
+
+/**
+ * A square float buffer of a tile and its neighborhood.
+ */
+class Neighborhood
+{
+public:
+
+	Neighborhood(const CoverageSurface &coverage, const QPoint &key, int margin) :
+		mMargin(margin),
+		mSize(tileWidth + 2 * margin)
+	{
+		mCrop = coverage.crop(CoverageSurface::keyToRect(key).adjusted(-margin, -margin, margin, margin));
+	}
+
+	/**
+	 * Allocates the float buffer (not needed for uniform neighborhoods).
+	 */
+	void allocateValues() { mValues.resize(mSize * mSize); }
+
+	int size() const { return mSize; }
+	int margin() const { return mMargin; }
+
+	const CoverageImage &crop() const { return mCrop; }
+
+	float &value(int x, int y) { return mValues[y * mSize + x]; }
+
+	uint8_t coverage(int x, int y) const { return *mCrop.constPixelPointer(x, y); }
+
+	/**
+	 * @return The original coverage of a pixel in the center tile
+	 */
+	uint8_t centerCoverage(int x, int y) const { return coverage(x + mMargin, y + mMargin); }
+
+private:
+
+	int mMargin, mSize;
+	std::vector<float> mValues;
+	CoverageImage mCrop;
+};
+
+/**
+ * Box blur with zeros outside.
+ */
+void boxBlurLine(const float *src, float *dst, int count, int radius)
+{
+	float scale = 1.f / (2 * radius + 1);
+	float sum = 0;
+
+	for (int i = 0; i < std::min(radius, count); ++i)
+		sum += src[i];
+
+	for (int i = 0; i < count; ++i) {
+		if (i + radius < count)
+			sum += src[i + radius];
+		if (i - radius - 1 >= 0)
+			sum -= src[i - radius - 1];
+		dst[i] = sum * scale;
+	}
+}
+
+void gaussianBlurLine(float *line, float *temp, int count, int radius)
+{
+	boxBlurLine(line, temp, count, radius);
+	boxBlurLine(temp, line, count, radius);
+	boxBlurLine(line, temp, count, radius);
+	std::copy(temp, temp + count, line);
+}
+
+/**
+ * 1D squared euclidean distance transform (Felzenszwalb & Huttenlocher).
+ * @param f The input (0 for feature pixels, infinity for others)
+ * @param d The output squared distances
+ */
+void distanceTransformLine(const float *f, float *d, int count, int *v, float *z)
+{
+	int k = 0;
+	v[0] = 0;
+	z[0] = -infinity;
+	z[1] = infinity;
+
+	auto intersection = [&](int q, int p) {
+		return ((f[q] + q * q) - (f[p] + p * p)) / (2 * q - 2 * p);
+	};
+
+	for (int q = 1; q < count; ++q) {
+		// z[0] is lower than any intersection, so this stops at k == 0
+		float s = intersection(q, v[k]);
+		while (s <= z[k]) {
+			--k;
+			s = intersection(q, v[k]);
+		}
+		++k;
+		v[k] = q;
+		z[k] = s;
+		z[k + 1] = infinity;
+	}
+
+	k = 0;
+	for (int q = 0; q < count; ++q) {
+		while (z[k + 1] < q)
+			++k;
+		int p = v[k];
+		d[q] = (q - p) * (q - p) + f[p];
+	}
+}
+
+/**
+ * Computes the euclidean distances from the feature pixels in place.
+ */
+void distanceTransform(Neighborhood &neighborhood)
+{
+	int size = neighborhood.size();
+	std::vector<float> f(size), d(size), z(size + 1);
+	std::vector<int> v(size);
+
+	for (int x = 0; x < size; ++x) {
+		for (int y = 0; y < size; ++y)
+			f[y] = neighborhood.value(x, y);
+		distanceTransformLine(f.data(), d.data(), size, v.data(), z.data());
+		for (int y = 0; y < size; ++y)
+			neighborhood.value(x, y) = d[y];
+	}
+
+	for (int y = neighborhood.margin(); y < neighborhood.margin() + tileWidth; ++y) {
+		float *row = &neighborhood.value(0, y);
+		std::copy(row, row + size, f.begin());
+		distanceTransformLine(f.data(), row, size, v.data(), z.data());
+	}
+}
+
+/**
+ * @param grow Whether to grow (measure distances from selected pixels) or shrink (from unselected pixels)
+ */
+CoverageImage growOrShrinkTile(const CoverageSurface &coverage, const QPoint &key, double distance, bool grow)
+{
+	Neighborhood neighborhood(coverage, key, int(std::ceil(distance)) + 1);
+	const auto &crop = neighborhood.crop();
+
+	if (crop.isBlank())
+		return CoverageImage();
+	if (crop.isFull())
+		return coverage.tile(key);
+
+	neighborhood.allocateValues();
+	int size = neighborhood.size();
+	bool hasFeature = false;
+
+	for (int y = 0; y < size; ++y) {
+		for (int x = 0; x < size; ++x) {
+			bool feature = isSelected(neighborhood.coverage(x, y)) == grow;
+			hasFeature |= feature;
+			neighborhood.value(x, y) = feature ? 0.f : infinity;
+		}
+	}
+
+	if (!hasFeature)
+		return grow ? CoverageImage() : coverage.tile(key);
+
+	distanceTransform(neighborhood);
+
+	CoverageImage result(CoverageSurface::tileSize());
+	int margin = neighborhood.margin();
+
+	for (int y = 0; y < tileWidth; ++y) {
+		auto dst = (uint8_t *)result.pixelPointer(0, y);
+		for (int x = 0; x < tileWidth; ++x) {
+			float d = std::sqrt(neighborhood.value(x + margin, y + margin));
+			auto original = neighborhood.centerCoverage(x, y);
+			if (grow)
+				dst[x] = std::max(original, toCoverage(distance - d + 1));
+			else
+				dst[x] = std::min(original, toCoverage(d - distance));
+		}
+	}
+
+	return result;
+}
+
+} // anonymous namespace
+
+CoverageSurface coverageFromSelection(const SelectionSurface &selection)
+{
+	CoverageSurface result;
+
+	for (auto iter = selection.begin(); iter != selection.end(); ++iter) {
+		if (iter.value().isBlank())
+			continue;
+
+		CoverageImage tile(CoverageSurface::tileSize());
+		const auto &bits = iter.value().qimage();
+
+		for (int y = 0; y < tileWidth; ++y) {
+			auto src = bits.constScanLine(y);
+			auto dst = (uint8_t *)tile.pixelPointer(0, y);
+			for (int x = 0; x < tileWidth; ++x)
+				dst[x] = (src[x / 8] & (0x80 >> (x % 8))) ? 255 : 0;
+		}
+
+		result.setTile(iter.key(), tile);
+	}
+
+	return result;
+}
+
+SelectionSurface selectionFromCoverage(const CoverageSurface &coverage, int threshold)
+{
+	SelectionSurface result;
+
+	for (auto iter = coverage.begin(); iter != coverage.end(); ++iter) {
+		SelectionImage tile(SelectionSurface::tileSize());
+		auto &bits = tile.qimage();
+
+		for (int y = 0; y < tileWidth; ++y) {
+			auto src = (const uint8_t *)iter.value().constPixelPointer(0, y);
+			auto dst = bits.scanLine(y);
+			for (int i = 0; i < tileWidth / 8; ++i) {
+				uchar byte = 0;
+				for (int j = 0; j < 8; ++j)
+					byte |= (src[i * 8 + j] >= threshold) << (7 - j);
+				dst[i] = byte;
+			}
+		}
+
+		if (!tile.isBlank())
+			result.setTile(iter.key(), tile);
+	}
+
+	return result;
+}
+
+CoverageSurface featherCoverage(const CoverageSurface &coverage, double radius)
+{
+	if (radius <= 0)
+		return coverage;
+
+	// 3 box blurs of width w have the variance of (w^2 - 1) / 4
+	int boxRadius = std::max(1, int(std::round((std::sqrt(4 * radius * radius + 1) - 1) / 2)));
+	int margin = 3 * boxRadius;
+
+	return computeTiles(dilatedKeys(coverage.keys(), margin), [&](const QPoint &key) -> CoverageImage {
+
+		Neighborhood neighborhood(coverage, key, margin);
+		const auto &crop = neighborhood.crop();
+
+		if (crop.isBlank())
+			return CoverageImage();
+		if (crop.isFull())
+			return coverage.tile(key);
+
+		neighborhood.allocateValues();
+		int size = neighborhood.size();
+		std::vector<float> line(size), temp(size);
+
+		for (int y = 0; y < size; ++y) {
+			auto src = (const uint8_t *)crop.constPixelPointer(0, y);
+			float *row = &neighborhood.value(0, y);
+			for (int x = 0; x < size; ++x)
+				row[x] = src[x] * (1.f / 255.f);
+			gaussianBlurLine(row, temp.data(), size, boxRadius);
+		}
+
+		CoverageImage result(CoverageSurface::tileSize());
+
+		// only the columns of the center tile are needed
+		for (int x = 0; x < tileWidth; ++x) {
+			for (int y = 0; y < size; ++y)
+				line[y] = neighborhood.value(x + margin, y);
+			gaussianBlurLine(line.data(), temp.data(), size, boxRadius);
+			for (int y = 0; y < tileWidth; ++y)
+				*result.pixelPointer(x, y) = toCoverage(line[y + margin]);
+		}
+
+		return result;
+	});
+}
+
+CoverageSurface growCoverage(const CoverageSurface &coverage, double distance)
+{
+	if (distance <= 0)
+		return coverage;
+
+	return computeTiles(dilatedKeys(coverage.keys(), int(std::ceil(distance))), [&](const QPoint &key) {
+		return growOrShrinkTile(coverage, key, distance, true);
+	});
+}
+
+CoverageSurface shrinkCoverage(const CoverageSurface &coverage, double distance)
+{
+	if (distance <= 0)
+		return coverage;
+
+	return computeTiles(coverage.keys(), [&](const QPoint &key) {
+		return growOrShrinkTile(coverage, key, distance, false);
+	});
+}
+
+} // namespace PaintField
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <Malachite/Coverage>
+#include "selectionsurface.h"
+
+namespace PaintField {
+
+/**
+ * Converts a binary selection into coverage (0 or 255).
+ */
+Malachite::CoverageSurface coverageFromSelection(const SelectionSurface &selection);
+
+/**
+ * Converts coverage into a binary selection.
+ * @param threshold Pixels with coverage >= threshold are selected
+ */
+SelectionSurface selectionFromCoverage(const Malachite::CoverageSurface &coverage, int threshold = 128);
+
+/**
+ * Blurs the edges of coverage with a gaussian (approximated by 3 separable box blurs).
+ * Each tile is computed in parallel from its neighborhood.
+ * @param radius The standard deviation of the gaussian
+ */
+Malachite::CoverageSurface featherCoverage(const Malachite::CoverageSurface &coverage, double radius);
+
+/**
+ * Expands coverage by "distance" pixels with an anti-aliased edge.
+ * Distances are computed with an exact euclidean distance transform on each tile neighborhood, in parallel.
+ */
+Malachite::CoverageSurface growCoverage(const Malachite::CoverageSurface &coverage, double distance);
+
+/**
+ * Contracts coverage by "distance" pixels with an anti-aliased edge.
+ */
+Malachite::CoverageSurface shrinkCoverage(const Malachite::CoverageSurface &coverage, double distance);
+
+} // namespace PaintField
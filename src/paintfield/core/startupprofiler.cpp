@@ -0,0 +1,126 @@
+#include <QDebug>
+
+#include "startupprofiler.h"
+
+namespace PaintField {
+
+namespace {
+
+struct Step
+{
+	QString name;
+	int depth = 0;
+	qint64 start = 0;
+	qint64 duration = -1;
+	bool deferred = false;
+};
+
+} // anonymous namespace
+
+struct StartupProfiler::Data
+{
+	QElapsedTimer timer;
+	QList<Step> steps;
+	int depth = 0;
+	qint64 readyTime = -1;
+};
+
+StartupProfiler::Scope::Scope(StartupProfiler *profiler, const QString &name) :
+	mProfiler(profiler),
+	mIndex(profiler ? profiler->begin(name) : -1)
+{
+}
+
+StartupProfiler::Scope::~Scope()
+{
+	if (mProfiler)
+		mProfiler->end(mIndex);
+}
+
+StartupProfiler::StartupProfiler(QObject *parent) :
+	QObject(parent),
+	d(new Data)
+{
+	d->timer.start();
+}
+
+StartupProfiler::~StartupProfiler()
+{
+}
+
+qint64 StartupProfiler::elapsed() const
+{
+	return d->timer.elapsed();
+}
+
+void StartupProfiler::markReady()
+{
+	if (isReady())
+		return;
+
+	d->readyTime = elapsed();
+
+	if (qEnvironmentVariableIsSet("PAINTFIELD_STARTUP_PROFILE"))
+		printReport();
+}
+
+bool StartupProfiler::isReady() const
+{
+	return d->readyTime >= 0;
+}
+
+QVariantMap StartupProfiler::report() const
+{
+	QVariantList steps;
+
+	for (const auto &step : d->steps)
+	{
+		QVariantMap map;
+		map["name"] = step.name;
+		map["depth"] = step.depth;
+		map["start"] = step.start;
+		map["duration"] = step.duration;
+		map["deferred"] = step.deferred;
+		steps << map;
+	}
+
+	QVariantMap result;
+	result["ready"] = d->readyTime;
+	result["steps"] = steps;
+	return result;
+}
+
+void StartupProfiler::printReport() const
+{
+	qDebug() << "startup: ready in" << d->readyTime << "ms";
+
+	for (const auto &step : d->steps)
+	{
+		auto indent = QString(2 * (step.depth + 1), ' ');
+		qDebug().nospace() << qPrintable(indent) << qPrintable(step.name) << ": " << step.duration << " ms" << (step.deferred ? " (deferred)" : "");
+	}
+}
+
+int StartupProfiler::begin(const QString &name)
+{
+	Step step;
+	step.name = name;
+	step.depth = d->depth++;
+	step.start = elapsed();
+	step.deferred = isReady();
+	d->steps << step;
+	return d->steps.size() - 1;
+}
+
+void StartupProfiler::end(int index)
+{
+	--d->depth;
+	auto &step = d->steps[index];
+	step.duration = elapsed() - step.start;
+
+	// lazy initializations are reported as they happen
+	if (step.deferred && step.depth == 0 && qEnvironmentVariableIsSet("PAINTFIELD_STARTUP_PROFILE"))
+		qDebug() << "startup:" << step.name << "took" << step.duration << "ms (deferred)";
+}
+
+} // namespace PaintField
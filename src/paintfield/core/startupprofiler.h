@@ -0,0 +1,73 @@
+#pragma once
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QVariant>
+
+namespace PaintField {
+
+/**
+ * The StartupProfiler records how long each step of the application startup takes.
+ *
+ * Steps are timed with Scope objects and may be nested.
+ * Steps that run after the event loop has started (lazy initialization of extensions) are recorded as deferred.
+ * The report is printed when the application is ready if the PAINTFIELD_STARTUP_PROFILE environment variable is set.
+ */
+class StartupProfiler : public QObject
+{
+	Q_OBJECT
+public:
+
+	/**
+	 * Times a step from its construction to its destruction.
+	 */
+	class Scope
+	{
+	public:
+
+		/**
+		 * @param profiler The profiler to record the step in (may be 0)
+		 */
+		Scope(StartupProfiler *profiler, const QString &name);
+		~Scope();
+
+	private:
+
+		StartupProfiler *mProfiler;
+		int mIndex;
+	};
+
+	explicit StartupProfiler(QObject *parent = 0);
+	~StartupProfiler();
+
+	/**
+	 * @return The milliseconds since the profiler was created
+	 */
+	qint64 elapsed() const;
+
+	bool isReady() const;
+
+	/**
+	 * @return The time to ready and each step (for logging and instrumentation)
+	 */
+	QVariantMap report() const;
+
+	void printReport() const;
+
+public slots:
+
+	/**
+	 * Records the time the application became ready to use.
+	 */
+	void markReady();
+
+private:
+
+	int begin(const QString &name);
+	void end(int index);
+
+	struct Data;
+	QScopedPointer<Data> d;
+};
+
+} // namespace PaintField
@@ -0,0 +1,123 @@
+#include "tiledirtymap.h"
+
+using namespace Malachite;
+
+namespace PaintField {
+
+void TileDirtyMap::setSceneSize(const QSize &size)
+{
+	constexpr auto tileWidth = Surface::tileWidth();
+
+	mKeyCountX = size.isEmpty() ? 0 : (size.width() - 1) / tileWidth + 1;
+	mKeyCountY = size.isEmpty() ? 0 : (size.height() - 1) / tileWidth + 1;
+
+	auto count = mKeyCountX * mKeyCountY;
+
+	mCells.reset(new std::atomic<uint32_t>[count]);
+	for (int i = 0; i < count; ++i)
+		mCells[i].store(0, std::memory_order_relaxed);
+
+	mDirtyRows.reset(new std::atomic<bool>[mKeyCountY]);
+	for (int i = 0; i < mKeyCountY; ++i)
+		mDirtyRows[i].store(false, std::memory_order_relaxed);
+
+	mAnyDirty.store(false, std::memory_order_release);
+}
+
+void TileDirtyMap::markTile(const QPoint &key)
+{
+	mark(key, encode(QRect(QPoint(), Surface::tileSize())));
+}
+
+void TileDirtyMap::markRect(const QPoint &key, const QRect &rect)
+{
+	auto clipped = rect & QRect(QPoint(), Surface::tileSize());
+	if (clipped.isEmpty())
+		return;
+	mark(key, encode(clipped));
+}
+
+void TileDirtyMap::markTiles(const QPointSet &keys)
+{
+	for (const auto &key : keys)
+		markTile(key);
+}
+
+void TileDirtyMap::markRects(const QHash<QPoint, QRect> &rects)
+{
+	for (auto iter = rects.begin(); iter != rects.end(); ++iter)
+		markRect(iter.key(), iter.value());
+}
+
+QHash<QPoint, QRect> TileDirtyMap::take()
+{
+	QHash<QPoint, QRect> result;
+
+	if (!mAnyDirty.exchange(false, std::memory_order_acq_rel))
+		return result;
+
+	for (int y = 0; y < mKeyCountY; ++y) {
+		if (!mDirtyRows[y].exchange(false, std::memory_order_acq_rel))
+			continue;
+
+		auto row = mCells.get() + y * mKeyCountX;
+		for (int x = 0; x < mKeyCountX; ++x) {
+			if (!row[x].load(std::memory_order_relaxed))
+				continue;
+			auto cell = row[x].exchange(0, std::memory_order_acq_rel);
+			if (cell)
+				result.insert(QPoint(x, y), decode(cell));
+		}
+	}
+
+	return result;
+}
+
+uint32_t TileDirtyMap::encode(const QRect &rect)
+{
+	return dirtyBit
+		| uint32_t(rect.left())
+		| uint32_t(rect.top()) << 8
+		| uint32_t(rect.right()) << 16
+		| uint32_t(rect.bottom()) << 24;
+}
+
+QRect TileDirtyMap::decode(uint32_t cell)
+{
+	QRect rect;
+	rect.setCoords(cell & 0xFF, (cell >> 8) & 0xFF, (cell >> 16) & 0xFF, (cell >> 24) & 0x7F);
+	return rect;
+}
+
+uint32_t TileDirtyMap::unite(uint32_t a, uint32_t b)
+{
+	if (!a)
+		return b;
+	if (!b)
+		return a;
+
+	auto ra = decode(a), rb = decode(b);
+	QRect rect;
+	rect.setCoords(std::min(ra.left(), rb.left()), std::min(ra.top(), rb.top()),
+	               std::max(ra.right(), rb.right()), std::max(ra.bottom(), rb.bottom()));
+	return encode(rect);
+}
+
+void TileDirtyMap::mark(const QPoint &key, uint32_t cell)
+{
+	if (key.x() < 0 || key.y() < 0 || key.x() >= mKeyCountX || key.y() >= mKeyCountY)
+		return;
+
+	auto &target = mCells[key.y() * mKeyCountX + key.x()];
+
+	auto old = target.load(std::memory_order_relaxed);
+	while (!target.compare_exchange_weak(old, unite(old, cell), std::memory_order_acq_rel))
+	{
+	}
+
+	// publish in the order cell -> row -> any, so that take() never misses a cell
+	mDirtyRows[key.y()].store(true, std::memory_order_release);
+	mAnyDirty.store(true, std::memory_order_release);
+}
+
+} // namespace PaintField
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <Malachite/Surface>
+#include <atomic>
+#include <memory>
+
+namespace PaintField {
+
+/**
+ * The TileDirtyMap accumulates dirty tiles (and the dirty region inside each tile) without locks.
+ * Marking is safe from any thread; take() must be called from a single consumer thread.
+ * setSceneSize() reallocates the grid and must not race with other calls.
+ */
+class TileDirtyMap
+{
+public:
+
+	TileDirtyMap() {}
+
+	void setSceneSize(const QSize &size);
+	QSize keyCount() const { return QSize(mKeyCountX, mKeyCountY); }
+
+	/**
+	 * Marks a whole tile dirty.
+	 * Keys outside the scene are ignored.
+	 */
+	void markTile(const QPoint &key);
+
+	/**
+	 * Marks a region of a tile dirty.
+	 * @param key The tile key
+	 * @param rect The region relative to the tile
+	 */
+	void markRect(const QPoint &key, const QRect &rect);
+
+	void markTiles(const QPointSet &keys);
+	void markRects(const QHash<QPoint, QRect> &rects);
+
+	/**
+	 * @return Whether a tile may be dirty (cheap hint, may be stale)
+	 */
+	bool mayHaveDirtyTiles() const { return mAnyDirty.load(std::memory_order_acquire); }
+
+	/**
+	 * Takes all dirty tiles and clears them.
+	 * @return Dirty regions for each tile key (relative to the tile)
+	 */
+	QHash<QPoint, QRect> take();
+
+private:
+
+	// cell layout: bit 31 = dirty, bits 0-7 = left, 8-15 = top, 16-23 = right, 24-30 = bottom
+	static constexpr uint32_t dirtyBit = 1u << 31;
+
+	static_assert(Malachite::Surface::tileWidth() <= 128, "tile width must fit in 7 bits");
+
+	static uint32_t encode(const QRect &rect);
+	static QRect decode(uint32_t cell);
+	static uint32_t unite(uint32_t a, uint32_t b);
+
+	void mark(const QPoint &key, uint32_t cell);
+
+	int mKeyCountX = 0, mKeyCountY = 0;
+	std::unique_ptr<std::atomic<uint32_t>[]> mCells;
+	std::unique_ptr<std::atomic<bool>[]> mDirtyRows;
+	std::atomic<bool> mAnyDirty { false };
+};
+
+} // namespace PaintField
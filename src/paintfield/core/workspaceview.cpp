@@ -10,6 +10,7 @@
 #include "workspace.h"
 #include "appcontroller.h"
 #include "settingsmanager.h"
+#include "extension.h"
 
 #include "workspaceview.h"
 
@@ -160,6 +161,8 @@ SideBarFrame::SideBarFrame(QWidget *parent) :
 
 void SideBarFrame::setSideBar(QWidget *sideBar)
 {
+	_getSideBar = nullptr;
+	
 	if (_sideBar)
 	{
 		_layout->removeWidget(_sideBar);
@@ -168,8 +171,36 @@ void SideBarFrame::setSideBar(QWidget *sideBar)
 	}
 	
 	_sideBar = sideBar;
-	_layout->addWidget(_sideBar);
-	_sideBar->show();
+	
+	if (_sideBar)
+	{
+		_layout->addWidget(_sideBar);
+		_sideBar->show();
+	}
+}
+
+void SideBarFrame::setSideBar(const std::function<QWidget *()> &getSideBar)
+{
+	if (isVisible())
+	{
+		setSideBar(getSideBar());
+		return;
+	}
+	
+	// the current side bar is removed at once, as it may belong to a canvas that is closing
+	setSideBar(static_cast<QWidget *>(0));
+	_getSideBar = getSideBar;
+}
+
+void SideBarFrame::showEvent(QShowEvent *event)
+{
+	QWidget::showEvent(event);
+	
+	if (_getSideBar)
+	{
+		auto getSideBar = _getSideBar;
+		setSideBar(getSideBar());
+	}
 }
 
 struct WorkspaceView::Data
@@ -353,14 +384,24 @@ void WorkspaceView::createMenuBar(const QHash<QString, ActionInfo> &actionInfos,
 	setMenuBar(MenuArranger::createMenuBar(actionInfos, menuInfos, order));
 }
 
-void WorkspaceView::setSidebar(const QString &id, QWidget *sidebar)
+void WorkspaceView::setSidebar(const QString &id, Extension *extension)
 {
-	Util::applyMacSmallSize(sidebar);
+	// side bars are created when they are first shown
+	QPointer<Extension> extensionPointer(extension);
+	auto getSideBar = [extensionPointer, id]() -> QWidget * {
+		if (!extensionPointer)
+			return 0;
+		auto sidebar = extensionPointer->sideBar(id);
+		if (sidebar)
+			Util::applyMacSmallSize(sidebar);
+		return sidebar;
+	};
+	
 	for (SideBarFrame *frame : d->sideBarFrames)
 	{
 		if (frame->objectName() == id)
 		{
-			frame->setSideBar(sidebar);
+			frame->setSideBar(getSideBar);
 			return;
 		}
 	}
@@ -461,9 +502,9 @@ void WorkspaceView::updateWorkspaceItems()
 {
 	for (const QString &name : appController()->settingsManager()->sidebarNames())
 	{
-		QWidget *sidebar = ExtensionUtil::sideBarForWorkspace(appController()->extensions(), workspace()->extensions(), name);
-		if (sidebar)
-			setSidebar(name, sidebar);
+		auto extension = ExtensionUtil::sideBarExtensionForWorkspace(appController()->extensions(), workspace()->extensions(), name);
+		if (extension)
+			setSidebar(name, extension);
 	}
 	
 	for (const QString &name : appController()->settingsManager()->toolbarNames())
@@ -480,9 +521,9 @@ void WorkspaceView::updateWorkspaceItemsForCanvas(Canvas *canvas)
 	
 	for (const QString &name : appController()->settingsManager()->sidebarNames())
 	{
-		QWidget *sidebar = ExtensionUtil::sideBarForCanvas(workspace()->currentCanvasModules(), name);
-		if (sidebar)
-			setSidebar(name, sidebar);
+		auto extension = ExtensionUtil::sideBarExtensionForCanvas(workspace()->currentCanvasModules(), name);
+		if (extension)
+			setSidebar(name, extension);
 	}
 	
 	for (const QString &name : appController()->settingsManager()->toolbarNames())
@@ -6,6 +6,7 @@
 #include <QAction>
 #include <QVBoxLayout>
 #include <QPointer>
+#include <functional>
 
 #include "global.h"
 #include "settingsmanager.h"
@@ -64,13 +65,24 @@ public:
 	
 	void setSideBar(QWidget *sideBar);
 	
+	/**
+	 * Sets the side bar returned by "getSideBar", which is called when the frame is shown (at once if it is visible).
+	 */
+	void setSideBar(const std::function<QWidget *()> &getSideBar);
+	
+protected:
+	
+	void showEvent(QShowEvent *event) override;
+	
 private:
 	
 	QVBoxLayout *_layout = 0;
-	QWidget *_sideBar = 0;
+	QPointer<QWidget> _sideBar;
+	std::function<QWidget *()> _getSideBar;
 };
 
 class Workspace;
+class Extension;
 
 class WorkspaceView : public QMainWindow
 {
@@ -82,7 +94,7 @@ public:
 	void createToolBars(const QHash<QString, ToolBarInfo> &toolBarInfos, const QVariant &order);
 	void createMenuBar(const QHash<QString, ActionInfo> &actionInfos, const QHash<QString, MenuInfo> &menuInfos,  const QVariant &order);
 	
-	void setSidebar(const QString &id, QWidget *sidebar);
+	void setSidebar(const QString &id, Extension *extension);
 	QToolBar *toolBar(const QString &id);
 	void associateMenuBarWithActions(const QList<QAction *> &actions);
 	
@@ -1,12 +1,15 @@
 #include "brushpresetdatabase.h"
 
 
+#include "paintfield/core/appcontroller.h"
 #include "paintfield/core/json.h"
+#include "paintfield/core/startupprofiler.h"
 #include "paintfield/core/util.h"
 #include "brushpresetitem.h"
 
 #include <QStandardItemModel>
 #include <QItemSelectionModel>
+#include <QtConcurrent>
 #include <amulet/int_range.hh>
 
 namespace PaintField
@@ -16,6 +19,9 @@ struct BrushPresetDatabase::Data
 {
 	QStandardItemModel *mModel;
 	QItemSelectionModel *mSelectionModel;
+	
+	QFuture<QVariant> mPendingData;
+	bool mLoaded = true;
 };
 
 BrushPresetDatabase::BrushPresetDatabase(QObject *parent) :
@@ -40,12 +46,40 @@ BrushPresetDatabase::~BrushPresetDatabase()
 }
 
 void BrushPresetDatabase::load(const QString &filePath)
+{
+	ensureLoaded();
+	PAINTFIELD_DEBUG << "loading" << filePath;
+	addItems(Json::readFromFile(filePath));
+}
+
+void BrushPresetDatabase::loadInBackground(const QString &filePath)
+{
+	ensureLoaded();
+	d->mPendingData = QtConcurrent::run(Json::readFromFile, filePath);
+	d->mLoaded = false;
+}
+
+bool BrushPresetDatabase::isLoaded() const
+{
+	return d->mLoaded;
+}
+
+void BrushPresetDatabase::ensureLoaded()
+{
+	if (d->mLoaded)
+		return;
+	d->mLoaded = true;
+
+	StartupProfiler::Scope scope(appController() ? appController()->startupProfiler() : 0, "load brush presets");
+	addItems(d->mPendingData.result());
+	d->mPendingData = QFuture<QVariant>();
+}
+
+void BrushPresetDatabase::addItems(const QVariant &data)
 {
 	QStandardItem *current = nullptr;
 
-	PAINTFIELD_DEBUG << "loading" << filePath;
-	auto variant = Json::readFromFile(filePath);
-	auto items = BrushPresetItem::loadItemTree(variant.toList(), current);
+	auto items = BrushPresetItem::loadItemTree(data.toList(), current);
 	PAINTFIELD_DEBUG << "loaded" << items.count() << "items";
 	d->mModel->invisibleRootItem()->appendRows(items);
 
@@ -62,16 +96,19 @@ void BrushPresetDatabase::save(const QString &filePath) const
 
 QStandardItemModel *BrushPresetDatabase::model()
 {
+	ensureLoaded();
 	return d->mModel;
 }
 
 QItemSelectionModel *BrushPresetDatabase::selectionModel()
 {
+	ensureLoaded();
 	return d->mSelectionModel;
 }
 
 BrushPresetItem *BrushPresetDatabase::currentPreset()
 {
+	ensureLoaded();
 	return dynamic_cast<BrushPresetItem *>(d->mModel->itemFromIndex(d->mSelectionModel->currentIndex()));
 }
 
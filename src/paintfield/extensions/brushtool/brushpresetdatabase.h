@@ -1,6 +1,7 @@
 #pragma once
 
 #include <QObject>
+#include <QVariant>
 
 class QStandardItemModel;
 class QItemSelectionModel;
@@ -19,6 +20,17 @@ public:
 
 	void load(const QString &filePath);
 	void save(const QString &filePath) const;
+	
+	/**
+	 * Starts reading a preset file on a worker thread.
+	 * The presets are added when they are first needed (by model(), selectionModel() or currentPreset()).
+	 */
+	void loadInBackground(const QString &filePath);
+	
+	/**
+	 * @return Whether the presets read by loadInBackground have been added
+	 */
+	bool isLoaded() const;
 
 	QStandardItemModel *model();
 	QItemSelectionModel *selectionModel();
@@ -33,6 +45,9 @@ public slots:
 
 private:
 
+	void ensureLoaded();
+	void addItems(const QVariant &data);
+
 	struct Data;
 	QScopedPointer<Data> d;
 };
@@ -23,6 +23,13 @@ public:
 	void setSmoothed(bool enabled) { _smoothed = enabled; }
 	bool isSmoothed() const { return _smoothed; }
 	
+	/**
+	 * Sets the coverage that the stroke is multiplied by (empty for no mask).
+	 * Tiles missing from a non-empty mask are not painted.
+	 */
+	void setCoverageMask(const Malachite::CoverageSurface &mask) { _coverageMask = mask; }
+	const Malachite::CoverageSurface &coverageMask() const { return _coverageMask; }
+	
 	virtual void loadSettings(const QVariantMap &settings) = 0;
 	
 	void moveTo(const TabletInputData &data);
@@ -66,6 +73,8 @@ private:
 	double _radiusBase = 10;
 	bool _smoothed = false;
 	
+	Malachite::CoverageSurface _coverageMask;
+	
 	Malachite::Polygon _segment;
 };
 
@@ -110,6 +110,13 @@ void BrushStrokerPen::drawShape(const FixedMultiPolygon &shape)
 			
 			QRect dividedBoundingRect = dividedShape.boundingRect().toAlignedRect();
 			
+			CoverageImage mask;
+			if (!coverageMask().isEmpty()) {
+				mask = coverageMask().tile(key, CoverageImage());
+				if (!mask.isValid())
+					continue;
+			}
+			
 			FixedMultiPolygon drawShape = _drawnShapes[key] | dividedShape;
 			_drawnShapes[key] = drawShape;
 			
@@ -117,10 +124,29 @@ void BrushStrokerPen::drawShape(const FixedMultiPolygon &shape)
 			if (!tile.isValid())
 				tile = Surface::createTile();
 			
-			Painter painter(&tile);
-			painter.setPixel(_settings.eraser ? Pixel(1) : pixel());
-			painter.setBlendMode(_settings.eraser ? BlendMode::DestinationOut : BlendMode::SourceOver);
-			painter.drawPreTransformedPolygons(drawShape);
+			if (mask.isValid())
+			{
+				// draw the shape alone and blend it through the mask
+				auto stamp = Surface::createTile();
+				{
+					Painter painter(&stamp);
+					painter.setPixel(_settings.eraser ? Pixel(1) : pixel());
+					painter.drawPreTransformedPolygons(drawShape);
+				}
+				
+				auto op = BlendMode(_settings.eraser ? BlendMode::DestinationOut : BlendMode::SourceOver).op();
+				auto bitmap = tile.bitmap();
+				
+				for (int y = 0; y < Surface::tileWidth(); ++y)
+					op->blend(Surface::tileWidth(), bitmap.pixelPointer(0, y), stamp.constPixelPointer(0, y), (const uint8_t *)mask.constPixelPointer(0, y), 1.f);
+			}
+			else
+			{
+				Painter painter(&tile);
+				painter.setPixel(_settings.eraser ? Pixel(1) : pixel());
+				painter.setBlendMode(_settings.eraser ? BlendMode::DestinationOut : BlendMode::SourceOver);
+				painter.drawPreTransformedPolygons(drawShape);
+			}
 			
 			keysWithRects.insert(key, dividedBoundingRect);
 			
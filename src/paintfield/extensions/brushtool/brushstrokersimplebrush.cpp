@@ -209,6 +209,13 @@ public:
 
 				QPoint key(tileX, tileY);
 
+				CoverageImage mask;
+				if (!stroker->coverageMask().isEmpty()) {
+					mask = stroker->coverageMask().tile(key, CoverageImage());
+					if (!mask.isValid())
+						continue;
+				}
+
 				auto image = stroker->getTile(key, surface);
 
 				auto subRect = QRect(0, 0, tileWidth, tileWidth) & mRect.translated(-tileX * tileWidth, -tileY * tileWidth);
@@ -232,6 +239,7 @@ public:
 					auto yys = ys * ys;
 
 					auto sl = image->pixelPointer(x0, y);
+					auto maskRow = mask.isValid() ? (const uint8_t *)mask.constPixelPointer(x0, y) : nullptr;
 
 					int rem = w;
 
@@ -242,6 +250,13 @@ public:
 
 						auto covers = mSmoother.smooth(rs);
 
+						if (maskRow) {
+							int n = std::min(rem, 4);
+							for (int i = 0; i < n; ++i)
+								covers[i] *= maskRow[i] * (1.f / 255.f);
+							maskRow += n;
+						}
+
 						if (!rem--) break;
 						func(*sl, covers[0]);
 						++sl;
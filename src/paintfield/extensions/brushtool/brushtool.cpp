@@ -4,6 +4,8 @@
 
 #include "paintfield/core/layerscene.h"
 #include "paintfield/core/layeredit.h"
+#include "paintfield/core/document.h"
+#include "paintfield/core/selection.h"
 #include "paintfield/core/canvas.h"
 #include "paintfield/core/workspace.h"
 #include "paintfield/core/palettemanager.h"
@@ -11,6 +13,8 @@
 #include "paintfield/core/widgets/simplebutton.h"
 #include "paintfield/core/rasterlayer.h"
 #include "paintfield/core/canvasviewport.h"
+#include "paintfield/core/appcontroller.h"
+#include "paintfield/core/memoryaccountant.h"
 
 #include "brushstroker.h"
 
@@ -29,9 +33,23 @@ BrushTool::BrushTool(Canvas *parent) :
 	_commitTimer->setInterval(200);
 	_commitTimer->setSingleShot(true);
 	connect(_commitTimer, SIGNAL(timeout()), this, SLOT(commitStroke()));
+	
+	if (appController() && parent)
+	{
+		// the stroke surface shares the tiles it has not painted with the layer, so they are counted only once
+		appController()->memoryAccountant()->addSource(this, MemoryAccountant::CategoryStroke, parent->document(), [this](MemoryCounter &counter) {
+			counter.addSurface(_surface);
+			if (_stroker)
+				counter.addSurface(_stroker->originalSurface());
+		});
+	}
 }
 
-BrushTool::~BrushTool() {}
+BrushTool::~BrushTool()
+{
+	if (appController())
+		appController()->memoryAccountant()->removeSources(this);
+}
 
 void BrushTool::drawLayer(SurfacePainter *painter, const LayerConstRef &layer)
 {
@@ -133,6 +151,7 @@ void BrushTool::beginStroke(const TabletInputData &data)
 		_stroker->setPixel(_pixel);
 		_stroker->setRadiusBase(double(_brushSize) * 0.5);
 		_stroker->setSmoothed(_smoothEnabled);
+		_stroker->setCoverageMask(canvas()->document()->selection()->coverage());
 		
 		addLayerDelegation(_layer);
 	}
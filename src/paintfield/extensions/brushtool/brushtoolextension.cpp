@@ -29,35 +29,45 @@ const QString brushEditorSideBarName("paintfield.sidebar.brushEditor");
 
 BrushToolExtension::BrushToolExtension(BrushPresetDatabase *presetDatabase, Workspace *workspace, QObject *parent) :
     WorkspaceExtension(workspace, parent),
+	mPresetDatabase(presetDatabase),
 	mPresetManager(new BrushPresetManager(this)),
 	mStrokerFactoryManager(new BrushStrokerFactoryManager(this))
 {
 	mStrokerFactoryManager->addFactory(new BrushStrokerPenFactory);
 	mStrokerFactoryManager->addFactory(new BrushStrokerSimpleBrushFactory);
 
-	{
-		connect(presetDatabase, &BrushPresetDatabase::currentPresetChanged, mPresetManager, &BrushPresetManager::setPreset);
-		mPresetManager->setPreset(presetDatabase->currentPreset());
+	connect(presetDatabase, &BrushPresetDatabase::currentPresetChanged, mPresetManager, &BrushPresetManager::setPreset);
+
+	// the side bars are created when they are first shown
+	addSideBar(brushLibrarySidebarName, [this] {
+		activate();
+		return new BrushLibraryView(mPresetDatabase);
+	});
+	addSideBar(brushSideBarName, [this] {
+		activate();
+		return new BrushSideBar(mPresetManager);
+	});
+	addSideBar(brushEditorSideBarName, [this] {
+		activate();
+		return new BrushEditorView(mStrokerFactoryManager, mPresetManager);
+	});
+}
 
-		addSideBar(brushLibrarySidebarName, new BrushLibraryView(presetDatabase));
-	}
-	{
-		// brush sidebar
-		auto brushSideBar = new BrushSideBar(mPresetManager);
-		addSideBar(brushSideBarName, brushSideBar);
-	}
+void BrushToolExtension::activate()
+{
+	if (mActivated)
+		return;
+	mActivated = true;
 
-	{
-		// brush editor
-		auto editorView = new BrushEditorView(mStrokerFactoryManager, mPresetManager);
-		addSideBar(brushEditorSideBarName, editorView);
-	}
+	mPresetManager->setPreset(mPresetDatabase->currentPreset());
 }
 
 Tool *BrushToolExtension::createTool(const QString &name, Canvas *parent)
 {
 	if (name == brushToolName)
 	{
+		activate();
+		
 		auto tool = new BrushTool(parent);
 		
 		connect(workspace()->paletteManager(), SIGNAL(currentColorChanged(Malachite::Color)), tool, SLOT(setColor(Malachite::Color)));
@@ -99,6 +109,7 @@ void BrushToolExtensionFactory::initialize(AppController *app)
 	}
 
 	{
+		// the presets are read in the background and added on the first use of the brush tool or side bars
 		auto presetDatabase = new BrushPresetDatabase(this);
 
 		QDir userSettingsDir = appController()->settingsManager()->userDataDir();
@@ -106,12 +117,12 @@ void BrushToolExtensionFactory::initialize(AppController *app)
 		QFileInfo fileInfo(userSettingsDir.filePath("brush-presets.json"));
 		mPresetFilePath = fileInfo.filePath();
 		if (fileInfo.exists()) {
-			presetDatabase->load(fileInfo.filePath());
+			presetDatabase->loadInBackground(fileInfo.filePath());
 		} else {
 			QDir builtinSettingsDir = appController()->settingsManager()->builtinDataDir();
 
 			if (builtinSettingsDir.cd("Settings")) {
-				presetDatabase->load(builtinSettingsDir.filePath("brush-presets.json"));
+				presetDatabase->loadInBackground(builtinSettingsDir.filePath("brush-presets.json"));
 			}
 		}
 		mPresetDatabase = presetDatabase;
@@ -120,7 +131,9 @@ void BrushToolExtensionFactory::initialize(AppController *app)
 
 BrushToolExtensionFactory::~BrushToolExtensionFactory()
 {
-	mPresetDatabase->save(mPresetFilePath);
+	// presets that were never used are unchanged
+	if (mPresetDatabase->isLoaded())
+		mPresetDatabase->save(mPresetFilePath);
 }
 
 WorkspaceExtensionList BrushToolExtensionFactory::createWorkspaceExtensions(Workspace *workspace, QObject *parent)
@@ -25,8 +25,16 @@ private slots:
 	
 private:
 	
+	/**
+	 * Sets the current preset, loading the presets if they are not loaded yet.
+	 * Called on the first use of the brush tool or one of the brush side bars.
+	 */
+	void activate();
+	
+	BrushPresetDatabase *mPresetDatabase = 0;
 	BrushPresetManager *mPresetManager = 0;
 	BrushStrokerFactoryManager *mStrokerFactoryManager = 0;
+	bool mActivated = false;
 };
 
 class BrushToolExtensionFactory : public ExtensionFactory
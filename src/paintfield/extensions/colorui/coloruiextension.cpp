@@ -19,27 +19,32 @@ static const QString colorSidebarName = "paintfield.sidebar.color";
 ColorUIExtension::ColorUIExtension(Workspace *workspace, QObject *parent) :
     WorkspaceExtension(workspace, parent)
 {
-	auto sidebar = new ColorSideBar();
-	addSideBar(colorSidebarName, sidebar);
-	
-	auto paletteM = workspace->paletteManager();
-	connect(paletteM, SIGNAL(colorChanged(int,Malachite::Color)), sidebar, SLOT(setColorButtonColor(int,Malachite::Color)));
-	connect(sidebar, SIGNAL(colorButtonColorChanged(int,Malachite::Color)), paletteM, SLOT(setColor(int,Malachite::Color)));
-	connect(sidebar, SIGNAL(colorButtonClicked(int)), paletteM, SLOT(setCurrentIndex(int)));
-	
-	for (int i = 0; i < paletteM->colorCount(); ++i)
-		sidebar->setColorButtonColor(i, paletteM->color(i));
-	
-	auto group = workspace->colorButtonGroup();
-	
-	for (auto b : sidebar->colorButtons())
-		group->add(b);
-	
-	connect(sidebar, SIGNAL(currentColorChanged(Malachite::Color)), group, SLOT(setCurrentColor(Malachite::Color)));
-	connect(group, SIGNAL(currentColorChanged(Malachite::Color)), sidebar, SLOT(setCurrentColor(Malachite::Color)));
-	
-	group->setCurrentButton(sidebar->colorButtons().at(0));
-	//sidebar->colorButtons().at(0)->setChecked(true);
+	// the colors are kept in the palette manager, so the side bar can be created when it is first shown
+	addSideBar(colorSidebarName, [workspace] {
+		auto sidebar = new ColorSideBar();
+		
+		auto paletteM = workspace->paletteManager();
+		connect(paletteM, SIGNAL(colorChanged(int,Malachite::Color)), sidebar, SLOT(setColorButtonColor(int,Malachite::Color)));
+		connect(sidebar, SIGNAL(colorButtonColorChanged(int,Malachite::Color)), paletteM, SLOT(setColor(int,Malachite::Color)));
+		connect(sidebar, SIGNAL(colorButtonClicked(int)), paletteM, SLOT(setCurrentIndex(int)));
+		
+		for (int i = 0; i < paletteM->colorCount(); ++i)
+			sidebar->setColorButtonColor(i, paletteM->color(i));
+		
+		auto group = workspace->colorButtonGroup();
+		
+		for (auto b : sidebar->colorButtons())
+			group->add(b);
+		
+		connect(sidebar, SIGNAL(currentColorChanged(Malachite::Color)), group, SLOT(setCurrentColor(Malachite::Color)));
+		connect(group, SIGNAL(currentColorChanged(Malachite::Color)), sidebar, SLOT(setCurrentColor(Malachite::Color)));
+		
+		// the side bar is created on first show, when the user may already have picked a button in another side bar
+		if (!group->currentButton())
+			group->setCurrentButton(sidebar->colorButtons().at(0));
+		
+		return sidebar;
+	});
 }
 
 void ColorUIExtensionFactory::initialize(AppController *app)
@@ -22,6 +22,8 @@ HEADERS += aboutdialog/aboutdialog.h \
            brushtool/brushtoolextension.h \
            colorui/colorsidebar.h \
            colorui/coloruiextension.h \
+           filltool/floodfilltool.h \
+           filltool/floodfilltoolextension.h \
            layerui/layermodelviewdelegate.h \
            layerui/layerpropertyeditor.h \
            layerui/layertreesidebar.h \
@@ -29,6 +31,7 @@ HEADERS += aboutdialog/aboutdialog.h \
            layerui/layeruiextension.h \
            movetool/layermovetool.h \
            movetool/layermovetoolextension.h \
+           movetool/freetransformtool.h \
            navigator/navigatorextension.h \
            navigator/navigatorview.h \
            toolui/tooluiextension.h \
@@ -74,6 +77,8 @@ SOURCES += aboutdialog/aboutdialog.cpp \
            brushtool/brushtoolextension.cpp \
            colorui/colorsidebar.cpp \
            colorui/coloruiextension.cpp \
+           filltool/floodfilltool.cpp \
+           filltool/floodfilltoolextension.cpp \
            layerui/layermodelviewdelegate.cpp \
            layerui/layerpropertyeditor.cpp \
            layerui/layertreesidebar.cpp \
@@ -81,6 +86,7 @@ SOURCES += aboutdialog/aboutdialog.cpp \
            layerui/layeruiextension.cpp \
            movetool/layermovetool.cpp \
            movetool/layermovetoolextension.cpp \
+           movetool/freetransformtool.cpp \
            navigator/navigatorextension.cpp \
            navigator/navigatorview.cpp \
            toolui/tooluiextension.cpp \
@@ -0,0 +1,126 @@
+#include <cmath>
+
+#include "paintfield/core/canvas.h"
+#include "paintfield/core/canvascursorevent.h"
+#include "paintfield/core/canvasview.h"
+#include "paintfield/core/canvasviewport.h"
+#include "paintfield/core/document.h"
+#include "paintfield/core/floodfill.h"
+#include "paintfield/core/layeredit.h"
+#include "paintfield/core/layerscene.h"
+#include "paintfield/core/rasterlayer.h"
+#include "paintfield/core/selection.h"
+
+#include "floodfilltool.h"
+
+using namespace Malachite;
+
+namespace PaintField
+{
+
+struct FloodFillTool::Data
+{
+	Mode mMode;
+	Pixel mPixel;
+	double mTolerance = 0.1;
+	bool mSampleMerged = false;
+};
+
+FloodFillTool::FloodFillTool(Mode mode, Canvas *parent) :
+	Tool(parent),
+	d(new Data)
+{
+	d->mMode = mode;
+}
+
+FloodFillTool::~FloodFillTool()
+{
+}
+
+void FloodFillTool::setColor(const Color &color)
+{
+	d->mPixel = color.toPixel();
+}
+
+void FloodFillTool::setTolerance(double tolerance)
+{
+	d->mTolerance = tolerance;
+}
+
+void FloodFillTool::setSampleMergedEnabled(bool enabled)
+{
+	d->mSampleMerged = enabled;
+}
+
+int FloodFillTool::cursorPressEvent(CanvasCursorEvent *event)
+{
+	auto document = canvas()->document();
+	auto layer = dynamicSPCast<const RasterLayer>(currentLayer());
+
+	if (d->mMode == ModeFill && (!layer || layer->isLocked()))
+		return 0;
+
+	QRect bounds(QPoint(), document->size());
+	QPoint seed(std::floor(event->data.pos.x()), std::floor(event->data.pos.y()));
+
+	bool sampleMerged = d->mSampleMerged || (event->modifiers() & Qt::ControlModifier);
+	SelectionSurface region;
+
+	if (sampleMerged && canvas()->view()) {
+		FloodFill fill(canvas()->view()->viewport()->mergedSurface(), bounds);
+		fill.setTolerance(d->mTolerance);
+		region = fill.fill(seed);
+	} else if (layer) {
+		FloodFill fill(layer->surface(), bounds);
+		fill.setTolerance(d->mTolerance);
+		region = fill.fill(seed);
+	} else {
+		return 0;
+	}
+
+	auto selection = document->selection();
+
+	if (d->mMode == ModeFill) {
+		// the fill is masked by the soft coverage of the selection, not its thresholded surface,
+		// so that feathered edges fade out as they do for the brushes
+		auto coverage = selection->coverage();
+		QPointSet keys = region.keys();
+		if (!selection->surface().isEmpty() || !coverage.isEmpty())
+			keys &= coverage.keys();
+		if (keys.isEmpty())
+			return 0;
+
+		auto filled = fillSelection(layer->surface(), region, d->mPixel, coverage);
+		layerScene()->editLayer(layer, new LayerTileEdit(filled, keys), tr("Fill"));
+		return 0;
+	}
+
+	auto modifiers = event->modifiers();
+	bool add = modifiers & Qt::ShiftModifier;
+	bool subtract = modifiers & Qt::AltModifier;
+
+	if (add && subtract)
+		selection->setSurface(combineSelectionSurfaces(selection->surface(), region, SelectionImage::OperationIntersect));
+	else if (add)
+		selection->setSurface(combineSelectionSurfaces(selection->surface(), region, SelectionImage::OperationUnion));
+	else if (subtract)
+		selection->setSurface(combineSelectionSurfaces(selection->surface(), region, SelectionImage::OperationSubtract));
+	else
+		selection->setSurface(region);
+
+	return 0;
+}
+
+void FloodFillTool::cursorMoveEvent(CanvasCursorEvent *event, int id)
+{
+	Q_UNUSED(event);
+	Q_UNUSED(id);
+}
+
+void FloodFillTool::cursorReleaseEvent(CanvasCursorEvent *event, int id)
+{
+	Q_UNUSED(event);
+	Q_UNUSED(id);
+}
+
+}
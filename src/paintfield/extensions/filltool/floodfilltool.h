@@ -0,0 +1,54 @@
+#pragma once
+
+#include <Malachite/Color>
+#include "paintfield/core/tool.h"
+
+namespace PaintField
+{
+
+/**
+ * The FloodFillTool selects (magic wand) or fills (paint bucket) the pixels connected to the clicked pixel
+ * that have a similar color.
+ *
+ * In the selection mode, Shift adds to, Alt subtracts from and Shift + Alt intersects with the current selection.
+ * Ctrl samples the merged image of the canvas instead of the current layer.
+ * Fills are limited to the current selection (if any).
+ */
+class FloodFillTool : public Tool
+{
+	Q_OBJECT
+public:
+
+	enum Mode
+	{
+		ModeSelect,
+		ModeFill
+	};
+
+	explicit FloodFillTool(Mode mode, Canvas *parent = 0);
+	~FloodFillTool();
+
+public slots:
+
+	void setColor(const Malachite::Color &color);
+
+	/**
+	 * @param tolerance The maximum difference of each premultiplied channel (0 - 1)
+	 */
+	void setTolerance(double tolerance);
+
+	void setSampleMergedEnabled(bool enabled);
+
+protected:
+
+	int cursorPressEvent(CanvasCursorEvent *event) override;
+	void cursorMoveEvent(CanvasCursorEvent *event, int id) override;
+	void cursorReleaseEvent(CanvasCursorEvent *event, int id) override;
+
+private:
+
+	struct Data;
+	QScopedPointer<Data> d;
+};
+
+}
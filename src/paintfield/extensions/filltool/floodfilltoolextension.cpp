@@ -0,0 +1,39 @@
+#include "paintfield/core/appcontroller.h"
+#include "paintfield/core/workspace.h"
+#include "paintfield/core/settingsmanager.h"
+#include "paintfield/core/palettemanager.h"
+#include "paintfield/core/widgets/simplebutton.h"
+
+#include "floodfilltool.h"
+
+#include "floodfilltoolextension.h"
+
+namespace PaintField
+{
+
+static const QString _magicWandToolName = "paintfield.tool.magicWand";
+static const QString _fillToolName = "paintfield.tool.fill";
+
+Tool *FloodFillToolExtension::createTool(const QString &name, Canvas *canvas)
+{
+	if (name == _magicWandToolName)
+		return new FloodFillTool(FloodFillTool::ModeSelect, canvas);
+	
+	if (name == _fillToolName)
+	{
+		auto tool = new FloodFillTool(FloodFillTool::ModeFill, canvas);
+		connect(workspace()->paletteManager(), SIGNAL(currentColorChanged(Malachite::Color)), tool, SLOT(setColor(Malachite::Color)));
+		tool->setColor(workspace()->paletteManager()->currentColor());
+		return tool;
+	}
+	
+	return 0;
+}
+
+void FloodFillToolExtensionFactory::initialize(AppController *app)
+{
+	app->settingsManager()->declareTool(_magicWandToolName, ToolInfo(QObject::tr("Magic Wand"), SimpleButton::createIcon(":/icons/24x24/magicWand.svg"), QStringList()));
+	app->settingsManager()->declareTool(_fillToolName, ToolInfo(QObject::tr("Fill"), SimpleButton::createIcon(":/icons/24x24/fill.svg"), {"raster"}));
+}
+
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "paintfield/core/extension.h"
+
+namespace PaintField
+{
+
+class FloodFillToolExtension : public WorkspaceExtension
+{
+	Q_OBJECT
+public:
+	FloodFillToolExtension(Workspace *workspace, QObject *parent) : WorkspaceExtension(workspace, parent) {}
+	
+	Tool *createTool(const QString &name, Canvas *canvas) override;
+};
+
+class FloodFillToolExtensionFactory : public ExtensionFactory
+{
+	Q_OBJECT
+	
+public:
+	
+	FloodFillToolExtensionFactory(QObject *parent = 0) : ExtensionFactory(parent) {}
+	
+	void initialize(AppController *app) override;
+	
+	WorkspaceExtensionList createWorkspaceExtensions(Workspace *workspace, QObject *parent) override
+	{
+		return { new FloodFillToolExtension(workspace, parent) };
+	}
+};
+
+}
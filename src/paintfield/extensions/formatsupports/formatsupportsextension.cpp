@@ -11,11 +11,15 @@ namespace PaintField {
 FormatSupportsExtension::FormatSupportsExtension(AppController *appC, QObject *parent) :
 	AppExtension(appC, parent)
 {
-	auto manager = appC->formatSupportManager();
-	manager->addFormatSupport(new JpegFormatSupport());
-	manager->addFormatSupport(new PngFormatSupport());
-	manager->addFormatSupport(new OpenRasterFormatSupport());
-	manager->addFormatSupport(new PsdFormatSupport());
+	// created when a document is first opened, imported or exported
+	appC->formatSupportManager()->addFormatSupportProvider([] {
+		return QList<FormatSupport *> {
+			new JpegFormatSupport(),
+			new PngFormatSupport(),
+			new OpenRasterFormatSupport(),
+			new PsdFormatSupport()
+		};
+	});
 }
 
 FormatSupportsExtensionFactory::FormatSupportsExtensionFactory(QObject *parent) :
@@ -1,4 +1,5 @@
 #include <Malachite/ImageIO>
+#include <Malachite/ImageStreamWriter>
 
 #include "jpegexportform.h"
 #include "pngexportform.h"
@@ -40,6 +41,37 @@ bool MalachiteFormatSupport::writeSingleLayer(QIODevice *device, const Malachite
 	return exporter.write(device);
 }
 
+bool MalachiteFormatSupport::supportsBandedWriting() const
+{
+	return Malachite::ImageStreamWriter::isFormatSupported(malachiteFormat());
+}
+
+bool MalachiteFormatSupport::writeSingleLayerBanded(QIODevice *device, const std::function<Malachite::Surface (const QRect &)> &renderBand, const QSize &size, const QVariant &option)
+{
+	auto settings = option.toHash();
+	bool hasAlpha = settings.value("hasAlpha", true).toBool();
+	int quality = settings.value("quality", 100).toInt();
+	
+	Malachite::ImageStreamWriter writer(malachiteFormat());
+	writer.setAlphaEnabled(hasAlpha);
+	writer.setQuality(quality);
+	
+	if (!writer.begin(device, size))
+		return false;
+	
+	// each band is one tile row, rendered and freed before the next one
+	constexpr int bandHeight = Malachite::Surface::tileWidth();
+	
+	for (int y = 0; y < size.height(); y += bandHeight)
+	{
+		QRect band(0, y, size.width(), std::min(bandHeight, size.height() - y));
+		if (!writer.writeRows(renderBand(band), band))
+			return false;
+	}
+	
+	return writer.end();
+}
+
 JpegFormatSupport::JpegFormatSupport(QObject *parent) :
 	MalachiteFormatSupport(parent)
 {
@@ -15,6 +15,9 @@ public:
 	bool readSingleLayer(QIODevice *device, Malachite::Surface *surface, QSize *size) override;
 	bool writeSingleLayer(QIODevice *device, const Malachite::Surface &surface, const QSize &size, const QVariant &option) override;
 	
+	bool supportsBandedWriting() const override;
+	bool writeSingleLayerBanded(QIODevice *device, const std::function<Malachite::Surface (const QRect &)> &renderBand, const QSize &size, const QVariant &option) override;
+	
 	virtual QString malachiteFormat() const = 0;
 	
 signals:
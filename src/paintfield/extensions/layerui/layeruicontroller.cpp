@@ -6,10 +6,13 @@
 #include <QMimeData>
 #include <QApplication>
 #include <QClipboard>
+#include <QProgressDialog>
 #include <tuple>
+#include <functional>
 #include <amulet/range_extension.hh>
 
 #include "paintfield/core/shapelayer.h"
+#include "paintfield/core/document.h"
 #include "paintfield/core/layeritemmodel.h"
 #include "paintfield/core/layerscene.h"
 #include "paintfield/core/rasterlayer.h"
@@ -28,6 +31,10 @@ struct LayerUIController::Data
 	QHash<ActionType, QAction *> actions;
 	Document *document = 0;
 	QList<QAction *> actionsForLayers;
+	QProgressDialog *progressDialog = 0;
+	
+	// selects the merged layer after a background merge
+	std::function<void ()> onMerged;
 };
 
 LayerUIController::LayerUIController(Document *document, QObject *parent) :
@@ -73,6 +80,13 @@ LayerUIController::LayerUIController(Document *document, QObject *parent) :
 		d->actions[ActionMerge] = a;
 	}
 	
+	{
+		auto a = Util::createAction("paintfield.layer.flatten", this, SLOT(flattenImage()));
+		a->setText(tr("Flatten Image"));
+		a->setShortcut(settingsManager->value({".key-bindings", "paintfield.layer.flatten"}).toString());
+		d->actions[ActionFlatten] = a;
+	}
+	
 	{
 		auto a = Util::createAction("paintfield.layer.copy", this, SLOT(copyLayers()));
 		a->setText(tr("Copy"));
@@ -104,6 +118,9 @@ LayerUIController::LayerUIController(Document *document, QObject *parent) :
 	}
 	
 	connect(document->layerScene(), SIGNAL(selectionChanged(QList<LayerConstRef>,QList<LayerConstRef>)), this, SLOT(onSelectionChanged()));
+	connect(document->layerScene(), SIGNAL(mergeProgressChanged(int,int)), this, SLOT(onMergeProgressChanged(int,int)));
+	connect(document->layerScene(), SIGNAL(mergeFinished(bool)), this, SLOT(onMergeFinished(bool)));
+	connect(document, SIGNAL(loadingChanged(bool)), this, SLOT(onSelectionChanged()));
 	onSelectionChanged();
 }
 
@@ -198,11 +215,31 @@ void LayerUIController::mergeLayers()
 	
 	if (count >= 2)
 	{
-		scene->mergeLayers(parent, start, count);
-		auto newLayer = parent->child(start);
+		d->onMerged = [scene, parent, start] {
+			auto newLayer = parent->child(start);
+			scene->setCurrent(newLayer);
+			scene->setSelection({newLayer});
+		};
+		
+		scene->startMergeLayers(parent, start, count);
+		beginMergeProgress(tr("Merging layers..."));
+	}
+}
+
+void LayerUIController::flattenImage()
+{
+	auto scene = d->document->layerScene();
+	if (scene->rootLayer()->count() == 0)
+		return;
+	
+	d->onMerged = [scene] {
+		auto newLayer = scene->rootLayer()->child(0);
 		scene->setCurrent(newLayer);
 		scene->setSelection({newLayer});
-	}
+	};
+	
+	scene->startFlatten();
+	beginMergeProgress(tr("Flattening image..."));
 }
 
 void LayerUIController::rasterizeLayers()
@@ -224,6 +261,7 @@ void LayerUIController::rasterizeLayers()
 		int index = layer->index();
 		bool rasterizingCurrent = (layer == current);
 		
+		// a single shape layer renders quickly, so it is rasterized in place
 		scene->mergeLayers(parent, index, 1);
 		
 		auto newLayer =  parent->child(index);
@@ -236,6 +274,51 @@ void LayerUIController::rasterizeLayers()
 	scene->setSelection(newLayers);
 }
 
+void LayerUIController::beginMergeProgress(const QString &text)
+{
+	// the merge did not start
+	if (!d->document->layerScene()->isMerging())
+	{
+		d->onMerged = nullptr;
+		return;
+	}
+	
+	// the dialog is shown only if merging takes a while
+	// it blocks input to every window, as the layers cannot be edited until the merge is pushed
+	d->progressDialog = new QProgressDialog(text, QString(), 0, 0, qApp->activeWindow());
+	d->progressDialog->setWindowModality(Qt::ApplicationModal);
+	d->progressDialog->setMinimumDuration(500);
+	
+	onSelectionChanged();
+}
+
+void LayerUIController::endMergeProgress()
+{
+	delete d->progressDialog;
+	d->progressDialog = 0;
+}
+
+void LayerUIController::onMergeProgressChanged(int rendered, int total)
+{
+	if (!d->progressDialog)
+		return;
+	
+	d->progressDialog->setMaximum(total);
+	d->progressDialog->setValue(rendered);
+}
+
+void LayerUIController::onMergeFinished(bool merged)
+{
+	endMergeProgress();
+	
+	auto onMerged = d->onMerged;
+	d->onMerged = nullptr;
+	if (merged && onMerged)
+		onMerged();
+	
+	onSelectionChanged();
+}
+
 static const QString layersMimeType = "application/x-paintfield-layers";
 
 void LayerUIController::copyLayers()
@@ -336,11 +419,17 @@ void LayerUIController::onSelectionChanged()
 {
 	auto selection = d->document->layerScene()->selection();
 	
-	d->actions[ActionMerge]->setEnabled(isSelectionMergeable(selection));
-	d->actions[ActionRasterize]->setEnabled(isSelectionRasterizable(selection));
+	// layers that are still loading cannot be merged or copied (their data would stay empty)
+	// and no layers can be changed while a merge is rendering
+	bool loaded = !d->document->isLoading() && !d->document->layerScene()->isMerging();
+	
+	d->actions[ActionMerge]->setEnabled(loaded && isSelectionMergeable(selection));
+	d->actions[ActionRasterize]->setEnabled(loaded && isSelectionRasterizable(selection));
+	d->actions[ActionFlatten]->setEnabled(loaded);
+	d->actions[ActionPaste]->setEnabled(loaded);
 	
 	for (auto action : d->actionsForLayers)
-		action->setEnabled(selection.size());
+		action->setEnabled(loaded && selection.size());
 }
 
 }
@@ -27,6 +27,7 @@ public:
 		ActionCut,
 		ActionPaste,
 		ActionMerge,
+		ActionFlatten,
 		ActionRasterize
 	};
 	
@@ -44,6 +45,7 @@ public slots:
 	void newGroupLayer();
 	void removeLayers();
 	void mergeLayers();
+	void flattenImage();
 	void rasterizeLayers();
 	
 	void copyLayers();
@@ -53,9 +55,14 @@ public slots:
 private slots:
 	
 	void onSelectionChanged();
+	void onMergeProgressChanged(int rendered, int total);
+	void onMergeFinished(bool merged);
 	
 private:
 	
+	void beginMergeProgress(const QString &text);
+	void endMergeProgress();
+	
 	void copyOrCutLayers(bool cut);
 	
 	void addLayers(const QList<LayerRef> &layers, const QString &description);
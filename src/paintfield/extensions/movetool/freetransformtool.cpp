@@ -0,0 +1,430 @@
+#include <QtConcurrent>
+#include <QGraphicsPathItem>
+#include <QKeyEvent>
+#include <cmath>
+#include <Malachite/Division>
+#include <Malachite/SurfacePainter>
+
+#include "paintfield/core/layerscene.h"
+#include "paintfield/core/layeredit.h"
+#include "paintfield/core/rasterlayer.h"
+#include "paintfield/core/canvastransforms.h"
+
+#include "freetransformtool.h"
+
+using namespace Malachite;
+
+namespace PaintField
+{
+
+namespace
+{
+
+constexpr int maxPreviewLevel = 4;
+
+/**
+ * Averages each 2x2 pixels of "surface" into "result", only for the tiles of "result" in "dstKeys".
+ */
+void halveSurface(const Surface &surface, const QPointSet &dstKeys, Surface &result)
+{
+	constexpr int halfTileWidth = Surface::tileWidth() / 2;
+
+	for (const QPoint &dstKey : dstKeys)
+	{
+		Image dst = Surface::createTile();
+		bool empty = true;
+
+		for (int i = 0; i < 4; ++i)
+		{
+			QPoint quadrant(i % 2, i / 2);
+			QPoint key = dstKey * 2 + quadrant;
+
+			if (!surface.contains(key))
+				continue;
+
+			empty = false;
+			auto src = surface.tile(key);
+
+			for (int y = 0; y < halfTileWidth; ++y)
+			{
+				auto dp = dst.pixelPointer(quadrant * halfTileWidth + QPoint(0, y));
+				auto sp0 = src.constPixelPointer(0, 2 * y);
+				auto sp1 = src.constPixelPointer(0, 2 * y + 1);
+
+				for (int x = 0; x < halfTileWidth; ++x)
+				{
+					(dp + x)->rv() = ((sp0 + 2 * x)->v() + (sp0 + 2 * x + 1)->v() + (sp1 + 2 * x)->v() + (sp1 + 2 * x + 1)->v()) * PixelVec(0.25f);
+				}
+			}
+		}
+
+		if (empty)
+			result.remove(dstKey);
+		else
+			result.setTile(dstKey, dst);
+	}
+}
+
+/**
+ * Returns the keys of the tiles that differ between "a" and "b".
+ * Tiles are compared by identity, so it is cheap for surfaces that share most of their tiles.
+ */
+QPointSet changedKeys(const Surface &a, const Surface &b)
+{
+	QPointSet keys;
+
+	for (const QPoint &key : a.keys())
+	{
+		if (!b.contains(key) || a.tile(key).dataId() != b.tile(key).dataId())
+			keys << key;
+	}
+	for (const QPoint &key : b.keys())
+	{
+		if (!a.contains(key))
+			keys << key;
+	}
+
+	return keys;
+}
+
+QPointSet halvedKeys(const QPointSet &keys)
+{
+	QPointSet result;
+	for (const QPoint &key : keys)
+	{
+		QPoint dstKey, quadrant;
+		IntDivision::dividePoint(key, 2, &dstKey, &quadrant);
+		result << dstKey;
+	}
+	return result;
+}
+
+}
+
+struct FreeTransformTool::Data
+{
+	enum Mode
+	{
+		NoOperation,
+		Translating,
+		Scaling,
+		Rotating,
+		Skewing
+	};
+
+	Mode mode = NoOperation;
+
+	LayerConstRef layer;
+	Surface surface;
+	QRect rect;
+
+	Surface previewSurface;
+	int previewLevel = 0;
+
+	// downsampled levels of the last pressed layer (levels[0] is the layer surface itself)
+	// kept between presses and only updated where the layer has changed
+	QVector<Surface> levels;
+
+	QPointF dragStartPos;
+	QTransform transform;
+	QPointSet lastKeys;
+
+	QGraphicsPathItem *frameItem = 0;
+
+	QPointF center() const { return QRectF(rect).center(); }
+
+	QRect transformedRect() const { return transform.mapRect(QRectF(rect)).toAlignedRect(); }
+};
+
+FreeTransformTool::FreeTransformTool(Canvas *parent) :
+	Tool(parent),
+	d(new Data)
+{
+	d->frameItem = new QGraphicsPathItem();
+
+	QPen pen;
+	pen.setWidth(1);
+	pen.setColor(QColor(128, 128, 128, 128));
+	d->frameItem->setPen(pen);
+	d->frameItem->setVisible(false);
+
+	setGraphicsItem(d->frameItem);
+
+	connect(parent, SIGNAL(transformsChanged(SP<const CanvasTransforms>)), this, SLOT(updateFrame()));
+}
+
+FreeTransformTool::~FreeTransformTool()
+{
+}
+
+void FreeTransformTool::drawLayer(SurfacePainter *painter, const LayerConstRef &layer)
+{
+	if (d->mode == Data::NoOperation || layer != d->layer)
+	{
+		layer->render(painter);
+		return;
+	}
+
+	double scale = 1 << d->previewLevel;
+
+	painter->pushState();
+
+	painter->setShapeTransform(QTransform::fromScale(scale, scale) * d->transform);
+	painter->setBrush(Brush(d->previewSurface));
+	painter->setImageTransformType(Malachite::ImageTransformTypeBilinear);
+	painter->drawRect(QRectF(d->previewSurface.boundingRect()));
+
+	painter->popState();
+}
+
+Surface FreeTransformTool::transformedSurface(const Surface &surface, const QRect &srcRect, const QTransform &transform)
+{
+	struct TileJob
+	{
+		QPoint key;
+		Image tile;
+	};
+
+	QVector<TileJob> jobs;
+	for (const QPoint &key : Surface::rectToKeys(transform.mapRect(QRectF(srcRect)).toAlignedRect()))
+		jobs << TileJob { key, Image() };
+
+	// each destination tile is rendered independently, so they can be resampled in parallel
+	QtConcurrent::blockingMap(jobs, [&](TileJob &job) {
+
+		Image tile = Surface::createTile();
+
+		{
+			QPoint offset = -job.key * Surface::tileWidth();
+
+			Painter painter(&tile);
+			painter.setShapeTransform(transform * QTransform::fromTranslate(offset.x(), offset.y()));
+			painter.setBrush(Brush(surface));
+			painter.setImageTransformType(Malachite::ImageTransformTypeLanczos2);
+			painter.drawRect(QRectF(srcRect));
+		}
+
+		if (!tile.isBlank())
+			job.tile = tile;
+	});
+
+	Surface result;
+
+	for (const auto &job : jobs)
+	{
+		if (job.tile.isValid())
+			result.setTile(job.key, job.tile);
+	}
+
+	return result;
+}
+
+int FreeTransformTool::cursorPressEvent(CanvasCursorEvent *event)
+{
+	event->accept();
+
+	auto layer = currentLayer();
+	auto rasterLayer = dynamicSPCast<const RasterLayer>(layer);
+
+	if (!rasterLayer || layer->isLocked())
+		return 0;
+
+	d->layer = layer;
+	d->surface = rasterLayer->surface();
+	d->rect = d->surface.boundingRect();
+
+	if (d->rect.isEmpty())
+		return 0;
+
+	auto modifiers = event->modifiers();
+
+	if (modifiers & Qt::ShiftModifier)
+		d->mode = Data::Scaling;
+	else if (modifiers & Qt::AltModifier)
+		d->mode = Data::Rotating;
+	else if (modifiers & Qt::ControlModifier)
+		d->mode = Data::Skewing;
+	else
+		d->mode = Data::Translating;
+
+	// the preview is read from a level that has about one pixel per view pixel
+	double scale = canvas()->transforms()->scale;
+	d->previewLevel = qBound(0, int(std::floor(-std::log2(scale))), maxPreviewLevel);
+	updateLevels();
+	d->previewSurface = d->levels.at(d->previewLevel);
+
+	d->dragStartPos = event->data.pos;
+	d->transform = QTransform();
+	d->lastKeys = d->surface.keys();
+
+	addLayerDelegation(layer);
+	setEditing(true);
+	updateFrame();
+
+	return 0;
+}
+
+void FreeTransformTool::cursorMoveEvent(CanvasCursorEvent *event, int id)
+{
+	Q_UNUSED(id);
+
+	if (d->mode == Data::NoOperation)
+		return;
+
+	updateTransform(event->data.pos);
+	requestTransformedUpdate();
+	updateFrame();
+}
+
+void FreeTransformTool::cursorReleaseEvent(CanvasCursorEvent *event, int id)
+{
+	Q_UNUSED(id);
+
+	if (d->mode == Data::NoOperation)
+		return;
+
+	updateTransform(event->data.pos);
+	commit();
+	finish();
+}
+
+void FreeTransformTool::keyPressEvent(QKeyEvent *event)
+{
+	if (event->key() == Qt::Key_Escape && d->mode != Data::NoOperation)
+	{
+		// cancel
+		d->transform = QTransform();
+		requestTransformedUpdate();
+		finish();
+		return;
+	}
+
+	event->ignore();
+}
+
+void FreeTransformTool::updateFrame()
+{
+	if (d->mode == Data::NoOperation)
+	{
+		d->frameItem->setVisible(false);
+		return;
+	}
+
+	QPainterPath path;
+	path.addPolygon(d->transform.map(QPolygonF(QRectF(d->rect))));
+	path.closeSubpath();
+
+	d->frameItem->setPath(path * canvas()->transforms()->sceneToView);
+	d->frameItem->setVisible(true);
+}
+
+void FreeTransformTool::updateTransform(const QPointF &pos)
+{
+	auto center = d->center();
+	auto start = d->dragStartPos;
+
+	auto aroundCenter = [&](const QTransform &transform) {
+		return QTransform::fromTranslate(-center.x(), -center.y()) * transform * QTransform::fromTranslate(center.x(), center.y());
+	};
+
+	switch (d->mode)
+	{
+		default:
+		case Data::Translating:
+		{
+			auto delta = pos - start;
+			d->transform = QTransform::fromTranslate(delta.x(), delta.y());
+			break;
+		}
+		case Data::Scaling:
+		{
+			auto startDelta = start - center;
+			auto delta = pos - center;
+			double sx = std::abs(startDelta.x()) >= 1 ? delta.x() / startDelta.x() : 1;
+			double sy = std::abs(startDelta.y()) >= 1 ? delta.y() / startDelta.y() : 1;
+			d->transform = aroundCenter(QTransform::fromScale(sx, sy));
+			break;
+		}
+		case Data::Rotating:
+		{
+			auto startDelta = start - center;
+			auto delta = pos - center;
+			double angle = std::atan2(delta.y(), delta.x()) - std::atan2(startDelta.y(), startDelta.x());
+			d->transform = aroundCenter(QTransform().rotateRadians(angle));
+			break;
+		}
+		case Data::Skewing:
+		{
+			auto delta = pos - start;
+			double shearX = delta.x() / d->rect.height();
+			double shearY = delta.y() / d->rect.width();
+			d->transform = aroundCenter(QTransform(1, shearY, shearX, 1, 0, 0));
+			break;
+		}
+	}
+}
+
+void FreeTransformTool::updateLevels()
+{
+	auto &levels = d->levels;
+
+	QPointSet keys = levels.isEmpty() ? d->surface.keys() : changedKeys(levels.at(0), d->surface);
+
+	if (levels.isEmpty())
+		levels << d->surface;
+	else
+		levels[0] = d->surface;
+
+	// every cached level is updated, including those deeper than this preview,
+	// as a later press may read them without any further change to the layer
+	int lastLevel = qMax(d->previewLevel, levels.size() - 1);
+
+	for (int level = 1; level <= lastLevel; ++level)
+	{
+		if (level == levels.size())
+		{
+			// a level not made before is made from all of the level above it
+			levels << Surface();
+			keys = levels.at(level - 1).keys();
+		}
+
+		keys = halvedKeys(keys);
+		halveSurface(levels.at(level - 1), keys, levels[level]);
+	}
+}
+
+void FreeTransformTool::requestTransformedUpdate()
+{
+	auto keys = Surface::rectToKeys(d->transformedRect());
+	emit requestUpdate(keys | d->lastKeys);
+	d->lastKeys = keys;
+}
+
+void FreeTransformTool::finish()
+{
+	d->mode = Data::NoOperation;
+	d->layer = LayerConstRef();
+	d->surface = Surface();
+	d->previewSurface = Surface();
+
+	clearLayerDelegation();
+	setEditing(false);
+	updateFrame();
+}
+
+void FreeTransformTool::commit()
+{
+	if (d->transform.isIdentity() || !d->transform.isInvertible())
+	{
+		requestTransformedUpdate();
+		return;
+	}
+
+	auto transformed = transformedSurface(d->surface, d->rect, d->transform);
+
+	// every original tile is replaced (or removed), as the whole layer is transformed
+	auto edit = new LayerTileEdit(transformed, d->surface.keys() | transformed.keys());
+	layerScene()->editLayer(d->layer, edit, tr("Free Transform"));
+}
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "paintfield/core/tool.h"
+
+namespace PaintField
+{
+
+/**
+ * The FreeTransformTool scales, rotates, skews and moves the current raster layer with affine transforms.
+ *
+ * The gesture is chosen by the modifiers at press:
+ * none moves, Shift scales, Alt rotates and Ctrl skews (around the center of the layer).
+ * While dragging, a downsampled copy of the layer matched to the canvas zoom is drawn with bilinear filtering.
+ * On release, the layer is resampled at full resolution with Lanczos2, tile by tile in parallel,
+ * and committed as a LayerTileEdit.
+ */
+class FreeTransformTool : public Tool
+{
+	Q_OBJECT
+public:
+	explicit FreeTransformTool(Canvas *parent = 0);
+	~FreeTransformTool();
+
+	void drawLayer(Malachite::SurfacePainter *painter, const LayerConstRef &layer) override;
+
+	/**
+	 * Resamples "surface" with "transform" at full quality.
+	 * @param srcRect The rect of "surface" to transform
+	 */
+	static Malachite::Surface transformedSurface(const Malachite::Surface &surface, const QRect &srcRect, const QTransform &transform);
+
+protected:
+
+	int cursorPressEvent(CanvasCursorEvent *event) override;
+	void cursorMoveEvent(CanvasCursorEvent *event, int id) override;
+	void cursorReleaseEvent(CanvasCursorEvent *event, int id) override;
+	void keyPressEvent(QKeyEvent *event) override;
+
+private slots:
+
+	void updateFrame();
+
+private:
+
+	void updateLevels();
+	void updateTransform(const QPointF &pos);
+	void requestTransformedUpdate();
+	void finish();
+	void commit();
+
+	struct Data;
+	QScopedPointer<Data> d;
+};
+
+}
@@ -19,9 +19,9 @@ LayerMoveTool::LayerMoveTool(Canvas *parent) :
 
 void LayerMoveTool::drawLayer(SurfacePainter *painter, const LayerConstRef &layer)
 {
-	PAINTFIELD_DEBUG << "offset:" << _offset;
 	auto rasterLayer = dynamicSPCast<const RasterLayer>(layer);
-	painter->drawSurface(_offset, rasterLayer->surface());
+	// an integer offset is read as a shifted view of the tiles, without retiling the surface
+	painter->drawPreTransformedSurface(_offset, rasterLayer->surface());
 }
 
 void LayerMoveTool::cursorMoveEvent(CanvasCursorEvent *event, int id)
@@ -47,6 +47,7 @@ int LayerMoveTool::cursorPressEvent(CanvasCursorEvent *event)
 		_dragStartPoint = event->data.pos.toQPoint();
 		_lastKeys = _layer->tileKeys();
 	}
+	return 0;
 }
 
 void LayerMoveTool::cursorReleaseEvent(CanvasCursorEvent *event, int id)
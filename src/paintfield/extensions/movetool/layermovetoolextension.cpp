@@ -5,6 +5,7 @@
 #include "paintfield/core/widgets/simplebutton.h"
 
 #include "layermovetool.h"
+#include "freetransformtool.h"
 
 #include "layermovetoolextension.h"
 
@@ -12,11 +13,14 @@ namespace PaintField
 {
 
 static const QString _layerMoveToolName = "paintfield.tool.move";
+static const QString _freeTransformToolName = "paintfield.tool.transform";
 
 Tool *LayerMoveToolExtension::createTool(const QString &name, Canvas *canvas)
 {
 	if (name == _layerMoveToolName)
 		return new LayerMoveTool(canvas);
+	if (name == _freeTransformToolName)
+		return new FreeTransformTool(canvas);
 	return 0;
 }
 
@@ -25,6 +29,8 @@ void LayerMoveToolExtensionFactory::initialize(AppController *app)
 	QString text = QObject::tr("Layer Move");
 	QIcon icon = SimpleButton::createIcon(":/icons/24x24/move.svg");
 	app->settingsManager()->declareTool(_layerMoveToolName, ToolInfo(text, icon, {"raster"}));
+
+	app->settingsManager()->declareTool(_freeTransformToolName, ToolInfo(QObject::tr("Free Transform"), SimpleButton::createIcon(":/icons/24x24/transform.svg"), {"raster"}));
 }
 
 }
@@ -27,6 +27,15 @@ MinimapView::MinimapView(Canvas *canvas, QWidget *parent) :
 		connect(canvas, SIGNAL(transformsChanged(SP<const CanvasTransforms>)), this, SLOT(onTransformChanged()));
 		d->thumbnailPixmap = QPixmap(canvas->document()->size());
 		d->thumbnailPixmap.fill(Qt::white);
+
+		// start from the preview embedded in the file while the document is being loaded
+		auto preview = canvas->document()->preview();
+		if (!preview.isNull())
+		{
+			QPainter painter(&d->thumbnailPixmap);
+			painter.setRenderHint(QPainter::SmoothPixmapTransform);
+			painter.drawImage(d->thumbnailPixmap.rect(), preview);
+		}
 		d->keys = canvas->document()->tileKeys();
 	}
 
@@ -1,6 +1,7 @@
 #include "aboutdialog/aboutdialogextension.h"
 #include "brushtool/brushtoolextension.h"
 #include "colorui/coloruiextension.h"
+#include "filltool/floodfilltoolextension.h"
 #include "layerui/layeruiextension.h"
 #include "movetool/layermovetoolextension.h"
 #include "navigator/navigatorextension.h"
@@ -18,6 +19,7 @@ RootExtensionFactory::RootExtensionFactory(QObject *parent) :
 	addSubExtensionFactory(new AboutDialogExtensionFactory(this));
 	addSubExtensionFactory(new BrushToolExtensionFactory(this));
 	addSubExtensionFactory(new ColorUIExtensionFactory(this));
+	addSubExtensionFactory(new FloodFillToolExtensionFactory(this));
 	addSubExtensionFactory(new LayerUIExtensionFactory(this));
 	addSubExtensionFactory(new LayerMoveToolExtensionFactory(this));
 	addSubExtensionFactory(new NavigatorExtensionFactory(this));
@@ -17,7 +17,6 @@
 #include "paintfield/core/rectlayer.h"
 #include "paintfield/core/layeritemmodel.h"
 #include "paintfield/core/layeredit.h"
-#include "paintfield/core/canvasupdatemanager.h"
 
 #include "recttool.h"
 
@@ -235,8 +234,6 @@ struct RectTool::Data
 	bool clickedWithShift = false;
 	
 	SelectingMode selectingMode = SelectImmediately;
-	
-	CanvasUpdateManager *updateManager = 0;
 };
 
 RectTool::RectTool(AddingType type, Canvas *canvas) :
@@ -244,8 +241,6 @@ RectTool::RectTool(AddingType type, Canvas *canvas) :
 	d(new Data)
 {
 	d->layerController = canvas->findChild<LayerUIController *>();
-	d->updateManager = new CanvasUpdateManager(this);
-	connect(d->updateManager, SIGNAL(updateTilesRequested(QPointSet)), this, SIGNAL(requestUpdate(QPointSet)));
 	
 	// set modes
 	
@@ -347,8 +342,6 @@ int RectTool::cursorPressEvent(CanvasCursorEvent *event)
 		return 0;
 	}
 	
-	d->updateManager->setEnabled(true);
-	
 	d->clickedLayer = layerScene()->rootLayer()->descendantAt(event->data.pos.toQPoint(), handleRadius);
 	d->clickedWithShift = event->modifiers() & Qt::ShiftModifier;
 	
@@ -459,8 +452,7 @@ void RectTool::cursorMoveEvent(CanvasCursorEvent *event, int id)
 					d->layerToAdd->setRect(rect);
 				}
 				
-				d->updateManager->addTiles(keys);
-				//emit requestUpdate(keys);
+				emit requestUpdate(keys);
 				updateGraphicsItems();
 				break;
 			}
@@ -491,8 +483,6 @@ void RectTool::cursorReleaseEvent(CanvasCursorEvent *event, int id)
 		return;
 	}
 	
-	d->updateManager->setEnabled(false);
-	
 	bool selectLater = false;
 	
 	if (d->dragDistanceEnough)
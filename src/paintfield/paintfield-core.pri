@@ -14,7 +14,7 @@ windows {
 	PF_PLATFORM = "windows"
 }
 
-QT += core gui network xml svg widgets
+QT += core gui network xml svg widgets concurrent
 CONFIG += c++11
 
 INCLUDEPATH += $$PWD/.. $$PWD/../libs $$PWD/../libs/Malachite/include $$PWD/../libs/amulet/include
@@ -1,3 +1,3 @@
 TEMPLATE = subdirs
 
-SUBDIRS = core extensions app test
+SUBDIRS = core extensions app cli test
@@ -16,7 +16,14 @@ SOURCES += main.cpp \
     test_document.cpp \
     autotest.cpp \
     test_zipunzip.cpp \
-    test_selectionimage.cpp
+    test_selectionimage.cpp \
+    test_tiledirtymap.cpp \
+    test_surfaceoffsetview.cpp \
+    test_softselection.cpp \
+    test_floodfill.cpp \
+    test_memoryaccountant.cpp \
+    test_surfacemipmap.cpp \
+    test_extension.cpp
 
 HEADERS += \
     testutil.h \
@@ -29,4 +36,11 @@ HEADERS += \
     test_document.h \
     autotest.h \
     test_zipunzip.h \
-    test_selectionimage.h
+    test_selectionimage.h \
+    test_tiledirtymap.h \
+    test_surfaceoffsetview.h \
+    test_softselection.h \
+    test_floodfill.h \
+    test_memoryaccountant.h \
+    test_surfacemipmap.h \
+    test_extension.h
@@ -1,8 +1,11 @@
 
 #include <QtCore>
+#include <QSignalSpy>
 #include "paintfield/core/document.h"
 #include "paintfield/core/layerscene.h"
 #include "paintfield/core/paintfieldformatsupport.h"
+#include "paintfield/core/documentloader.h"
+#include "paintfield/core/rasterlayer.h"
 
 #include "testutil.h"
 #include "test_documentio.h"
@@ -41,6 +44,63 @@ void Test_DocumentIO::saveLoad()
 	QCOMPARE(doc->layerScene()->rootLayer()->count(), openedDoc->layerScene()->rootLayer()->count());
 }
 
+void Test_DocumentIO::asyncLoad()
+{
+	auto tempDir = TestUtil::createTestDir();
+	auto path = tempDir.filePath("test.pfield");
+	
+	auto formatSupport = new PaintFieldFormatSupport(this);
+	
+	auto doc = TestUtil::createTestDocument(this);
+	FormatSupport::exportToFile(path, formatSupport, doc->layerScene()->rootLayer()->children(), doc->size(), QVariant());
+	
+	DocumentLoader *loader;
+	auto openedDoc = DocumentLoader::open(path, &loader);
+	QVERIFY(openedDoc);
+	QVERIFY(loader);
+	QCOMPARE(openedDoc->isLoading(), true);
+	QCOMPARE(loader->totalCount(), 3);
+	
+	// the layer tree, the preview and the thumbnails are there before the data
+	QCOMPARE(doc->layerScene()->rootLayer()->count(), openedDoc->layerScene()->rootLayer()->count());
+	QVERIFY(!openedDoc->preview().isNull());
+	QVERIFY(!openedDoc->layerScene()->rootLayer()->child(0)->thumbnail().isNull());
+	
+	QSignalSpy spy(loader, SIGNAL(finished(bool)));
+	QVERIFY(spy.wait());
+	QCOMPARE(spy.at(0).at(0).toBool(), true);
+	QCOMPARE(openedDoc->isLoading(), false);
+	
+	auto original = dynamicSPCast<const RasterLayer>(doc->layerScene()->rootLayer()->child(0));
+	auto opened = dynamicSPCast<const RasterLayer>(openedDoc->layerScene()->rootLayer()->child(0));
+	QCOMPARE(opened->surface().keys(), original->surface().keys());
+	
+	delete openedDoc;
+}
+
+void Test_DocumentIO::preview()
+{
+	auto tempDir = TestUtil::createTestDir();
+	auto path = tempDir.filePath("test.pfield");
+	
+	auto formatSupport = new PaintFieldFormatSupport(this);
+	
+	auto doc = TestUtil::createTestDocument(this);
+	FormatSupport::exportToFile(path, formatSupport, doc->layerScene()->rootLayer()->children(), doc->size(), QVariant());
+	
+	QFile file(path);
+	QVERIFY(file.open(QIODevice::ReadOnly));
+	
+	// the smallest preview
+	auto small = PaintFieldFormatSupport::readPreview(&file, 0);
+	QCOMPARE(small.size(), QSize(256, 192));
+	
+	// no preview is larger than the document
+	QVERIFY(file.seek(0));
+	auto large = PaintFieldFormatSupport::readPreview(&file, 4096);
+	QCOMPARE(large.size(), doc->size());
+}
+
 PF_ADD_TESTCLASS(Test_DocumentIO)
 
 }
@@ -19,6 +19,8 @@ public slots:
 private slots:
 	
 	void saveLoad();
+	void asyncLoad();
+	void preview();
 };
 
 }
@@ -0,0 +1,80 @@
+#include <QWidget>
+
+#include "autotest.h"
+#include "test_extension.h"
+
+#include "paintfield/core/extension.h"
+#include "paintfield/core/formatsupport.h"
+#include "paintfield/core/formatsupportmanager.h"
+
+namespace PaintField {
+
+namespace {
+
+class DummyFormatSupport : public FormatSupport
+{
+public:
+
+	QString name() const override { return "dummy"; }
+	QStringList suffixes() const override { return {"dummy"}; }
+	Capabilities capabilities() const override { return CapabilityAll; }
+	bool read(QIODevice *, QList<LayerRef> *, QSize *) override { return false; }
+	bool write(QIODevice *, const QList<LayerConstRef> &, const QSize &, const QVariant &) override { return false; }
+};
+
+}
+
+Test_Extension::Test_Extension(QObject *parent) :
+	QObject(parent)
+{
+}
+
+void Test_Extension::test_sideBarFactory()
+{
+	Extension extension;
+	int createCount = 0;
+	QWidget *created = 0;
+
+	extension.addSideBar("test", [&] {
+		++createCount;
+		created = new QWidget();
+		return created;
+	});
+
+	// registering does not create the side bar
+	QVERIFY(extension.hasSideBar("test"));
+	QCOMPARE(createCount, 0);
+
+	QCOMPARE(extension.sideBar("test"), created);
+	QCOMPARE(createCount, 1);
+
+	// later requests return the same side bar
+	QCOMPARE(extension.sideBar("test"), created);
+	QCOMPARE(createCount, 1);
+
+	delete created;
+}
+
+void Test_Extension::test_formatSupportProviders()
+{
+	FormatSupportManager manager;
+	int provideCount = 0;
+
+	manager.addFormatSupportProvider([&] {
+		++provideCount;
+		return QList<FormatSupport *>({ new DummyFormatSupport() });
+	});
+
+	// the provider runs on the first request only
+	QCOMPARE(provideCount, 0);
+
+	QVERIFY(manager.formatSupport("dummy"));
+	QCOMPARE(provideCount, 1);
+
+	QCOMPARE(manager.formatSupports().size(), 2);
+	QCOMPARE(provideCount, 1);
+}
+
+PF_ADD_TESTCLASS(Test_Extension)
+
+}
@@ -0,0 +1,23 @@
+#ifndef TEST_EXTENSION_H
+#define TEST_EXTENSION_H
+
+#include <QObject>
+
+namespace PaintField {
+
+class Test_Extension : public QObject
+{
+	Q_OBJECT
+public:
+	explicit Test_Extension(QObject *parent = 0);
+
+private slots:
+
+	void test_sideBarFactory();
+	void test_formatSupportProviders();
+
+};
+
+}
+
+#endif // TEST_EXTENSION_H
@@ -0,0 +1,135 @@
+#include "autotest.h"
+#include "test_floodfill.h"
+
+#include <Malachite/Division>
+#include <Malachite/Coverage>
+#include "paintfield/core/floodfill.h"
+
+using namespace Malachite;
+
+namespace PaintField {
+
+namespace {
+
+void setPixelAt(Surface &surface, const QPoint &pos, const Pixel &pixel)
+{
+	QPoint key, rem;
+	IntDivision::dividePoint(pos, Surface::tileWidth(), &key, &rem);
+	*surface.tileRef(key).pixelPointer(rem) = pixel;
+}
+
+/**
+ * @return A surface with the outline of "rect" (crossing tile boundaries)
+ */
+Surface outlineSurface(const QRect &rect, const Pixel &pixel)
+{
+	Surface surface;
+	for (int x = rect.left(); x <= rect.right(); ++x) {
+		setPixelAt(surface, QPoint(x, rect.top()), pixel);
+		setPixelAt(surface, QPoint(x, rect.bottom()), pixel);
+	}
+	for (int y = rect.top(); y <= rect.bottom(); ++y) {
+		setPixelAt(surface, QPoint(rect.left(), y), pixel);
+		setPixelAt(surface, QPoint(rect.right(), y), pixel);
+	}
+	return surface;
+}
+
+int selectedCount(const SelectionSurface &surface)
+{
+	int count = 0;
+	for (const QPoint &key : surface.keys())
+		count += surface.tile(key).selectedCount();
+	return count;
+}
+
+}
+
+Test_FloodFill::Test_FloodFill(QObject *parent) :
+	QObject(parent)
+{
+}
+
+void Test_FloodFill::test_fill_data()
+{
+	QTest::addColumn<QPoint>("seed");
+	QTest::addColumn<float>("tolerance");
+	QTest::addColumn<int>("count");
+
+	// the outline is from (10, 10) to (100, 100) in 200 * 200 bounds
+	QTest::newRow("inside") << QPoint(50, 50) << 0.f << 89 * 89;
+	QTest::newRow("outside") << QPoint(5, 5) << 0.f << 200 * 200 - 91 * 91;
+	QTest::newRow("outline") << QPoint(10, 70) << 0.f << 91 * 4 - 4;
+	QTest::newRow("tolerant") << QPoint(5, 5) << 0.2f << 200 * 200;
+	QTest::newRow("out of bounds") << QPoint(-5, 5) << 0.f << 0;
+}
+
+void Test_FloodFill::test_fill()
+{
+	QFETCH(QPoint, seed);
+	QFETCH(float, tolerance);
+	QFETCH(int, count);
+
+	FloodFill fill(outlineSurface(QRect(10, 10, 91, 91), Pixel(0.1f, 0.1f, 0.f, 0.f)), QRect(0, 0, 200, 200));
+	fill.setTolerance(tolerance);
+	auto result = fill.fill(seed);
+
+	QCOMPARE(selectedCount(result), count);
+	for (const QPoint &key : result.keys())
+		QVERIFY(QRect(0, 0, 200, 200).intersects(Surface::keyToRect(key)));
+}
+
+void Test_FloodFill::test_fillSelection()
+{
+	FloodFill fill(outlineSurface(QRect(10, 10, 91, 91), Pixel(1.f, 1.f, 0.f, 0.f)), QRect(0, 0, 200, 200));
+	auto region = fill.fill(QPoint(50, 50));
+
+	auto filled = fillSelection(Surface(), region, Pixel(1.f, 0.f, 1.f, 0.f));
+
+	auto pixelAt = [&](const QPoint &pos) {
+		QPoint key, rem;
+		IntDivision::dividePoint(pos, Surface::tileWidth(), &key, &rem);
+		return *filled.tile(key).constPixelPointer(rem);
+	};
+
+	QCOMPARE(pixelAt(QPoint(11, 11)), Pixel(1.f, 0.f, 1.f, 0.f));
+	QCOMPARE(pixelAt(QPoint(99, 70)), Pixel(1.f, 0.f, 1.f, 0.f));
+	QCOMPARE(pixelAt(QPoint(10, 11)), Pixel(0.f));
+	QCOMPARE(pixelAt(QPoint(101, 70)), Pixel(0.f));
+}
+
+void Test_FloodFill::test_fillSelection_coverage()
+{
+	FloodFill fill(outlineSurface(QRect(10, 10, 91, 91), Pixel(1.f, 1.f, 0.f, 0.f)), QRect(0, 0, 200, 200));
+	auto region = fill.fill(QPoint(50, 50));
+
+	// a feathered edge in tile (0, 0): opaque, half covered, then uncovered
+	CoverageImage tile(CoverageSurface::tileSize());
+	for (int y = 0; y < Surface::tileWidth(); ++y) {
+		auto row = (uint8_t *)tile.pixelPointer(0, y);
+		for (int x = 0; x < Surface::tileWidth(); ++x)
+			row[x] = x < 30 ? 255 : x < 50 ? 128 : 0;
+	}
+	CoverageSurface coverage;
+	coverage.setTile(QPoint(0, 0), tile);
+
+	auto filled = fillSelection(Surface(), region, Pixel(1.f, 0.f, 0.f, 1.f), coverage);
+
+	auto alphaAt = [&](const QPoint &pos) {
+		QPoint key, rem;
+		IntDivision::dividePoint(pos, Surface::tileWidth(), &key, &rem);
+		return filled.tile(key, Surface::createTile()).constPixelPointer(rem)->a();
+	};
+
+	QCOMPARE(alphaAt(QPoint(20, 20)), 1.f);
+	QVERIFY(qAbs(alphaAt(QPoint(40, 20)) - 128.f / 255.f) < 0.01f);
+	QCOMPARE(alphaAt(QPoint(55, 20)), 0.f);
+
+	// tiles without coverage are not filled
+	QCOMPARE(alphaAt(QPoint(70, 20)), 0.f);
+	QCOMPARE(alphaAt(QPoint(99, 70)), 0.f);
+}
+
+}
+
+PF_ADD_TESTCLASS(Test_FloodFill)
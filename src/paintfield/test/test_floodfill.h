@@ -0,0 +1,29 @@
+#ifndef TEST_FLOODFILL_H
+#define TEST_FLOODFILL_H
+
+#include <QObject>
+
+namespace PaintField {
+
+class Test_FloodFill : public QObject
+{
+	Q_OBJECT
+public:
+	explicit Test_FloodFill(QObject *parent = 0);
+
+signals:
+
+public slots:
+
+private slots:
+
+	void test_fill_data();
+	void test_fill();
+	void test_fillSelection();
+	void test_fillSelection_coverage();
+
+};
+
+}
+
+#endif // TEST_FLOODFILL_H
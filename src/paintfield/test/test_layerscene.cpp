@@ -1,3 +1,5 @@
+#include <QSignalSpy>
+#include <QUndoStack>
 
 #include "autotest.h"
 #include "testutil.h"
@@ -6,6 +8,7 @@
 #include "paintfield/core/grouplayer.h"
 #include "paintfield/core/document.h"
 #include "paintfield/core/layerscene.h"
+#include "paintfield/core/layerrenderer.h"
 
 #include "test_layerscene.h"
 
@@ -153,6 +156,122 @@ void Test_LayerScene::test_copyLayers()
 	QCOMPARE(dir->child(3)->name(), QString("layer3"));
 }
 
+void Test_LayerScene::test_flatten()
+{
+	QList<LayerRef> layers;
+	QList<LayerConstRef> constLayers;
+	
+	for (int i = 0; i < 3; ++i)
+	{
+		auto layer = makeSP<RasterLayer>("layer" + QString::number(i));
+		layer->setSurface(TestUtil::createTestSurface(i));
+		layer->setOpacity(0.5);
+		layers << layer;
+		constLayers << layer;
+	}
+	
+	auto expected = LayerRenderer().renderToSurface(constLayers);
+	
+	auto doc = new Document("temp", QSize(400, 300), layers);
+	auto dir = doc->layerScene()->rootLayer();
+	
+	doc->layerScene()->flatten();
+	
+	QCOMPARE(dir->count(), 1);
+	auto flattened = dynamicSPCast<const RasterLayer>(dir->child(0));
+	QVERIFY(flattened);
+	QVERIFY(expected == flattened->surface());
+	
+	doc->undoStack()->undo();
+	
+	QCOMPARE(dir->count(), 3);
+	QVERIFY(dir->child(1) == layers[1]);
+	
+	// the merged layer is reused on redo
+	doc->undoStack()->redo();
+	QVERIFY(dir->child(0) == flattened);
+	
+	doc->deleteLater();
+}
+
+void Test_LayerScene::test_mergeWhileLoading()
+{
+	QList<LayerRef> layers = { makeSP<RasterLayer>("layer0"), makeSP<RasterLayer>("layer1") };
+	
+	auto doc = new Document("temp", QSize(400, 300), layers);
+	auto scene = doc->layerScene();
+	auto dir = scene->rootLayer();
+	
+	doc->setLoading(true);
+	
+	scene->mergeLayers(dir, 0, 2);
+	scene->flatten();
+	scene->copyLayers({dir->child(0)}, dir, 2);
+	
+	QCOMPARE(dir->count(), 2);
+	QCOMPARE(doc->undoStack()->count(), 0);
+	
+	doc->setLoading(false);
+	
+	scene->flatten();
+	QCOMPARE(dir->count(), 1);
+	
+	doc->deleteLater();
+}
+
+void Test_LayerScene::test_startFlatten()
+{
+	QList<LayerRef> layers;
+	QList<LayerConstRef> constLayers;
+	
+	for (int i = 0; i < 3; ++i)
+	{
+		auto layer = makeSP<RasterLayer>("layer" + QString::number(i));
+		layer->setSurface(TestUtil::createTestSurface(i));
+		layers << layer;
+		constLayers << layer;
+	}
+	
+	auto expected = LayerRenderer().renderToSurface(constLayers);
+	
+	auto doc = new Document("temp", QSize(400, 300), layers);
+	auto scene = doc->layerScene();
+	auto dir = scene->rootLayer();
+	
+	QSignalSpy spy(scene, SIGNAL(mergeFinished(bool)));
+	
+	scene->startFlatten();
+	QVERIFY(scene->isMerging());
+	
+	// nothing is pushed until rendering finishes
+	QCOMPARE(dir->count(), 3);
+	scene->removeLayers({dir->child(0)});
+	QCOMPARE(dir->count(), 3);
+	
+	QVERIFY(spy.wait());
+	QCOMPARE(spy.first().first().toBool(), true);
+	QVERIFY(!scene->isMerging());
+	
+	QCOMPARE(dir->count(), 1);
+	auto flattened = dynamicSPCast<const RasterLayer>(dir->child(0));
+	QVERIFY(flattened);
+	QVERIFY(expected == flattened->surface());
+	
+	// the merge is dropped if the undo stack moves while rendering
+	doc->undoStack()->undo();
+	scene->startMergeLayers(dir, 0, 2);
+	doc->undoStack()->push(new QUndoCommand("other"));
+	
+	QVERIFY(spy.wait());
+	QCOMPARE(spy.last().first().toBool(), false);
+	
+	QCOMPARE(dir->count(), 3);
+	for (int i = 0; i < 3; ++i)
+		QVERIFY(dir->child(i) == layers[i]);
+	
+	doc->deleteLater();
+}
+
 void Test_LayerScene::test_setLayerProperty()
 {
 	auto doc = new Document("temp", QSize(400, 300), {makeSP<RasterLayer>("layer")});
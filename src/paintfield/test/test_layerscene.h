@@ -19,6 +19,9 @@ private slots:
 	void test_moveLayers();
 	void test_moveLayers_sibling();
 	void test_copyLayers();
+	void test_flatten();
+	void test_mergeWhileLoading();
+	void test_startFlatten();
 	
 	void test_setLayerProperty();
 };
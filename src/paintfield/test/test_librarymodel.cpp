@@ -1,5 +1,6 @@
 
 #include <QtGui>
+#include <QSignalSpy>
 #include "autotest.h"
 #include "paintfield/core/librarymodel.h"
 
@@ -43,11 +44,34 @@ QString Test_LibraryModel::createTestDirStructure()
 	return tempDir.path();
 }
 
+bool Test_LibraryModel::waitForDirectory(const std::function<void ()> &start)
+{
+	QSignalSpy spy(_model, SIGNAL(directoryLoaded(QString)));
+	start();
+	return spy.wait();
+}
+
 void Test_LibraryModel::initTestCase()
 {
 	_model = new LibraryModel;
 	_rootPath = createTestDirStructure();
-	_model->addRootPath(_rootPath, "test");
+	QVERIFY(waitForDirectory([this] { _model->addRootPath(_rootPath, "test"); }));
+}
+
+void Test_LibraryModel::fetchOnExpand()
+{
+	// subdirectories are listed when expanded
+	auto dirIndex = _model->item(0)->child(1)->index();
+	QCOMPARE(_model->rowCount(dirIndex), 0);
+	QVERIFY(_model->hasChildren(dirIndex));
+	QVERIFY(_model->canFetchMore(dirIndex));
+	
+	QVERIFY(waitForDirectory([&] { _model->fetchMore(dirIndex); }));
+	QCOMPARE(_model->rowCount(dirIndex), 2);
+	QVERIFY(!_model->canFetchMore(dirIndex));
+	
+	auto subDirIndex = _model->item(0)->child(1)->child(1)->index();
+	QVERIFY(waitForDirectory([&] { _model->fetchMore(subDirIndex); }));
 }
 
 void Test_LibraryModel::checkStructure()
@@ -77,7 +101,7 @@ void Test_LibraryModel::updateDirItemRoot()
 	auto item = _model->item(0);
 	auto dir = QDir(_rootPath);
 	TestUtil::createTestFile(dir.filePath("2.txt"));
-	_model->updateDirItem(item);
+	QVERIFY(waitForDirectory([&] { _model->updateDirItem(item); }));
 	
 	QCOMPARE(_model->item(0)->rowCount(), 3);
 	QCOMPARE(_model->item(0)->child(0)->text(), QString("0.txt"));
@@ -92,7 +116,7 @@ void Test_LibraryModel::updateDirItem()
 	dir.cd("1");
 	TestUtil::createTestFile(dir.filePath("12.txt"));
 	
-	_model->updateDirItem(item);
+	QVERIFY(waitForDirectory([&] { _model->updateDirItem(item); }));
 	
 	QCOMPARE(_model->item(0)->child(1)->rowCount(), 3);
 	QCOMPARE(_model->item(0)->child(1)->child(0)->text(), QString("10.txt"));
@@ -100,6 +124,43 @@ void Test_LibraryModel::updateDirItem()
 	QCOMPARE(_model->item(0)->child(1)->child(2)->text(), QString("12.txt"));
 }
 
+void Test_LibraryModel::watchDirectory()
+{
+	// listed directories are updated when their contents change
+	auto dir = QDir(_rootPath);
+	QVERIFY(waitForDirectory([&] { QFile::remove(dir.filePath("0.txt")); }));
+	
+	QCOMPARE(_model->item(0)->rowCount(), 2);
+	QCOMPARE(_model->item(0)->child(0)->text(), QString("1"));
+	QCOMPARE(_model->item(0)->child(1)->text(), QString("2.txt"));
+}
+
+void Test_LibraryModel::thumbnailOnDemand()
+{
+	_model->indexer()->setThumbnailCacheDir(TestUtil::createTestDir().path());
+	
+	auto dir = QDir(_rootPath);
+	dir.cd("1");
+	dir.cd("11");
+	
+	QImage image(16, 16, QImage::Format_ARGB32);
+	image.fill(Qt::red);
+	QVERIFY(image.save(dir.filePath("111.png")));
+	
+	QVERIFY(waitForDirectory([&] { _model->updateDirItem(_model->itemFromPath(dir.path())); }));
+	
+	auto item = _model->itemFromPath(dir.filePath("111.png"));
+	QVERIFY(item);
+	
+	// no thumbnail is made until the item is shown
+	QVERIFY(item->data(Qt::DecorationRole).isNull());
+	
+	QSignalSpy spy(_model, SIGNAL(dataChanged(QModelIndex,QModelIndex,QVector<int>)));
+	_model->data(item->index(), Qt::DecorationRole);
+	QVERIFY(spy.wait());
+	QVERIFY(!item->data(Qt::DecorationRole).value<QImage>().isNull());
+}
+
 PF_ADD_TESTCLASS(Test_LibraryModel)
 
 }
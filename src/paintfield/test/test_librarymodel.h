@@ -4,6 +4,7 @@
 #include "testutil.h"
 #include "paintfield/core/librarymodel.h"
 #include <QObject>
+#include <functional>
 
 namespace PaintField
 {
@@ -23,13 +24,18 @@ public slots:
 private slots:
 	
 	void initTestCase();
+	void fetchOnExpand();
 	void checkStructure();
 	void pathForItem();
 	void updateDirItemRoot();
 	void updateDirItem();
+	void watchDirectory();
+	void thumbnailOnDemand();
 	
 private:
 	
+	bool waitForDirectory(const std::function<void ()> &start);
+	
 	LibraryModel *_model;
 	QString _rootPath;
 };
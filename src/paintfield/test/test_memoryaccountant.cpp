@@ -0,0 +1,100 @@
+#include <QSignalSpy>
+
+#include "autotest.h"
+#include "test_memoryaccountant.h"
+
+#include "paintfield/core/memoryaccountant.h"
+
+using namespace Malachite;
+
+namespace PaintField {
+
+Test_MemoryAccountant::Test_MemoryAccountant(QObject *parent) :
+	QObject(parent)
+{
+}
+
+void Test_MemoryAccountant::test_sharedTiles()
+{
+	constexpr qint64 tileBytes = Surface::tileWidth() * Surface::tileWidth() * sizeof(Pixel);
+
+	Surface surface;
+	surface.setTile(QPoint(0, 0), Surface::createTile());
+	surface.setTile(QPoint(1, 0), Surface::createTile());
+
+	// shares (0, 0) and owns a new (1, 0)
+	auto copy = surface;
+	copy.tileRef(QPoint(1, 0)).detach();
+
+	MemoryCounter counter;
+	counter.addSurface(surface);
+	QCOMPARE(counter.bytes(), 2 * tileBytes);
+	counter.addSurface(copy);
+	QCOMPARE(counter.bytes(), 3 * tileBytes);
+}
+
+void Test_MemoryAccountant::test_budget()
+{
+	MemoryAccountant accountant;
+	accountant.setBudget(1000);
+
+	qint64 mipmapBytes = 800;
+	int owner;
+
+	accountant.addSource(&owner, MemoryAccountant::CategoryLayers, 0, [](MemoryCounter &counter) {
+		counter.addBytes(500);
+	});
+	accountant.addSource(&owner, MemoryAccountant::CategoryViewportMipmap, 0, [&](MemoryCounter &counter) {
+		counter.addBytes(mipmapBytes);
+	}, [&] {
+		mipmapBytes = 100;
+	});
+
+	QSignalSpy spy(&accountant, SIGNAL(budgetExceeded(qint64,qint64)));
+
+	// releasing the mipmap is enough
+	accountant.refresh();
+	QCOMPARE(accountant.totalUsage(), qint64(600));
+	QCOMPARE(accountant.usage(MemoryAccountant::CategoryViewportMipmap), qint64(100));
+	QCOMPARE(spy.count(), 0);
+
+	// nothing more can be released
+	accountant.setBudget(400);
+	accountant.refresh();
+	QCOMPARE(spy.count(), 1);
+
+	accountant.removeSources(&owner);
+	accountant.refresh();
+	QCOMPARE(accountant.totalUsage(), qint64(0));
+}
+
+void Test_MemoryAccountant::test_scheduleRefresh()
+{
+	MemoryAccountant accountant;
+	int owner;
+	int measureCount = 0;
+
+	accountant.addSource(&owner, MemoryAccountant::CategoryLayers, 0, [&](MemoryCounter &counter) {
+		counter.addBytes(500);
+		++measureCount;
+	});
+
+	QSignalSpy spy(&accountant, SIGNAL(usageChanged()));
+
+	// nothing is measured without a budget
+	accountant.scheduleRefresh();
+	QVERIFY(!spy.wait(3000));
+	QCOMPARE(measureCount, 0);
+
+	// repeated calls are measured once
+	accountant.setBudget(1000);
+	accountant.scheduleRefresh();
+	accountant.scheduleRefresh();
+	QVERIFY(spy.wait(3000));
+	QCOMPARE(measureCount, 1);
+	QCOMPARE(accountant.totalUsage(), qint64(500));
+}
+
+PF_ADD_TESTCLASS(Test_MemoryAccountant)
+
+}
@@ -0,0 +1,24 @@
+#ifndef TEST_MEMORYACCOUNTANT_H
+#define TEST_MEMORYACCOUNTANT_H
+
+#include <QObject>
+
+namespace PaintField {
+
+class Test_MemoryAccountant : public QObject
+{
+	Q_OBJECT
+public:
+	explicit Test_MemoryAccountant(QObject *parent = 0);
+
+private slots:
+
+	void test_sharedTiles();
+	void test_budget();
+	void test_scheduleRefresh();
+
+};
+
+}
+
+#endif // TEST_MEMORYACCOUNTANT_H
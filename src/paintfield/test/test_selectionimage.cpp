@@ -54,6 +54,94 @@ void Test_SelectionImage::test_toQImageARGBPremult()
 	QCOMPARE(qimage.pixel(10,10), rgb0);
 }
 
+void Test_SelectionImage::test_paste()
+{
+	SelectionImage src(QSize(20, 3));
+	src.fill(false);
+	src.setPixel(0, 0, true);
+	src.setPixel(19, 2, true);
+
+	SelectionImage image(QSize(64, 64));
+	image.fill(false);
+	image.paste(src, QPoint(50, 5));
+
+	QCOMPARE(image.pixel(50, 5), true);
+	QCOMPARE(image.pixel(63, 7), false);
+	QCOMPARE(image.selectedCount(), 1);
+
+	image.paste(src, QPoint(-19, 10));
+	QCOMPARE(image.pixel(0, 12), true);
+	QCOMPARE(image.selectedCount(), 2);
+}
+
+void Test_SelectionImage::test_combine()
+{
+	SelectionImage a(QSize(64, 64));
+	a.fill(false);
+	a.setPixel(1, 1, true);
+	a.setPixel(2, 2, true);
+
+	SelectionImage b(QSize(64, 64));
+	b.fill(false);
+	b.setPixel(2, 2, true);
+	b.setPixel(3, 3, true);
+
+	auto combined = [&](SelectionImage::Operation op) {
+		auto image = a;
+		image.combine(b, op);
+		return image;
+	};
+
+	QCOMPARE(combined(SelectionImage::OperationUnion).selectedCount(), 3);
+	QCOMPARE(combined(SelectionImage::OperationIntersect).selectedCount(), 1);
+	QCOMPARE(combined(SelectionImage::OperationIntersect).pixel(2, 2), true);
+	QCOMPARE(combined(SelectionImage::OperationSubtract).selectedCount(), 1);
+	QCOMPARE(combined(SelectionImage::OperationSubtract).pixel(1, 1), true);
+	QCOMPARE(combined(SelectionImage::OperationXor).selectedCount(), 2);
+	QCOMPARE(a.selectedCount(), 2);
+
+	SelectionSurface surfaceA, surfaceB;
+	surfaceA.setTile(QPoint(0, 0), a);
+	surfaceB.setTile(QPoint(0, 0), a);
+	surfaceB.setTile(QPoint(1, 0), b);
+
+	QCOMPARE(combineSelectionSurfaces(surfaceA, surfaceB, SelectionImage::OperationUnion).tileCount(), 2);
+	QCOMPARE(combineSelectionSurfaces(surfaceA, surfaceB, SelectionImage::OperationIntersect).tileCount(), 1);
+	QCOMPARE(combineSelectionSurfaces(surfaceA, surfaceB, SelectionImage::OperationSubtract).isEmpty(), true);
+	QCOMPARE(combineSelectionSurfaces(surfaceA, surfaceB, SelectionImage::OperationXor).keys(), QPointSet({QPoint(1, 0)}));
+}
+
+void Test_SelectionImage::test_selectedCount()
+{
+	SelectionImage image(QSize(13, 5));
+	image.fill(true);
+	QCOMPARE(image.selectedCount(), 13 * 5);
+	image.setPixel(12, 4, false);
+	QCOMPARE(image.selectedCount(), 13 * 5 - 1);
+	QCOMPARE(image.isBlank(), false);
+}
+
+void Test_SelectionImage::test_downsample()
+{
+	SelectionImage src(QSize(64, 64));
+	src.fill(false);
+	// 2 of 4 -> selected
+	src.setPixel(0, 0, true);
+	src.setPixel(1, 1, true);
+	// 1 of 4 -> not selected
+	src.setPixel(62, 2, true);
+
+	SelectionImage dst(QSize(64, 64));
+	dst.fill(true);
+
+	Malachite::MipmapTileDownsampler<SelectionImage, SelectionMipmapPixelTraits>::downsample(dst, QPoint(32, 0), src, QPoint(), QSize(32, 32));
+
+	QCOMPARE(dst.pixel(32, 0), true);
+	QCOMPARE(dst.pixel(63, 1), false);
+	QCOMPARE(dst.pixel(31, 0), true);
+	QCOMPARE(dst.selectedCount(), 64 * 64 - 32 * 32 + 1);
+}
+
 PF_ADD_TESTCLASS(Test_SelectionImage)
 
 }
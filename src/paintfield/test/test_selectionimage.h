@@ -20,6 +20,10 @@ private slots:
 	void test_isBlank();
 	void test_iterator();
 	void test_toQImageARGBPremult();
+	void test_paste();
+	void test_combine();
+	void test_selectedCount();
+	void test_downsample();
 
 };
 
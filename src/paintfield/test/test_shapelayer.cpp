@@ -1,5 +1,6 @@
 
 #include "autotest.h"
+#include <Malachite/SurfacePainter>
 #include "paintfield/core/rectlayer.h"
 
 #include "test_shapelayer.h"
@@ -190,6 +191,33 @@ void Test_ShapeLayer::test_setFillPath()
 	
 }
 
+void Test_ShapeLayer::test_rasterizeTiles()
+{
+	RectLayer layer;
+	layer.setRect(QRectF(10, 10, 200, 100));
+	layer.setFillBrush(Brush(Color::fromRgbValue(1, 0, 0)));
+	layer.setStrokeBrush(Brush(Color::fromRgbValue(0, 0, 1)));
+	
+	// only the requested tiles are rasterized
+	auto partial = layer.rasterizedSurface({QPoint(0, 0)});
+	QCOMPARE(partial.keys(), QPointSet({QPoint(0, 0)}));
+	
+	Surface expected;
+	{
+		SurfacePainter painter(&expected);
+		painter.setBrush(layer.fillBrush());
+		painter.drawPath(layer.fillPath());
+		painter.setBrush(layer.strokeBrush());
+		painter.drawPath(layer.strokePath());
+	}
+	
+	QVERIFY(layer.rasterizedSurface() == expected);
+	
+	// changing the shape drops the cached tiles
+	layer.setRect(QRectF(10, 10, 20, 20));
+	QCOMPARE(layer.rasterizedSurface().keys(), QPointSet({QPoint(0, 0)}));
+}
+
 PF_ADD_TESTCLASS(Test_ShapeLayer)
 
 }
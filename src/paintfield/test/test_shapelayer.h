@@ -23,6 +23,7 @@ private slots:
 	void test_loadProperties();
 	
 	void test_setFillPath();
+	void test_rasterizeTiles();
 };
 
 }
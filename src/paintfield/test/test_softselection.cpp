@@ -0,0 +1,131 @@
+#include "autotest.h"
+#include "test_softselection.h"
+
+#include <QUndoStack>
+
+#include "paintfield/core/softselection.h"
+#include "paintfield/core/selection.h"
+#include "paintfield/core/document.h"
+#include "paintfield/core/rasterlayer.h"
+
+using namespace Malachite;
+
+namespace PaintField {
+
+namespace {
+
+CoverageSurface rectCoverage(const QRect &rect)
+{
+	CoverageSurface surface;
+
+	for (const QPoint &key : CoverageSurface::rectToKeys(rect)) {
+		auto tile = CoverageSurface::createTile();
+		auto tileRect = CoverageSurface::keyToRect(key);
+		auto r = rect & tileRect;
+		for (int y = r.top(); y <= r.bottom(); ++y) {
+			for (int x = r.left(); x <= r.right(); ++x)
+				*tile.pixelPointer(x - tileRect.left(), y - tileRect.top()) = 255;
+		}
+		surface.setTile(key, tile);
+	}
+
+	return surface;
+}
+
+int coverageAt(const CoverageSurface &surface, const QPoint &pos)
+{
+	auto key = CoverageSurface::keyForPixel(pos);
+	return *surface.tile(key).constPixelPointer(pos - key * CoverageSurface::tileWidth());
+}
+
+}
+
+Test_SoftSelection::Test_SoftSelection(QObject *parent) :
+	QObject(parent)
+{
+}
+
+void Test_SoftSelection::test_selectionRoundTrip()
+{
+	QRect rect(50, 10, 30, 20);
+	auto selection = selectionFromCoverage(rectCoverage(rect));
+
+	int count = 0;
+	for (const QPoint &key : selection.keys())
+		count += selection.tile(key).selectedCount();
+	QCOMPARE(count, rect.width() * rect.height());
+
+	auto coverage = coverageFromSelection(selection);
+	QCOMPARE(coverageAt(coverage, QPoint(50, 10)), 255);
+	QCOMPARE(coverageAt(coverage, QPoint(79, 29)), 255);
+	QCOMPARE(coverageAt(coverage, QPoint(80, 29)), 0);
+}
+
+void Test_SoftSelection::test_grow()
+{
+	// the right edge is close to the tile boundary
+	auto grown = growCoverage(rectCoverage(QRect(40, 10, 20, 20)), 5);
+
+	QCOMPARE(coverageAt(grown, QPoint(50, 20)), 255);
+	QCOMPARE(coverageAt(grown, QPoint(64, 20)), 255);
+	QCOMPARE(coverageAt(grown, QPoint(66, 20)), 0);
+	QCOMPARE(coverageAt(grown, QPoint(35, 20)), 255);
+	QCOMPARE(coverageAt(grown, QPoint(33, 20)), 0);
+	QVERIFY(grown.contains(QPoint(1, 0)));
+}
+
+void Test_SoftSelection::test_shrink()
+{
+	auto shrunk = shrinkCoverage(rectCoverage(QRect(10, 10, 40, 40)), 5);
+
+	QCOMPARE(coverageAt(shrunk, QPoint(30, 30)), 255);
+	QCOMPARE(coverageAt(shrunk, QPoint(15, 30)), 255);
+	QCOMPARE(coverageAt(shrunk, QPoint(13, 30)), 0);
+	QCOMPARE(coverageAt(shrunk, QPoint(10, 30)), 0);
+}
+
+void Test_SoftSelection::test_feather()
+{
+	auto feathered = featherCoverage(rectCoverage(QRect(0, 0, 200, 200)), 3);
+
+	QCOMPARE(coverageAt(feathered, QPoint(100, 100)), 255);
+	QCOMPARE(coverageAt(feathered, QPoint(-30, 100)), 0);
+
+	auto edge = coverageAt(feathered, QPoint(0, 100));
+	QVERIFY(edge > 100 && edge < 200);
+	QVERIFY(coverageAt(feathered, QPoint(-1, 100)) > 0);
+}
+
+}
+
+void Test_SoftSelection::test_undoBinaryEdit()
+{
+	auto doc = new Document("temp", QSize(200, 200), {makeSP<RasterLayer>("layer")});
+	auto selection = doc->selection();
+
+	selection->setCoverage(rectCoverage(QRect(20, 20, 100, 100)));
+	selection->feather(3);
+	auto feathered = selection->coverage();
+	auto edge = coverageAt(feathered, QPoint(20, 50));
+	QVERIFY(edge > 0 && edge < 255);
+
+	// a binary edit (clearing tile (1, 1)) drops the soft edges
+	auto edited = selection->surface();
+	edited.setTile(QPoint(1, 1), SelectionSurface::createTile());
+	selection->updateSurface(edited, {QPoint(1, 1)});
+	selection->commitSurface();
+	auto binaryEdge = coverageAt(selection->coverage(), QPoint(20, 50));
+	QVERIFY(binaryEdge == 0 || binaryEdge == 255);
+
+	doc->undoStack()->undo();
+	QCOMPARE(coverageAt(selection->coverage(), QPoint(20, 50)), edge);
+
+	doc->undoStack()->redo();
+	QCOMPARE(coverageAt(selection->coverage(), QPoint(20, 50)), binaryEdge);
+
+	doc->deleteLater();
+}
+
+}
+
+PF_ADD_TESTCLASS(Test_SoftSelection)
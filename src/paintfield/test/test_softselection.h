@@ -0,0 +1,30 @@
+#ifndef TEST_SOFTSELECTION_H
+#define TEST_SOFTSELECTION_H
+
+#include <QObject>
+
+namespace PaintField {
+
+class Test_SoftSelection : public QObject
+{
+	Q_OBJECT
+public:
+	explicit Test_SoftSelection(QObject *parent = 0);
+
+signals:
+
+public slots:
+
+private slots:
+
+	void test_selectionRoundTrip();
+	void test_grow();
+	void test_shrink();
+	void test_feather();
+	void test_undoBinaryEdit();
+
+};
+
+}
+
+#endif // TEST_SOFTSELECTION_H
@@ -0,0 +1,71 @@
+#include "autotest.h"
+#include "test_surfacemipmap.h"
+
+#include <Malachite/Surface>
+#include <Malachite/SurfaceMipmap>
+
+using namespace Malachite;
+
+namespace PaintField {
+
+Test_SurfaceMipmap::Test_SurfaceMipmap(QObject *parent) :
+	QObject(parent)
+{
+}
+
+void Test_SurfaceMipmap::test_lazyLevels()
+{
+	SurfaceMipmap<Surface> mipmap;
+	mipmap.setSceneSize(QSize(256, 256));
+
+	mipmap.modify(QPoint(0, 0), QRect(0, 0, 64, 64), [](Image &tile) {
+		tile.bitmap().fill(Pixel(1.f));
+	});
+
+	// nothing is downsampled until a level is requested
+	QCOMPARE(mipmap.levelSurface(1).tileCount(), 0);
+
+	auto surface = mipmap.surface(1, QRect(0, 0, 64, 64));
+	QCOMPARE(surface.tileCount(), 1);
+	QCOMPARE(mipmap.levelSurface(2).tileCount(), 0);
+
+	auto tile = surface.tile(QPoint(0, 0));
+	QCOMPARE(tile.constPixelPointer(QPoint(0, 0))->a(), 1.f);
+	QCOMPARE(tile.constPixelPointer(QPoint(31, 31))->a(), 1.f);
+	QCOMPARE(tile.constPixelPointer(QPoint(32, 0))->a(), 0.f);
+
+	// only the modified region is downsampled again
+	mipmap.modify(QPoint(1, 0), QRect(0, 0, 2, 2), [](Image &tile) {
+		tile.bitmap().fill(Pixel(1.f));
+	});
+	tile = mipmap.surface(1, QRect(0, 0, 128, 64)).tile(QPoint(0, 0));
+	QCOMPARE(tile.constPixelPointer(QPoint(32, 0))->a(), 1.f);
+	QCOMPARE(tile.constPixelPointer(QPoint(33, 0))->a(), 0.f);
+}
+
+void Test_SurfaceMipmap::test_releaseUnusedLevels()
+{
+	SurfaceMipmap<Surface> mipmap;
+	mipmap.setSceneSize(QSize(256, 256));
+
+	mipmap.modify(QPoint(0, 0), QRect(0, 0, 64, 64), [](Image &tile) {
+		tile.bitmap().fill(Pixel(1.f));
+	});
+
+	mipmap.surface(1, QRect(0, 0, 256, 256));
+	mipmap.surface(2, QRect(0, 0, 256, 256));
+	QCOMPARE(mipmap.levelSurface(1).tileCount(), 1);
+	QCOMPARE(mipmap.levelSurface(2).tileCount(), 1);
+
+	// level 1 was used least recently
+	mipmap.releaseUnusedLevels(1);
+	QCOMPARE(mipmap.levelSurface(1).tileCount(), 0);
+	QCOMPARE(mipmap.levelSurface(2).tileCount(), 1);
+
+	// released levels are computed again on demand
+	QCOMPARE(mipmap.surface(1, QRect(0, 0, 64, 64)).tileCount(), 1);
+}
+
+PF_ADD_TESTCLASS(Test_SurfaceMipmap)
+
+}
@@ -0,0 +1,23 @@
+#ifndef TEST_SURFACEMIPMAP_H
+#define TEST_SURFACEMIPMAP_H
+
+#include <QObject>
+
+namespace PaintField {
+
+class Test_SurfaceMipmap : public QObject
+{
+	Q_OBJECT
+public:
+	explicit Test_SurfaceMipmap(QObject *parent = 0);
+
+private slots:
+
+	void test_lazyLevels();
+	void test_releaseUnusedLevels();
+
+};
+
+}
+
+#endif // TEST_SURFACEMIPMAP_H
@@ -0,0 +1,75 @@
+#include <Malachite/SurfacePainter>
+#include "autotest.h"
+#include "testutil.h"
+#include "test_surfaceoffsetview.h"
+
+using namespace Malachite;
+
+namespace PaintField {
+
+namespace {
+
+Surface movedByImages(const Surface &surface, const QPoint &offset)
+{
+	Surface result;
+	{
+		Painter painter(&result);
+		for (const QPoint &key : surface.keys())
+			painter.drawPreTransformedImage(offset + key * Surface::tileWidth(), surface.tile(key));
+	}
+	result.squeeze();
+	return result;
+}
+
+bool surfacesAreEqual(const Surface &a, const Surface &b)
+{
+	auto rect = a.boundingRect() | b.boundingRect();
+	return a.crop(rect) == b.crop(rect);
+}
+
+}
+
+Test_SurfaceOffsetView::Test_SurfaceOffsetView(QObject *parent) :
+	QObject(parent)
+{
+}
+
+void Test_SurfaceOffsetView::test_toSurface_data()
+{
+	QTest::addColumn<QPoint>("offset");
+
+	QTest::newRow("zero") << QPoint();
+	QTest::newRow("aligned") << QPoint(64, -128);
+	QTest::newRow("horizontal") << QPoint(13, 0);
+	QTest::newRow("both") << QPoint(-70, 45);
+}
+
+void Test_SurfaceOffsetView::test_toSurface()
+{
+	QFETCH(QPoint, offset);
+
+	auto surface = TestUtil::createTestSurface(0);
+	SurfaceOffsetView view(surface, offset);
+
+	QCOMPARE(view.offset(), offset);
+	QVERIFY(surfacesAreEqual(view.toSurface(), movedByImages(surface, offset)));
+}
+
+void Test_SurfaceOffsetView::test_drawShifted()
+{
+	auto surface = TestUtil::createTestSurface(1);
+	QPoint offset(-70, 45);
+
+	Surface result;
+	{
+		Painter painter(&result);
+		painter.drawPreTransformedSurface(offset, surface);
+	}
+	result.squeeze();
+
+	QVERIFY(surfacesAreEqual(result, movedByImages(surface, offset)));
+}
+
+PF_ADD_TESTCLASS(Test_SurfaceOffsetView)
+
+}
@@ -0,0 +1,28 @@
+#ifndef TEST_SURFACEOFFSETVIEW_H
+#define TEST_SURFACEOFFSETVIEW_H
+
+#include <QObject>
+
+namespace PaintField {
+
+class Test_SurfaceOffsetView : public QObject
+{
+	Q_OBJECT
+public:
+	explicit Test_SurfaceOffsetView(QObject *parent = 0);
+
+signals:
+
+public slots:
+
+private slots:
+
+	void test_toSurface_data();
+	void test_toSurface();
+	void test_drawShifted();
+
+};
+
+}
+
+#endif // TEST_SURFACEOFFSETVIEW_H
@@ -0,0 +1,56 @@
+#include "autotest.h"
+#include "test_tiledirtymap.h"
+
+#include "paintfield/core/tiledirtymap.h"
+
+namespace PaintField {
+
+Test_TileDirtyMap::Test_TileDirtyMap(QObject *parent) :
+	QObject(parent)
+{
+}
+
+void Test_TileDirtyMap::test_markAndTake()
+{
+	TileDirtyMap map;
+	map.setSceneSize(QSize(200, 100));
+	QCOMPARE(map.keyCount(), QSize(4, 2));
+	QCOMPARE(map.mayHaveDirtyTiles(), false);
+
+	map.markTiles({QPoint(0, 0), QPoint(3, 1)});
+	QCOMPARE(map.mayHaveDirtyTiles(), true);
+
+	auto rects = map.take();
+	QCOMPARE(rects.size(), 2);
+	QCOMPARE(rects.value(QPoint(0, 0)), QRect(0, 0, 64, 64));
+	QCOMPARE(rects.value(QPoint(3, 1)), QRect(0, 0, 64, 64));
+
+	QCOMPARE(map.take().isEmpty(), true);
+}
+
+void Test_TileDirtyMap::test_uniteRects()
+{
+	TileDirtyMap map;
+	map.setSceneSize(QSize(64, 64));
+
+	map.markRect(QPoint(0, 0), QRect(2, 3, 4, 5));
+	map.markRect(QPoint(0, 0), QRect(10, 1, 2, 2));
+
+	auto rects = map.take();
+	QCOMPARE(rects.size(), 1);
+	QCOMPARE(rects.value(QPoint(0, 0)), QRect(QPoint(2, 1), QPoint(11, 7)));
+}
+
+void Test_TileDirtyMap::test_outOfScene()
+{
+	TileDirtyMap map;
+	map.setSceneSize(QSize(64, 64));
+
+	map.markTile(QPoint(-1, 0));
+	map.markTile(QPoint(1, 0));
+	QCOMPARE(map.take().isEmpty(), true);
+}
+
+PF_ADD_TESTCLASS(Test_TileDirtyMap)
+
+}
@@ -0,0 +1,28 @@
+#ifndef TEST_TILEDIRTYMAP_H
+#define TEST_TILEDIRTYMAP_H
+
+#include <QObject>
+
+namespace PaintField {
+
+class Test_TileDirtyMap : public QObject
+{
+	Q_OBJECT
+public:
+	explicit Test_TileDirtyMap(QObject *parent = 0);
+
+signals:
+
+public slots:
+
+private slots:
+
+	void test_markAndTake();
+	void test_uniteRects();
+	void test_outOfScene();
+
+};
+
+}
+
+#endif // TEST_TILEDIRTYMAP_H